@@ -0,0 +1,22 @@
+//*****************************************************************
+// File:   aleatorio.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "aleatorio.h"
+
+std::mt19937& generadorThread() {
+    thread_local std::mt19937 gen(std::random_device{}());
+    return gen;
+}
+
+void sembrarGeneradorThread(const uint32_t semilla) {
+    generadorThread().seed(semilla);
+}
+
+float numeroAleatorio() {
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    return dist(generadorThread());
+}
@@ -0,0 +1,22 @@
+//*****************************************************************
+// File:   aleatorio.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+
+#include <random>
+#include "utilidades.h"
+
+// Función que devuelve el generador Mersenne Twister propio del thread que la llama.
+// Se siembra una única vez (con std::random_device) la primera vez que se usa en cada
+// thread, evitando crear un generador nuevo en cada muestra.
+std::mt19937& generadorThread();
+
+// Función que vuelve a sembrar con <semilla> el generador del thread que la llama, para que
+// lo que genere a partir de ahora sea reproducible
+void sembrarGeneradorThread(const uint32_t semilla);
+
+// Función que devuelve un float aleatorio uniforme en [0, 1) usando el generador del thread
+float numeroAleatorio();
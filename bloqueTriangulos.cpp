@@ -0,0 +1,198 @@
+//*****************************************************************
+// File:   bloqueTriangulos.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "bloqueTriangulos.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+vector<BloqueTriangulos> construirBloquesTriangulos(const vector<Triangulo>& triangulos) {
+    const size_t numBloques = (triangulos.size() + TRIANGULOS_POR_BLOQUE - 1) / TRIANGULOS_POR_BLOQUE;
+    vector<BloqueTriangulos> bloques(numBloques, BloqueTriangulos{});   // Huecos a 0: degenerados
+
+    for (size_t i = 0; i < triangulos.size(); ++i) {
+        BloqueTriangulos& bloque = bloques[i / TRIANGULOS_POR_BLOQUE];
+        const size_t k = i % TRIANGULOS_POR_BLOQUE;
+        const Triangulo& tri = triangulos[i];
+        Direccion e1 = tri.p1 - tri.p0;
+        Direccion e2 = tri.p2 - tri.p0;
+        bloque.p0x[k] = tri.p0.coord[0]; bloque.p0y[k] = tri.p0.coord[1]; bloque.p0z[k] = tri.p0.coord[2];
+        bloque.e1x[k] = e1.coord[0]; bloque.e1y[k] = e1.coord[1]; bloque.e1z[k] = e1.coord[2];
+        bloque.e2x[k] = e2.coord[0]; bloque.e2y[k] = e2.coord[1]; bloque.e2z[k] = e2.coord[2];
+    }
+
+    return bloques;
+}
+
+#if defined(__AVX2__)
+
+const char* const KERNEL_INTERSECCION_TRIANGULOS = "AVX2";
+
+int interseccionBloque(const BloqueTriangulos& bloque, const Rayo& rayo, float& tMin) {
+    const __m256 ox = _mm256_set1_ps(rayo.o.coord[0]), oy = _mm256_set1_ps(rayo.o.coord[1]),
+                 oz = _mm256_set1_ps(rayo.o.coord[2]);
+    const __m256 dx = _mm256_set1_ps(rayo.d.coord[0]), dy = _mm256_set1_ps(rayo.d.coord[1]),
+                 dz = _mm256_set1_ps(rayo.d.coord[2]);
+    const __m256 e1x = _mm256_load_ps(bloque.e1x), e1y = _mm256_load_ps(bloque.e1y),
+                 e1z = _mm256_load_ps(bloque.e1z);
+    const __m256 e2x = _mm256_load_ps(bloque.e2x), e2y = _mm256_load_ps(bloque.e2y),
+                 e2z = _mm256_load_ps(bloque.e2z);
+    const __m256 cero = _mm256_setzero_ps(), uno = _mm256_set1_ps(1.0f);
+    const __m256 margen = _mm256_set1_ps(MARGEN_ERROR);
+
+    // h = d x e2, a = e1 · h
+    __m256 hx = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+    __m256 hy = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+    __m256 hz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+    __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, hx), _mm256_mul_ps(e1y, hy)),
+                             _mm256_mul_ps(e1z, hz));
+    __m256 f = _mm256_div_ps(uno, a);
+
+    // s = o - p0, u = f (s · h)
+    __m256 sx = _mm256_sub_ps(ox, _mm256_load_ps(bloque.p0x));
+    __m256 sy = _mm256_sub_ps(oy, _mm256_load_ps(bloque.p0y));
+    __m256 sz = _mm256_sub_ps(oz, _mm256_load_ps(bloque.p0z));
+    __m256 u = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, hx), _mm256_mul_ps(sy, hy)),
+                                              _mm256_mul_ps(sz, hz)));
+
+    // q = s x e1, v = f (d · q), t = f (e2 · q)
+    __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+    __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+    __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+    __m256 v = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)),
+                                              _mm256_mul_ps(dz, qz)));
+    __m256 t = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)),
+                                              _mm256_mul_ps(e2z, qz)));
+
+    __m256 absA = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+    __m256 valido = _mm256_cmp_ps(absA, margen, _CMP_GE_OQ);
+    valido = _mm256_and_ps(valido, _mm256_cmp_ps(u, cero, _CMP_GE_OQ));
+    valido = _mm256_and_ps(valido, _mm256_cmp_ps(u, uno, _CMP_LE_OQ));
+    valido = _mm256_and_ps(valido, _mm256_cmp_ps(v, cero, _CMP_GE_OQ));
+    valido = _mm256_and_ps(valido, _mm256_cmp_ps(_mm256_add_ps(u, v), uno, _CMP_LE_OQ));
+    valido = _mm256_and_ps(valido, _mm256_cmp_ps(t, margen, _CMP_GT_OQ));
+    valido = _mm256_and_ps(valido, _mm256_cmp_ps(t, _mm256_set1_ps(tMin), _CMP_LT_OQ));
+
+    int bits = _mm256_movemask_ps(valido);
+    if (bits == 0) return -1;
+
+    alignas(32) float ts[TRIANGULOS_POR_BLOQUE];
+    _mm256_store_ps(ts, t);
+    int masCercano = -1;
+    for (unsigned k = 0; k < TRIANGULOS_POR_BLOQUE; ++k) {
+        if ((bits >> k) & 1 && ts[k] < tMin) {
+            tMin = ts[k];
+            masCercano = k;
+        }
+    }
+    return masCercano;
+}
+
+#elif defined(__SSE2__)
+
+const char* const KERNEL_INTERSECCION_TRIANGULOS = "SSE";
+
+int interseccionBloque(const BloqueTriangulos& bloque, const Rayo& rayo, float& tMin) {
+    const __m128 ox = _mm_set1_ps(rayo.o.coord[0]), oy = _mm_set1_ps(rayo.o.coord[1]),
+                 oz = _mm_set1_ps(rayo.o.coord[2]);
+    const __m128 dx = _mm_set1_ps(rayo.d.coord[0]), dy = _mm_set1_ps(rayo.d.coord[1]),
+                 dz = _mm_set1_ps(rayo.d.coord[2]);
+    const __m128 cero = _mm_setzero_ps(), uno = _mm_set1_ps(1.0f);
+    const __m128 margen = _mm_set1_ps(MARGEN_ERROR);
+    int masCercano = -1;
+
+    // Dos pasadas de 4 triángulos por bloque
+    for (unsigned base = 0; base < TRIANGULOS_POR_BLOQUE; base += 4) {
+        const __m128 e1x = _mm_load_ps(bloque.e1x + base), e1y = _mm_load_ps(bloque.e1y + base),
+                     e1z = _mm_load_ps(bloque.e1z + base);
+        const __m128 e2x = _mm_load_ps(bloque.e2x + base), e2y = _mm_load_ps(bloque.e2y + base),
+                     e2z = _mm_load_ps(bloque.e2z + base);
+
+        // h = d x e2, a = e1 · h
+        __m128 hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)), _mm_mul_ps(e1z, hz));
+        __m128 f = _mm_div_ps(uno, a);
+
+        // s = o - p0, u = f (s · h)
+        __m128 sx = _mm_sub_ps(ox, _mm_load_ps(bloque.p0x + base));
+        __m128 sy = _mm_sub_ps(oy, _mm_load_ps(bloque.p0y + base));
+        __m128 sz = _mm_sub_ps(oz, _mm_load_ps(bloque.p0z + base));
+        __m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)),
+                                            _mm_mul_ps(sz, hz)));
+
+        // q = s x e1, v = f (d · q), t = f (e2 · q)
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        __m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+                                            _mm_mul_ps(dz, qz)));
+        __m128 t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+                                            _mm_mul_ps(e2z, qz)));
+
+        __m128 absA = _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+        __m128 valido = _mm_cmpge_ps(absA, margen);
+        valido = _mm_and_ps(valido, _mm_cmpge_ps(u, cero));
+        valido = _mm_and_ps(valido, _mm_cmple_ps(u, uno));
+        valido = _mm_and_ps(valido, _mm_cmpge_ps(v, cero));
+        valido = _mm_and_ps(valido, _mm_cmple_ps(_mm_add_ps(u, v), uno));
+        valido = _mm_and_ps(valido, _mm_cmpgt_ps(t, margen));
+        valido = _mm_and_ps(valido, _mm_cmplt_ps(t, _mm_set1_ps(tMin)));
+
+        int bits = _mm_movemask_ps(valido);
+        if (bits == 0) continue;
+
+        alignas(16) float ts[4];
+        _mm_store_ps(ts, t);
+        for (unsigned k = 0; k < 4; ++k) {
+            if ((bits >> k) & 1 && ts[k] < tMin) {
+                tMin = ts[k];
+                masCercano = base + k;
+            }
+        }
+    }
+    return masCercano;
+}
+
+#else
+
+const char* const KERNEL_INTERSECCION_TRIANGULOS = "escalar";
+
+int interseccionBloque(const BloqueTriangulos& bloque, const Rayo& rayo, float& tMin) {
+    const float ox = rayo.o.coord[0], oy = rayo.o.coord[1], oz = rayo.o.coord[2];
+    const float dx = rayo.d.coord[0], dy = rayo.d.coord[1], dz = rayo.d.coord[2];
+    int masCercano = -1;
+
+    for (unsigned k = 0; k < TRIANGULOS_POR_BLOQUE; ++k) {
+        const float e1x = bloque.e1x[k], e1y = bloque.e1y[k], e1z = bloque.e1z[k];
+        const float e2x = bloque.e2x[k], e2y = bloque.e2y[k], e2z = bloque.e2z[k];
+        float hx = dy * e2z - dz * e2y, hy = dz * e2x - dx * e2z, hz = dx * e2y - dy * e2x;
+        float a = e1x * hx + e1y * hy + e1z * hz;
+        if (fabs(a) < MARGEN_ERROR) continue;
+
+        float f = 1.0f / a;
+        float sx = ox - bloque.p0x[k], sy = oy - bloque.p0y[k], sz = oz - bloque.p0z[k];
+        float u = f * (sx * hx + sy * hy + sz * hz);
+        if (u < 0.0f || u > 1.0f) continue;
+
+        float qx = sy * e1z - sz * e1y, qy = sz * e1x - sx * e1z, qz = sx * e1y - sy * e1x;
+        float v = f * (dx * qx + dy * qy + dz * qz);
+        if (v < 0.0f || u + v > 1.0f) continue;
+
+        float t = f * (e2x * qx + e2y * qy + e2z * qz);
+        if (t > MARGEN_ERROR && t < tMin) {
+            tMin = t;
+            masCercano = k;
+        }
+    }
+    return masCercano;
+}
+
+#endif
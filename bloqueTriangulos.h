@@ -0,0 +1,35 @@
+//*****************************************************************
+// File:   bloqueTriangulos.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+#include "triangulo.h"
+#include "rayo.h"
+#include "utilidades.h"
+
+// Número de triángulos de cada bloque
+constexpr unsigned TRIANGULOS_POR_BLOQUE = 8;
+
+// Bloque de hasta TRIANGULOS_POR_BLOQUE triángulos en estructura de arrays (SoA):
+// vértice p0 y aristas p1-p0, p2-p0 de cada triángulo, una componente por array.
+// Los huecos de un bloque incompleto son triángulos degenerados que nunca intersecan.
+struct alignas(32) BloqueTriangulos {
+    float p0x[TRIANGULOS_POR_BLOQUE], p0y[TRIANGULOS_POR_BLOQUE], p0z[TRIANGULOS_POR_BLOQUE];
+    float e1x[TRIANGULOS_POR_BLOQUE], e1y[TRIANGULOS_POR_BLOQUE], e1z[TRIANGULOS_POR_BLOQUE];
+    float e2x[TRIANGULOS_POR_BLOQUE], e2y[TRIANGULOS_POR_BLOQUE], e2z[TRIANGULOS_POR_BLOQUE];
+};
+
+// Nombre del kernel de intersección elegido al compilar ("AVX2", "SSE" o "escalar")
+extern const char* const KERNEL_INTERSECCION_TRIANGULOS;
+
+// Función que agrupa <triangulos> en bloques de TRIANGULOS_POR_BLOQUE
+vector<BloqueTriangulos> construirBloquesTriangulos(const vector<Triangulo>& triangulos);
+
+// Función que interseca <rayo> con los triángulos de <bloque> (Möller–Trumbore, con los
+// mismos márgenes que Triangulo::interseccion). Si alguno interseca a distancia menor
+// que <tMin>, actualiza <tMin> y devuelve su posición en el bloque; si no, devuelve -1.
+// El kernel (AVX2 de 8 en 8, SSE de 4 en 4 o escalar) se elige al compilar según
+// las instrucciones disponibles (__AVX2__, __SSE2__).
+int interseccionBloque(const BloqueTriangulos& bloque, const Rayo& rayo, float& tMin);
@@ -65,3 +65,7 @@ ostream& operator<<(ostream& os, const BSDFs& c){
     os << "  kt= " << c.kt << " ]" << endl;
     return os;
 }
+
+bool existeMaterial(const string& material) {
+    return materiales.count(material) > 0;
+}
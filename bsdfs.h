@@ -54,3 +54,6 @@ public:
     // Operador de salida por pantalla
     friend ostream& operator<<(ostream& os, const BSDFs& r);
 };
+
+// Función que devuelve si <material> es uno de los materiales predefinidos
+bool existeMaterial(const string& material);
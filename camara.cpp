@@ -7,7 +7,7 @@
 
 #include "camara.h"
 #include <iostream>
-#include <random>
+#include "muestreador.h"
 #include <cmath>
 
 
@@ -69,16 +69,12 @@ Rayo Camara::obtenerRayoCentroPixel(unsigned coordAncho, float anchoPorPixel,
 
 Rayo Camara::obtenerRayoAleatorioPixel(unsigned coordAncho, float anchoPorPixel, 
                                     unsigned coordAlto, float altoPorPixel) const {
-    std::random_device rd;  // Dispositivo para obtener una semilla (aleatoriedad real del hardware)
-    std::mt19937 gen(rd()); // Motor de generación Mersenne Twister con semilla
-    std::uniform_real_distribution<> distribucion(0.0, 1.0);  // Rango entre 0.0 y 1.0
-
     Direccion dirEsquina = obtenerDireccionEsquinaPixel(coordAncho, anchoPorPixel, coordAlto, altoPorPixel);
     
     // Multiplicamos el float aleatorio (0, 1) generado por el ancho/alto del pixel
     // y se lo sumamos a la esquina para obtener las nuevas coordenadas aleatorias
-    float anchoRand = distribucion(gen) * anchoPorPixel;
-    float altoRand = distribucion(gen) * altoPorPixel;
+    float anchoRand = muestra() * anchoPorPixel;
+    float altoRand = muestra() * altoPorPixel;
 
     Direccion dirRand = dirEsquina + Direccion(0, anchoRand, - altoRand);
     return Rayo(dirRand, Punto(0.0f, 0.0f, 0.0f));
@@ -63,7 +63,7 @@ public:
       Rayo obtenerRayoCentroPixel(unsigned coordAncho, float anchoPorPixel,
                                     unsigned coordAlto, float altoPorPixel) const;
       // Método que devuelve el rayo que va desde la cámara hasta
-      // un punto aleatorio del pixel (ancho, alto)
+      // un punto aleatorio del pixel (ancho, alto), tomado del muestreador activo (ver muestra())
       Rayo obtenerRayoAleatorioPixel(unsigned coordAncho, float anchoPorPixel,
                                     unsigned coordAlto, float altoPorPixel) const;
 };
@@ -120,7 +120,8 @@ bool Cuboide::puntoEsFuenteDeLuz(const Punto& punto) const {
     return false;
 }
 
-Punto Cuboide::generarPuntoAleatorio(float& prob) const {
+Punto Cuboide::muestrearPuntoArea(const float, const float, float& prob) const {
+    prob = 0.0f;
     return Punto();
 }
 
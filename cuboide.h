@@ -51,9 +51,8 @@ public:
     // y además, es un punto lumínico del cuboide.
     bool puntoEsFuenteDeLuz(const Punto& punto) const override;
     
-    // Método que devuelve un punto aleatorio de la superficie del cuboide en UCS.
-    // También devuelve en <prob> la probabilidad de muestrear dicho punto.
-    Punto generarPuntoAleatorio(float& prob) const override;
+    // El cuboide no puede ser luz de área: devuelve un punto cualquiera con <prob> = 0.
+    Punto muestrearPuntoArea(const float u1, const float u2, float& prob) const override;
     
     // Método que obtiene la posición del punto <pto> del cuboide en el eje U de la
     // textura correspondiente. Tenemos garantizado que <pto> pertenece al objeto.
@@ -7,7 +7,6 @@
 
 #pragma once
 #include "puntoDireccion.h"
-#include "matriz.h"
 #include "utilidades.h"
 #include <cmath>
 #include <stdexcept>  // Para manejar excepciones
@@ -16,62 +15,135 @@
 class Direccion : public PuntoDireccion {
 public:
     // Constructor base
-    Direccion();
-
-    // Constructor dada otra direccion
-    Direccion(const Direccion& d);
+    constexpr Direccion();
 
     // Constructor dados 3 valores float
-    Direccion(float x, float y, float z);
+    constexpr Direccion(float x, float y, float z);
 
     // Constructor dado un array de 3 valores float
-    Direccion(array<float,3> _coord);
+    constexpr Direccion(array<float,3> _coord);
 
-    // Función que devuelve una Matriz 4x1 con las coordenadas
-    // homogeneas de la direccion
-    Matriz<4,1> getCoordHomo() const override;
+    // Constructor dado un Vec3
+    constexpr explicit Direccion(const Vec3& v);
     
     // Operación de suma de dos direcciones
-    Direccion operator+(const Direccion& d) const;
+    constexpr Direccion operator+(const Direccion& d) const;
     
     // Operación de resta unaria (-direccion)
-    Direccion operator-() const;
+    constexpr Direccion operator-() const;
     
     // Operación de resta de dos direcciones
-    Direccion operator-(const Direccion& d) const;
+    constexpr Direccion operator-(const Direccion& d) const;
     
     // Operación de multiplicación entre un escalar y la dirección
-    Direccion operator*(const float escalar) const;
+    constexpr Direccion operator*(const float escalar) const;
     
     // Operación de división entre un escalar y la dirección
-    Direccion operator/(const float escalar) const;
+    constexpr Direccion operator/(const float escalar) const;
 
-    // Operador de asignación
-    Direccion& operator=(const Direccion& d);
-    
     // Función global para calcular el módulo de la dirección
-    friend float modulo(const Direccion& d);
+    friend inline float modulo(const Direccion& d);
     
     // Función global para normalizar la dirección
-    friend Direccion normalizar(const Direccion& d);
+    friend inline Direccion normalizar(const Direccion& d);
     
     // Función global para producto vectorial entre dos direcciones
-    friend Direccion cross(const Direccion& d1, const Direccion& d2);
+    friend constexpr Direccion cross(const Direccion& d1, const Direccion& d2);
     
     // Función global para devolver la dirección con componentes absolutas
-    friend Direccion abs(const Direccion& d);
+    friend inline Direccion abs(const Direccion& d);
     
 private:
     // Método privado para calcular el módulo de la dirección
-    float modulo() const;
+    inline float modulo() const;
     
     // Método privado para normalizar la dirección
-    Direccion normalizar() const;
+    inline Direccion normalizar() const;
     
     // Método privado para producto vectorial con otra dirección
-    Direccion productoVectorial(const Direccion& d) const;
+    constexpr Direccion productoVectorial(const Direccion& d) const;
     
     // Método privado para obtener Direccion correspondiente de hacer el absoluto de
     // cada coordenada
-    Direccion absoluto() const;
+    inline Direccion absoluto() const;
 };
+
+static_assert(std::is_trivially_copyable_v<Direccion> && sizeof(Direccion) == 12,
+              "Direccion debe poder copiarse como 3 floats");
+
+
+// Definiciones en la cabecera para que el compilador pueda expandirlas en línea
+
+constexpr Direccion::Direccion() : PuntoDireccion() {}
+
+constexpr Direccion::Direccion(float x, float y, float z) : PuntoDireccion(x, y, z) {}
+
+constexpr Direccion::Direccion(array<float,3> _coord) : PuntoDireccion(_coord) {}
+
+constexpr Direccion::Direccion(const Vec3& v) : PuntoDireccion(v.x, v.y, v.z) {}
+
+constexpr Direccion Direccion::operator+(const Direccion& d) const {
+    return Direccion(coord[0] + d.coord[0], coord[1] + d.coord[1], coord[2] + d.coord[2]);
+}
+
+constexpr Direccion Direccion::operator-() const {
+    return Direccion(-coord[0], -coord[1], -coord[2]);
+}
+
+constexpr Direccion Direccion::operator-(const Direccion& d) const {
+    return Direccion(coord[0] - d.coord[0], coord[1] - d.coord[1], coord[2] - d.coord[2]);
+}
+
+constexpr Direccion Direccion::operator*(const float escalar) const {
+    return Direccion(coord[0] * escalar, coord[1] * escalar, coord[2] * escalar);
+}
+
+constexpr Direccion Direccion::operator/(const float escalar) const {
+    if (escalar == 0) {
+        throw invalid_argument("Error: Division por cero no permitida.");
+    }
+    
+    return Direccion(coord[0] / escalar, coord[1] / escalar, coord[2] / escalar);
+}
+
+inline float Direccion::modulo() const {
+    return std::sqrt(coord[0] * coord[0] + coord[1] * coord[1] + coord[2] * coord[2]);
+}
+
+inline float modulo(const Direccion& d) {
+    return d.modulo();
+}
+
+inline Direccion Direccion::normalizar() const {
+    float longitud = this->modulo();
+    if (longitud == 0) {
+        throw invalid_argument(
+            "Error: No se puede calcular porque direccion tiene modulo cero.");
+    }
+    return *this / longitud;
+}
+
+inline Direccion normalizar(const Direccion& d) {
+    return d.normalizar();
+}
+
+constexpr Direccion Direccion::productoVectorial(const Direccion& d) const {
+    return Direccion(
+        coord[1] * d.coord[2] - coord[2] * d.coord[1],
+        coord[2] * d.coord[0] - coord[0] * d.coord[2],
+        coord[0] * d.coord[1] - coord[1] * d.coord[0]
+    );
+}
+
+constexpr Direccion cross(const Direccion& d1, const Direccion& d2) {
+    return d1.productoVectorial(d2);
+}
+
+inline Direccion Direccion::absoluto() const {
+    return Direccion(std::abs(this->coord[0]), std::abs(this->coord[1]),
+                     std::abs(this->coord[2]));
+}
+
+inline Direccion abs(const Direccion& d) {
+    return Direccion(d.absoluto());
+}
@@ -0,0 +1,413 @@
+//*****************************************************************
+// File:   distribuido.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "distribuido.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <sstream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ficheroEscena.h"
+#include "gestorPPM.h"
+#include "photonMapping.h"
+
+// Función que envía los <n> bytes de <datos> por <fd>. Devuelve false si la conexión falla.
+static bool enviarTodo(const int fd, const void* datos, size_t n) {
+    const char* p = static_cast<const char*>(datos);
+    while (n > 0) {
+        ssize_t enviados = send(fd, p, n, MSG_NOSIGNAL);
+        if (enviados <= 0) {
+            if (enviados < 0 && errno == EINTR) continue;
+            return false;
+        }
+        p += enviados;
+        n -= enviados;
+    }
+    return true;
+}
+
+// Función que recibe exactamente <n> bytes de <fd> en <datos>. Devuelve false si la conexión
+// se cierra o falla antes.
+static bool recibirTodo(const int fd, void* datos, size_t n) {
+    char* p = static_cast<char*>(datos);
+    while (n > 0) {
+        ssize_t recibidos = recv(fd, p, n, 0);
+        if (recibidos <= 0) {
+            if (recibidos < 0 && errno == EINTR) continue;
+            return false;
+        }
+        p += recibidos;
+        n -= recibidos;
+    }
+    return true;
+}
+
+// Función que envía por <fd> el mensaje de tipo <tipo> con los <longitud> bytes de <datos>
+static bool enviarMensaje(const int fd, const TipoMensaje tipo, const void* datos = nullptr,
+                          const uint32_t longitud = 0) {
+    CabeceraMensaje cabecera = {tipo, longitud};
+    return enviarTodo(fd, &cabecera, sizeof(cabecera)) && (longitud == 0 || enviarTodo(fd, datos, longitud));
+}
+
+// Función que devuelve la longitud máxima del contenido de un mensaje de tipo <tipo> (0 si el
+// tipo no existe), para no reservar lo que diga la cabecera de cualquiera que se conecte
+static uint32_t longitudMaximaMensaje(const uint32_t tipo) {
+    switch (tipo) {
+        case MENSAJE_TRABAJO:
+        case MENSAJE_ERROR:
+            return MAX_BYTES_MENSAJE_TEXTO;
+        case MENSAJE_TESELA:
+            return sizeof(Tesela);
+        case MENSAJE_RESULTADO:
+            return sizeof(uint32_t) + TAM_TESELA * TAM_TESELA * 3 * sizeof(float);
+        default:
+            return 0;
+    }
+}
+
+// Función que recibe de <fd> un mensaje completo, devolviendo su tipo en <tipo> y su contenido
+// en <datos>. Devuelve false si la conexión se cierra o falla, o si el mensaje es más largo de lo
+// que permite su tipo (ver longitudMaximaMensaje).
+static bool recibirMensaje(const int fd, uint32_t& tipo, vector<char>& datos) {
+    CabeceraMensaje cabecera;
+    if (!recibirTodo(fd, &cabecera, sizeof(cabecera))) return false;
+    if (cabecera.longitud > longitudMaximaMensaje(cabecera.tipo)) return false;
+    tipo = cabecera.tipo;
+    datos.resize(cabecera.longitud);
+    return cabecera.longitud == 0 || recibirTodo(fd, datos.data(), cabecera.longitud);
+}
+
+// Función que desactiva el algoritmo de Nagle en <fd>: los mensajes son pequeños y cada uno
+// espera respuesta, así que no conviene retrasar su envío
+static void desactivarNagle(const int fd) {
+    int uno = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+}
+
+// Función que limita a <segundos> cada espera de recv y send en <fd>, para que un mensaje a
+// medias no bloquee indefinidamente (recibirTodo y enviarTodo fallan al agotarse)
+static void limitarEsperas(const int fd, const int segundos) {
+    timeval limite = {segundos, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limite, sizeof(limite));
+}
+
+vector<Tesela> dividirEnTeselas(const unsigned ancho, const unsigned alto, const unsigned lado) {
+    vector<Tesela> teselas;
+    for (unsigned y = 0; y < alto; y += lado) {
+        for (unsigned x = 0; x < ancho; x += lado) {
+            teselas.push_back({static_cast<uint32_t>(teselas.size()), x, y, std::min(x + lado, ancho),
+                               std::min(y + lado, alto)});
+        }
+    }
+    return teselas;
+}
+
+// Estado en el coordinador de un trabajador conectado
+struct Trabajador {
+    int fd;
+    bool listo = false;     // Ha cargado la escena y puede recibir teselas
+    int tesela = -1;        // Tesela asignada y pendiente de resultado (-1: ninguna)
+    std::chrono::steady_clock::time_point inicioTesela = {};    // Momento en que se le asignó
+};
+
+int coordinarRenderDistribuido(const string& rutaEscena, const vector<string>& asignaciones,
+                               const unsigned short puerto, const unsigned numTrabajadoresLocales,
+                               const string& ejecutable) {
+    auto inicio = std::chrono::steady_clock::now();
+    DescripcionRender descripcion;
+    try {
+        leerFicheroEscena(rutaEscena, descripcion);
+        aplicarAsignaciones(descripcion, asignaciones);
+    } catch (const std::exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    const Parametros& parametros = descripcion.parametros;
+    Escena escena(descripcion.objetos, descripcion.luces);
+
+    // Los fotones se trazan una sola vez, aquí, y los trabajadores los leen del fichero (o
+    // directamente del que indique la escena, si ya estaban trazados)
+    const bool trazarAqui = descripcion.fotones.empty();
+    const string rutaFotones = trazarAqui ? descripcion.salida + "_fotones.bin" : descripcion.fotones;
+    if (trazarAqui) {
+        vector<Photon> globales, causticos;
+        const int caminos = trazarFotones(globales, causticos, escena, parametros);
+        try {
+            guardarFotones(rutaFotones, globales, causticos, caminos);
+        } catch (const std::exception& e) {
+            cerr << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::chrono::duration<double> tiempoFotones = std::chrono::steady_clock::now() - inicio;
+
+    int servidor = socket(AF_INET, SOCK_STREAM, 0);
+    int uno = 1;
+    setsockopt(servidor, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+    sockaddr_in direccion = {};
+    direccion.sin_family = AF_INET;
+    direccion.sin_addr.s_addr = htonl(INADDR_ANY);
+    direccion.sin_port = htons(puerto);
+    if (servidor < 0 || bind(servidor, reinterpret_cast<sockaddr*>(&direccion), sizeof(direccion)) < 0 ||
+        listen(servidor, SOMAXCONN) < 0) {
+        cerr << "ERROR: no se puede escuchar en el puerto " << puerto << ": " << strerror(errno) << endl;
+        if (servidor >= 0) close(servidor);
+        return EXIT_FAILURE;
+    }
+    cout << "Coordinador escuchando en el puerto " << puerto << endl;
+
+    vector<pid_t> locales;
+    const string puertoTexto = std::to_string(puerto);
+    for (unsigned i = 0; i < numTrabajadoresLocales; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(servidor);
+            execl(ejecutable.c_str(), ejecutable.c_str(), "trabajador", "127.0.0.1", puertoTexto.c_str(),
+                  static_cast<char*>(nullptr));
+            std::_Exit(EXIT_FAILURE);
+        }
+        if (pid > 0) locales.push_back(pid);
+    }
+
+    // Mensaje de trabajo: la escena, los fotones y las asignaciones, una por línea
+    string trabajo = rutaEscena + "\n" + rutaFotones + "\n";
+    for (const string& asignacion : asignaciones) trabajo += asignacion + "\n";
+
+    const vector<Tesela> teselas = dividirEnTeselas(parametros.numPxlsAncho, parametros.numPxlsAlto, TAM_TESELA);
+    std::deque<int> pendientes;
+    for (const Tesela& t : teselas) pendientes.push_back(t.id);
+    vector<bool> terminada(teselas.size(), false);
+    size_t numTerminadas = 0;
+    vector<vector<RGB>> colorPixeles(parametros.numPxlsAlto, vector<RGB>(parametros.numPxlsAncho));
+    vector<Trabajador> trabajadores;
+    auto ultimaActividad = std::chrono::steady_clock::now();
+
+    auto desconectar = [&](size_t i, const string& motivo) {
+        Trabajador& t = trabajadores[i];
+        if (t.tesela >= 0 && !terminada[t.tesela]) {
+            pendientes.push_front(t.tesela);
+            cerr << "AVISO: trabajador perdido (" << motivo << "), la tesela " << t.tesela << " se reasigna" << endl;
+        } else {
+            cerr << "AVISO: trabajador perdido (" << motivo << ")" << endl;
+        }
+        close(t.fd);
+        trabajadores.erase(trabajadores.begin() + i);
+    };
+
+    while (numTerminadas < teselas.size()) {
+        // Asignar teselas a los trabajadores libres
+        for (size_t i = 0; i < trabajadores.size(); ++i) {
+            Trabajador& t = trabajadores[i];
+            if (!t.listo || t.tesela >= 0 || pendientes.empty()) continue;
+            const Tesela& tesela = teselas[pendientes.front()];
+            if (enviarMensaje(t.fd, MENSAJE_TESELA, &tesela, sizeof(tesela))) {
+                t.tesela = tesela.id;
+                t.inicioTesela = std::chrono::steady_clock::now();
+                pendientes.pop_front();
+            } else {
+                desconectar(i--, "error al enviar");
+            }
+        }
+
+        vector<pollfd> fds = {{servidor, POLLIN, 0}};
+        for (const Trabajador& t : trabajadores) fds.push_back({t.fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            cerr << "ERROR: poll: " << strerror(errno) << endl;
+            break;
+        }
+        if (trabajadores.empty()) {
+            std::chrono::duration<double> espera = std::chrono::steady_clock::now() - ultimaActividad;
+            if (espera.count() > TIEMPO_ESPERA_TRABAJADORES) {
+                cerr << "ERROR: ningún trabajador conectado en " << TIEMPO_ESPERA_TRABAJADORES << " s" << endl;
+                break;
+            }
+        } else {
+            ultimaActividad = std::chrono::steady_clock::now();
+        }
+
+        // Los trabajadores que tardan demasiado en una tesela se dan por colgados: se
+        // desconectan y la tesela vuelve a la cola. Los que tienen un mensaje llegando se leen antes.
+        const auto ahora = std::chrono::steady_clock::now();
+        for (size_t i = trabajadores.size(); i-- > 0;) {
+            if (trabajadores[i].tesela < 0 || fds[i + 1].revents != 0) continue;
+            std::chrono::duration<double> espera = ahora - trabajadores[i].inicioTesela;
+            if (espera.count() > TIEMPO_MAX_TESELA) {
+                desconectar(i, "sin resultado en " + std::to_string(TIEMPO_MAX_TESELA) + " s");
+                fds.erase(fds.begin() + i + 1);
+            }
+        }
+
+        // Mensajes de los trabajadores (en orden inverso, para poder borrar los que fallan)
+        for (size_t i = trabajadores.size(); i-- > 0;) {
+            if (fds[i + 1].revents == 0) continue;
+            uint32_t tipo;
+            vector<char> datos;
+            if (!recibirMensaje(trabajadores[i].fd, tipo, datos)) {
+                desconectar(i, "conexión cerrada");
+            } else if (tipo == MENSAJE_LISTO) {
+                trabajadores[i].listo = true;
+            } else if (tipo == MENSAJE_RESULTADO && datos.size() >= sizeof(uint32_t)) {
+                uint32_t id;
+                memcpy(&id, datos.data(), sizeof(id));
+                if (id >= teselas.size() || static_cast<int>(id) != trabajadores[i].tesela) {
+                    desconectar(i, "resultado de una tesela no asignada");
+                    continue;
+                }
+                const Tesela& tesela = teselas[id];
+                const size_t numPixeles = (tesela.x1 - tesela.x0) * (tesela.y1 - tesela.y0);
+                if (datos.size() != sizeof(id) + numPixeles * 3 * sizeof(float)) {
+                    desconectar(i, "resultado con tamaño incorrecto");
+                    continue;
+                }
+                if (!terminada[id]) {
+                    const char* p = datos.data() + sizeof(id);
+                    for (unsigned y = tesela.y0; y < tesela.y1; ++y) {
+                        for (unsigned x = tesela.x0; x < tesela.x1; ++x, p += 3 * sizeof(float)) {
+                            memcpy(colorPixeles[y][x].rgb.data(), p, 3 * sizeof(float));
+                        }
+                    }
+                    terminada[id] = true;
+                    numTerminadas++;
+                    if (parametros.printPixelesProcesados) {
+                        cout << "Progreso: " << numTerminadas << " / " << teselas.size() << " teselas" << endl;
+                    }
+                }
+                trabajadores[i].tesela = -1;
+            } else if (tipo == MENSAJE_ERROR) {
+                desconectar(i, string(datos.begin(), datos.end()));
+            } else {
+                desconectar(i, "mensaje inesperado");
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(servidor, nullptr, nullptr);
+            if (fd >= 0) {
+                desactivarNagle(fd);
+                limitarEsperas(fd, TIEMPO_MAX_MENSAJE);
+                if (enviarMensaje(fd, MENSAJE_TRABAJO, trabajo.data(), trabajo.size())) {
+                    trabajadores.push_back({fd});
+                } else {
+                    close(fd);
+                }
+            }
+        }
+    }
+
+    for (const Trabajador& t : trabajadores) {
+        enviarMensaje(t.fd, MENSAJE_FIN);
+        close(t.fd);
+    }
+    close(servidor);
+    for (pid_t pid : locales) waitpid(pid, nullptr, 0);
+    if (trazarAqui) std::remove(rutaFotones.c_str());
+
+    if (numTerminadas < teselas.size()) {
+        cerr << "ERROR: quedan " << teselas.size() - numTerminadas << " teselas sin renderizar" << endl;
+        return EXIT_FAILURE;
+    }
+    std::chrono::duration<double> tiempoTotal = std::chrono::steady_clock::now() - inicio;
+    cout << "Render distribuido: " << teselas.size() << " teselas, fotones " << tiempoFotones.count()
+         << " s, total " << tiempoTotal.count() << " s" << endl;
+
+    string nombreArchivo = "./" + descripcion.salida + ".ppm";
+    pintarEscenaEnPPM(nombreArchivo, colorPixeles);
+    transformarFicheroPPM(nombreArchivo, 5);
+    return EXIT_SUCCESS;
+}
+
+int ejecutarTrabajador(const string& host, const unsigned short puerto) {
+    addrinfo pista = {}, *direcciones = nullptr;
+    pista.ai_family = AF_UNSPEC;
+    pista.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), std::to_string(puerto).c_str(), &pista, &direcciones) != 0) {
+        cerr << "ERROR: no se encuentra el coordinador " << host << endl;
+        return EXIT_FAILURE;
+    }
+    int fd = -1;
+    for (addrinfo* a = direcciones; a != nullptr && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(direcciones);
+    if (fd < 0) {
+        cerr << "ERROR: no se puede conectar con " << host << ":" << puerto << endl;
+        return EXIT_FAILURE;
+    }
+    desactivarNagle(fd);
+
+    uint32_t tipo;
+    vector<char> datos;
+    if (!recibirMensaje(fd, tipo, datos) || tipo != MENSAJE_TRABAJO) {
+        cerr << "ERROR: no se ha recibido el trabajo del coordinador" << endl;
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    // Carga de la escena y del mapa de fotones que indica el coordinador
+    DescripcionRender descripcion;
+    PhotonMap mapaGlobal, mapaCaustico;
+    size_t numGlobales = 0, numCausticos = 0;
+    std::istringstream trabajo(string(datos.begin(), datos.end()));
+    string rutaEscena, rutaFotones, asignacion;
+    getline(trabajo, rutaEscena);
+    getline(trabajo, rutaFotones);
+    try {
+        leerFicheroEscena(rutaEscena, descripcion);
+        vector<string> asignaciones;
+        while (getline(trabajo, asignacion)) asignaciones.push_back(asignacion);
+        aplicarAsignaciones(descripcion, asignaciones);
+        // Mismo camino que el render en un solo proceso, agregados del LOD incluidos
+        paso1CargarPhotonMap(mapaGlobal, mapaCaustico, numGlobales, numCausticos, rutaFotones,
+                             descripcion.parametros);
+    } catch (const std::exception& e) {
+        string error = e.what();
+        enviarMensaje(fd, MENSAJE_ERROR, error.data(), error.size());
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    const Parametros& parametros = descripcion.parametros;
+    Escena escena(descripcion.objetos, descripcion.luces);
+    if (!enviarMensaje(fd, MENSAJE_LISTO)) {
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    vector<RGB> colores;
+    vector<char> resultado;
+    while (recibirMensaje(fd, tipo, datos) && tipo == MENSAJE_TESELA && datos.size() == sizeof(Tesela)) {
+        Tesela tesela;
+        memcpy(&tesela, datos.data(), sizeof(tesela));
+        // La semilla depende de la tesela y no del trabajador, así que el resultado no depende
+        // del reparto
+        sembrarThread(parametros, 2, tesela.id);
+        renderizarTesela(descripcion.camara, escena, tesela.x0, tesela.y0, tesela.x1, tesela.y1, mapaGlobal,
+                         mapaCaustico, numGlobales, numCausticos, parametros, colores);
+
+        resultado.resize(sizeof(tesela.id) + colores.size() * 3 * sizeof(float));
+        memcpy(resultado.data(), &tesela.id, sizeof(tesela.id));
+        for (size_t i = 0; i < colores.size(); ++i) {
+            memcpy(resultado.data() + sizeof(tesela.id) + i * 3 * sizeof(float), colores[i].rgb.data(),
+                   3 * sizeof(float));
+        }
+        if (!enviarMensaje(fd, MENSAJE_RESULTADO, resultado.data(), resultado.size())) break;
+    }
+    close(fd);
+    return EXIT_SUCCESS;
+}
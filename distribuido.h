@@ -0,0 +1,61 @@
+//*****************************************************************
+// File:   distribuido.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+
+#include <cstdint>
+#include "utilidades.h"
+
+// Render distribuido por teselas. Un proceso coordinador lee la escena, traza los fotones,
+// los guarda en un fichero (ver guardarFotones) y reparte la imagen en teselas de TAM_TESELA
+// píxeles entre los procesos trabajadores que se le conectan por TCP. Cada trabajador carga
+// la misma escena y el mismo fichero de fotones (en la misma ruta, p.ej. un sistema de ficheros
+// compartido), renderiza las teselas que se le asignan de una en una y devuelve sus colores en
+// float. Si un trabajador se desconecta, tarda más de TIEMPO_MAX_TESELA segundos en una tesela
+// o devuelve una tesela que no se le ha asignado, se le desconecta y su tesela vuelve a la cola.
+//
+// Protocolo: cada mensaje es una CabeceraMensaje seguida de <longitud> bytes, en el orden de
+// bytes de la máquina (coordinador y trabajadores deben tener el mismo). Un mensaje más largo de
+// lo que admite su tipo cierra la conexión.
+//   coordinador -> trabajador: TRABAJO (ruta de la escena, ruta de los fotones y asignaciones
+//                              campo=valor, una por línea), TESELA (id, x0, y0, x1, y1), FIN
+//   trabajador -> coordinador: LISTO (escena cargada), RESULTADO (id y colores RGB por filas),
+//                              ERROR (texto)
+enum TipoMensaje : uint32_t {
+    MENSAJE_TRABAJO = 1,
+    MENSAJE_LISTO,
+    MENSAJE_TESELA,
+    MENSAJE_RESULTADO,
+    MENSAJE_FIN,
+    MENSAJE_ERROR
+};
+
+struct CabeceraMensaje {
+    uint32_t tipo;
+    uint32_t longitud;
+};
+
+// Rectángulo de píxeles [x0, x1) x [y0, y1) de la imagen
+struct Tesela {
+    uint32_t id, x0, y0, x1, y1;
+};
+
+// Función que divide una imagen de <ancho> x <alto> píxeles en teselas de <lado> x <lado>
+// (menores en los bordes), por filas
+vector<Tesela> dividirEnTeselas(const unsigned ancho, const unsigned alto, const unsigned lado);
+
+// Función que renderiza de forma distribuida el fichero de escena <rutaEscena> (ver
+// ficheroEscena.h), con las asignaciones campo=valor de <asignaciones> aplicadas a sus
+// parámetros. Escucha en <puerto> y, además de los trabajadores que se conecten desde otras
+// máquinas, lanza <numTrabajadoresLocales> procesos trabajadores con el ejecutable <ejecutable>.
+// Devuelve el código de salida del programa.
+int coordinarRenderDistribuido(const string& rutaEscena, const vector<string>& asignaciones,
+                               const unsigned short puerto, const unsigned numTrabajadoresLocales,
+                               const string& ejecutable);
+
+// Función que conecta como trabajador con el coordinador de <host>:<puerto> y renderiza las
+// teselas que este le asigne hasta recibir FIN. Devuelve el código de salida del programa.
+int ejecutarTrabajador(const string& host, const unsigned short puerto);
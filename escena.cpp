@@ -6,16 +6,42 @@
 //*****************************************************************
 
 #include "escena.h"
+#include "aleatorio.h"
+#include "instrumentacion.h"
 #include <memory>
 
 Escena::Escena(): primitivas(vector<Primitiva*>()) {}
 
 Escena::Escena(vector<Primitiva*> _primitivas, vector<LuzPuntual> _luces):
-               primitivas(_primitivas), luces(_luces) {}
+               primitivas(_primitivas), luces(_luces) {
+    vector<float> potencias;
+    for (const LuzPuntual& luz : luces) {
+        potencias.push_back(modulo(luz.p));
+    }
+    tablaLuces = TablaAlias(potencias);
+
+    vector<float> flujos;
+    for (const LuzPuntual& luz : luces) {
+        flujos.push_back(4 * M_PI * modulo(luz.p));
+    }
+    for (const Primitiva* primitiva : primitivas) {
+        if (!primitiva->soyFuenteDeLuz()) continue;
+
+        // El muestreo por área es uniforme, así que su densidad es la inversa del área
+        float probArea;
+        primitiva->muestrearPuntoArea(0.5f, 0.5f, probArea);
+        if (probArea > 0.0f) {
+            lucesArea.push_back(primitiva);
+            flujos.push_back(M_PI * modulo(primitiva->power) / probArea);
+        }
+    }
+    tablaEmisores = TablaAlias(flujos);
+}
 
 
 bool Escena::interseccion(const Rayo& rayo, Punto& ptoMasCerca, Direccion& normal,
                           Primitiva** objIntersecado) const {
+    CONTAR(RAYOS_TRAZADOS, 1);
     bool resVal = false;
     bool primerIntersec = true;  // Flag: la primera intersección encontrada
 
@@ -52,6 +78,7 @@ bool Escena::puntoPerteneceALuz(const Punto& p0, RGB& powerLuzArea) const {
 }
 
 bool Escena::luzIluminaPunto(const Punto& p0, const LuzPuntual& luz) const {
+    CONTAR(RAYOS_SOMBRA, 1);
     bool iluminar = true;
     Direccion d = normalizar(luz.c - p0);
     Punto ptoMasCerca;
@@ -66,24 +93,23 @@ bool Escena::luzIluminaPunto(const Punto& p0, const LuzPuntual& luz) const {
     return iluminar;
 }
 
-bool Escena::luzIluminaPunto(const Punto& p0, const Primitiva* luz, Punto& origenLuz, float& prob) const {
-    bool iluminar = false;
-    int numIters = NUM_MUESTRAS_LUZ_AREA;     // Tiene que ir en función del tamaño del plano
-    for (int i = 0; i < numIters && !iluminar; ++i) {
-        Punto ptoRandom = luz->generarPuntoAleatorio(prob);
-        Direccion d = normalizar(ptoRandom - p0);
-        Punto ptoMasCerca;
-        Direccion normal;
-        Primitiva* primitiva = nullptr;
-        // Rayo desde punto a iluminar (p0) --> ptoRandom de la luz
-        bool chocaObjeto = this->interseccion(Rayo(d, p0), ptoMasCerca, normal, &primitiva);
-        
-        if (chocaObjeto) {  // Miramos si el objeto más cercano contra el que choca es esa luz en <ptoRandom>
-            iluminar = modulo(ptoRandom - p0) <= modulo(ptoMasCerca - p0);
-            origenLuz = ptoRandom;
-        }
+bool Escena::luzIluminaPunto(const Punto& p0, const Primitiva* luz, const float u1, const float u2,
+                             Punto& origenLuz, float& prob) const {
+    origenLuz = luz->muestrearLuz(p0, u1, u2, prob);
+    if (prob <= 0.0f) {
+        return false;
     }
-    return iluminar;
+    CONTAR(RAYOS_SOMBRA, 1);
+
+    float distLuz = modulo(origenLuz - p0);
+    Direccion d = (origenLuz - p0) / distLuz;
+    Punto ptoMasCerca;
+    Direccion normal;
+    Primitiva* primitiva = nullptr;
+    // Rayo desde punto a iluminar (p0) --> origenLuz. Lo normal es que choque con la propia
+    // luz justo en <origenLuz>, de ahí la tolerancia.
+    bool chocaObjeto = this->interseccion(Rayo(d, p0), ptoMasCerca, normal, &primitiva);
+    return !chocaObjeto || modulo(ptoMasCerca - p0) >= distLuz * (1.0f - MARGEN_ERROR_VISIBILIDAD);
 }
 
 bool Escena::puntoIluminado(const Punto& p0) const {
@@ -93,8 +119,10 @@ bool Escena::puntoIluminado(const Punto& p0) const {
     
     Punto origenLuz;
     float prob;
-    for(auto objeto : this->primitivas) {
-        if (luzIluminaPunto(p0, objeto, origenLuz, prob)) return true;
+    for(const Primitiva* luz : this->lucesArea) {
+        const float u1 = numeroAleatorio();
+        const float u2 = numeroAleatorio();
+        if (luzIluminaPunto(p0, luz, u1, u2, origenLuz, prob)) return true;
     }
     
     return false;
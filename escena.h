@@ -10,6 +10,7 @@
 #include "primitiva.h"
 #include "rgb.h"
 #include "luzpuntual.h"
+#include "tablaAlias.h"
 #include "utilidades.h"
 
 // Clase que representa una escena como un conjunto de objetos geometricos y una
@@ -21,6 +22,19 @@ public:
 
     // Vector de luces puntuales de la escena
     vector<LuzPuntual> luces;        
+
+    // Tabla para elegir una luz de <luces> con probabilidad proporcional a su potencia.
+    // Se construye en el constructor, así que no se actualiza si <luces> cambia después.
+    TablaAlias tablaLuces;
+
+    // Primitivas de <primitivas> que emiten luz y se pueden muestrear (luces de área).
+    // Emiten solo por el lado hacia el que apunta su normal.
+    vector<const Primitiva*> lucesArea;
+
+    // Tabla para elegir desde dónde se emite cada fotón con probabilidad proporcional a la
+    // potencia emitida: los índices [0, luces.size()) son luces puntuales (4 PI |p|) y los
+    // siguientes, las de <lucesArea> en orden (PI * área * |power|).
+    TablaAlias tablaEmisores;
     
     // Constructor base
     Escena();
@@ -45,11 +59,13 @@ public:
     // Método que devuelve "True" si y solo si el punto <p0> es iluminado por la fuente de luz <luz>
     bool luzIluminaPunto(const Punto& p0, const LuzPuntual& luz) const;
     
-    // Método que devuelve "True" si y solo si el punto <p0> es iluminado por la fuente de luz <luz>.
-    // Si devuelve "True", también devuelve en <origenLuz> el punto de origen de la luz desde donde
-    // ilumina al punto <p0>. También devuelve en <prob> la probabilidad de haber elegido el punto
-    // <origenLuz> en caso de que exista.
-    bool luzIluminaPunto(const Punto& p0, const Primitiva* luz, Punto& origenLuz, float& prob) const;
+    // Método que muestrea con (<u1>, <u2>) un punto <origenLuz> de la luz de área <luz> visto
+    // desde <p0> (ver Primitiva::muestrearLuz) y devuelve "True" si y solo si ese punto ilumina
+    // a <p0>, es decir, si es visible desde <p0> y su densidad es válida. Devuelve en <prob> la
+    // densidad de probabilidad de <origenLuz> respecto del ángulo sólido en <p0>. Lanza un
+    // único rayo de sombra.
+    bool luzIluminaPunto(const Punto& p0, const Primitiva* luz, const float u1, const float u2,
+                         Punto& origenLuz, float& prob) const;
     
     // Método que devuelve "True" si y solo si al punto <p0> lo ilumina una fuente de luz.
     // En caso contrario, devuelve False.
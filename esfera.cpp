@@ -6,8 +6,8 @@
 //*****************************************************************
 
 #include <cmath>
-#include <random>
 #include "esfera.h"
+#include "muestreo.h"
 
 
 Esfera::Esfera(): Primitiva(), centro(Punto()), radio(0.0f) {}
@@ -89,27 +89,42 @@ bool Esfera::puntoEsFuenteDeLuz(const Punto& punto) const {
     return soyFuenteDeLuz() && this->pertenece(punto);
 }
 
-Punto Esfera::generarPuntoAleatorio(float& prob) const {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
-    // Genera dos ángulos aleatorios para coordenadas esféricas
-    float theta = acos(2.0f * dist(gen) - 1.0f); // Distribución uniforme en una esfera
-    float phi = 2 * M_PI * dist(gen);
-
-    // Coordenadas esféricas --> cartesianas
-    float x = radio * sin(theta) * cos(phi);
-    float y = radio * sin(theta) * sin(phi);
-    float z = radio * cos(theta);
-
-    Punto puntoAleatorio(this->centro + Punto(x,y,z));
+Punto Esfera::muestrearPuntoArea(const float u1, const float u2, float& prob) const {
+    // Dirección uniforme desde el centro, escalada al radio
+    Punto puntoAleatorio(this->centro.vec() + muestrearEsferaUniforme(u1, u2) * radio);
     float areaSuperficie = 4.0f * M_PI * radio * radio;
     prob = 1.0f / areaSuperficie;
 
     return puntoAleatorio;
 }
 
+Punto Esfera::muestrearLuz(const Punto& ref, const float u1, const float u2, float& prob) const {
+    const Vec3 aCentro = centro.vec() - ref.vec();
+    const float dist2 = modulo2(aCentro);
+    if (dist2 <= radio * radio) {       // <ref> dentro de la esfera: se ve toda la superficie
+        return Primitiva::muestrearLuz(ref, u1, u2, prob);
+    }
+
+    // Cono de semiángulo thetaMax (sin(thetaMax) = radio / dist) alrededor de <aCentro>
+    const float dist = sqrt(dist2);
+    const float sin2ThetaMax = radio * radio / dist2;
+    const float cosThetaMax = sqrt(max(0.0f, 1.0f - sin2ThetaMax));
+    const float cosTheta = 1.0f - u1 + u1 * cosThetaMax;
+    const float sinTheta = sqrt(max(0.0f, 1.0f - cosTheta * cosTheta));
+    float sinPhi, cosPhi;
+    senoCosenoVuelta(u2, sinPhi, cosPhi);
+
+    const Vec3 w = aCentro / dist;
+    Vec3 t1, t2;
+    baseOrtonormal(w, t1, t2);
+    const Vec3 dir = aGlobal({sinTheta * cosPhi, sinTheta * sinPhi, cosTheta}, t1, t2, w);
+
+    // Primer corte de la dirección con la esfera
+    const float distPunto = dist * cosTheta - sqrt(max(0.0f, radio * radio - dist2 * sinTheta * sinTheta));
+    prob = 1.0f / (2 * M_PI * (1.0f - cosThetaMax));
+    return Punto(ref.vec() + dir * distPunto);
+}
+
 float Esfera::getEjeTexturaU(const Punto& pto) const {
     Direccion d = normalizar(pto - this->centro);
     return 0.5 - asin(d.coord[1]) / M_PI;
@@ -51,9 +51,14 @@ public:
     // y además, es un punto lumínico de la esfera.
     bool puntoEsFuenteDeLuz(const Punto& punto) const override;
     
-    // Método que devuelve un punto aleatorio de la esfera en UCS.
-    // También devuelve en <prob> la probabilidad de muestrear dicho punto.
-    Punto generarPuntoAleatorio(float& prob) const override;
+    // Método que devuelve el punto de la esfera que corresponde a la muestra (<u1>, <u2>),
+    // y en <prob> la densidad respecto del área.
+    Punto muestrearPuntoArea(const float u1, const float u2, float& prob) const override;
+
+    // Método que, si <ref> está fuera de la esfera, muestrea uniformemente el cono de
+    // direcciones con las que se ve la esfera desde <ref> y devuelve el punto visible en esa
+    // dirección, con <prob> = 1 / ángulo sólido del cono. Si no, muestrea por área.
+    Punto muestrearLuz(const Punto& ref, const float u1, const float u2, float& prob) const override;
     
     // Método que obtiene la posición del punto <pto> de la esfera en el eje U de la
     // textura correspondiente. Tenemos garantizado que <pto> pertenece al objeto.
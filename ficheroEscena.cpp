@@ -0,0 +1,322 @@
+//*****************************************************************
+// File:   ficheroEscena.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "ficheroEscena.h"
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include "bsdfs.h"
+#include "cuboide.h"
+#include "esfera.h"
+#include "mesh.h"
+#include "plano.h"
+#include "triangulo.h"
+
+using Atributos = std::map<string, string>;
+
+DescripcionRender::DescripcionRender()
+    : parametros(256, 256, 4, 100000, RADIONUMERO, 100, 0.05, RADIONUMERO, 100, 0.025, false, true, false),
+      numThreads(std::max(1u, std::thread::hardware_concurrency())) {}
+
+DescripcionRender::~DescripcionRender() {
+    for (Primitiva* objeto : objetos) {
+        delete objeto;
+    }
+}
+
+// Función que convierte <valor> en float, o lanza invalid_argument
+static float aFloat(const string& clave, const string& valor) {
+    size_t leidos = 0;
+    float res = 0.0f;
+    try {
+        res = std::stof(valor, &leidos);
+    } catch (const std::exception&) {}
+    if (leidos == 0 || leidos != valor.size()) {
+        throw invalid_argument("valor no numérico en " + clave + "=" + valor);
+    }
+    return res;
+}
+
+// Función que convierte <valor> (p.ej. "1,0.5,0") en 3 floats, o lanza invalid_argument
+static array<float, 3> aVector3(const string& clave, const string& valor) {
+    array<float, 3> res;
+    std::stringstream ss(valor);
+    string componente;
+    unsigned i = 0;
+    while (getline(ss, componente, ',')) {
+        if (i == 3) break;
+        res[i++] = aFloat(clave, componente);
+    }
+    if (i != 3 || !ss.eof()) {
+        throw invalid_argument("se esperaban 3 valores separados por comas en " + clave + "=" + valor);
+    }
+    return res;
+}
+
+unsigned long aEntero(const string& clave, const string& valor, const unsigned long minimo,
+                      const unsigned long maximo) {
+    size_t leidos = 0;
+    unsigned long res = 0;
+    try {
+        // stoul admite espacios, signo y "-1" (que daría el máximo), así que se exige un dígito al principio
+        if (!valor.empty() && std::isdigit(static_cast<unsigned char>(valor[0]))) res = std::stoul(valor, &leidos);
+    } catch (const std::exception&) {}
+    if (leidos == 0 || leidos != valor.size()) {
+        throw invalid_argument("se esperaba un entero no negativo en " + clave + "=" + valor);
+    }
+    if (res < minimo || res > maximo) {
+        throw invalid_argument("entero fuera de rango en " + clave + "=" + valor + " (de " + std::to_string(minimo)
+                               + " a " + std::to_string(maximo) + ")");
+    }
+    return res;
+}
+
+// Función que convierte <valor> en un entero no negativo que cabe en <Entero>, o lanza
+// invalid_argument
+template <typename Entero>
+static Entero aEntero(const string& clave, const string& valor) {
+    return static_cast<Entero>(aEntero(clave, valor, 0, std::numeric_limits<Entero>::max()));
+}
+
+// Función que convierte <valor> en booleano (true/false o 1/0), o lanza invalid_argument
+static bool aBool(const string& clave, const string& valor) {
+    if (valor == "true" || valor == "1") return true;
+    if (valor == "false" || valor == "0") return false;
+    throw invalid_argument("valor no booleano en " + clave + "=" + valor);
+}
+
+// Función que devuelve el enumerado de <nombres> cuyo nombre es <valor>, o lanza invalid_argument
+template <typename Enum>
+static Enum aEnum(const string& clave, const string& valor, const std::map<string, Enum>& nombres) {
+    auto it = nombres.find(valor);
+    if (it == nombres.end()) {
+        throw invalid_argument("valor desconocido en " + clave + "=" + valor);
+    }
+    return it->second;
+}
+
+// Función que saca de <atributos> el valor de <clave>. Si no está, devuelve <porDefecto>
+// o, si <obligatorio>, lanza invalid_argument.
+static string extraer(Atributos& atributos, const string& clave, const string& porDefecto = "",
+                      const bool obligatorio = false) {
+    auto it = atributos.find(clave);
+    if (it == atributos.end()) {
+        if (obligatorio) throw invalid_argument("falta el atributo " + clave);
+        return porDefecto;
+    }
+    string valor = it->second;
+    atributos.erase(it);
+    return valor;
+}
+
+static float extraerFloat(Atributos& atributos, const string& clave, const float porDefecto,
+                          const bool obligatorio = false) {
+    string valor = extraer(atributos, clave, "", obligatorio);
+    return valor.empty() ? porDefecto : aFloat(clave, valor);
+}
+
+static array<float, 3> extraerVector3(Atributos& atributos, const string& clave, const array<float, 3>& porDefecto,
+                                      const bool obligatorio = false) {
+    string valor = extraer(atributos, clave, "", obligatorio);
+    return valor.empty() ? porDefecto : aVector3(clave, valor);
+}
+
+// Función que saca el material de <atributos> y comprueba que existe
+static string extraerMaterial(Atributos& atributos, const string& porDefecto) {
+    string material = extraer(atributos, "material", porDefecto);
+    if (!existeMaterial(material)) {
+        throw invalid_argument("material desconocido: " + material);
+    }
+    return material;
+}
+
+void asignarParametro(Parametros& parametros, const string& campo, const string& valor) {
+    static const std::map<string, TipoVecinos> tiposVecinos = {
+        {"RADIO", RADIO}, {"PORCENTAJE", PORCENTAJE}, {"NUMERO", NUMERO},
+        {"RADIONUMERO", RADIONUMERO}, {"ADAPTATIVO", ADAPTATIVO}};
+    static const std::map<string, TipoKernel> kernels = {
+        {"CONSTANTE", CONSTANTE}, {"GAUSSIANO", GAUSSIANO}, {"CONICO", CONICO},
+        {"EPANECHNIKOV", EPANECHNIKOV}, {"BIPESO", BIPESO}, {"LOGISTICO", LOGISTICO}};
+    static const std::map<string, TipoMuestreador> muestreadores = {
+        {"ALEATORIO", ALEATORIO}, {"HALTON", HALTON}, {"SOBOL", SOBOL}};
+    // Asigna <valor> al campo entero <destino>, comprobando que cabe en su tipo
+    auto entero = [&]<typename Entero>(Entero& destino) { destino = aEntero<Entero>(campo, valor); };
+
+    if (campo == "numPxlsAncho") entero(parametros.numPxlsAncho);
+    else if (campo == "numPxlsAlto") entero(parametros.numPxlsAlto);
+    else if (campo == "rpp") entero(parametros.rpp);
+    else if (campo == "numRandomWalks") entero(parametros.numRandomWalks);
+    else if (campo == "tipoVecinosGlobales") parametros.tipoVecinosGlobales = aEnum(campo, valor, tiposVecinos);
+    else if (campo == "vecinosGlobalesNum") entero(parametros.vecinosGlobalesNum);
+    else if (campo == "vecinosGlobalesRadio") parametros.vecinosGlobalesRadio = aFloat(campo, valor);
+    else if (campo == "tipoVecinosCausticos") parametros.tipoVecinosCausticos = aEnum(campo, valor, tiposVecinos);
+    else if (campo == "vecinosCausticosNum") entero(parametros.vecinosCausticosNum);
+    else if (campo == "vecinosCausticosRadio") parametros.vecinosCausticosRadio = aFloat(campo, valor);
+    else if (campo == "nee") parametros.nee = aBool(campo, valor);
+    else if (campo == "luzIndirecta") parametros.luzIndirecta = aBool(campo, valor);
+    else if (campo == "printPixelesProcesados") parametros.printPixelesProcesados = aBool(campo, valor);
+    else if (campo == "profundidadMaxima") entero(parametros.profundidadMaxima);
+    else if (campo == "trazadoWavefront") parametros.trazadoWavefront = aBool(campo, valor);
+    else if (campo == "tamLoteWavefront") entero(parametros.tamLoteWavefront);
+    else if (campo == "kernel") parametros.kernel = aEnum(campo, valor, kernels);
+    else if (campo == "filtroNormal") parametros.filtroNormal = aBool(campo, valor);
+    else if (campo == "grosorDisco") parametros.grosorDisco = aFloat(campo, valor);
+    else if (campo == "numLucesNEE") entero(parametros.numLucesNEE);
+    else if (campo == "muestrasLuzArea") entero(parametros.muestrasLuzArea);
+    else if (campo == "muestreador") parametros.muestreador = aEnum(campo, valor, muestreadores);
+    else if (campo == "semilla") entero(parametros.semilla);
+    else if (campo == "paginasCacheFotones") entero(parametros.paginasCacheFotones);
+    else if (campo == "ordenMorton") parametros.ordenMorton = aBool(campo, valor);
+    else if (campo == "sombreadoDiferido") parametros.sombreadoDiferido = aBool(campo, valor);
+    else if (campo == "toleranciaLOD") parametros.toleranciaLOD = aFloat(campo, valor);
+    else throw invalid_argument("parámetro desconocido: " + campo);
+}
+
+void aplicarAsignaciones(DescripcionRender& descripcion, const vector<string>& asignaciones) {
+    for (const string& asignacion : asignaciones) {
+        size_t igual = asignacion.find('=');
+        const string campo = asignacion.substr(0, igual), valor = asignacion.substr(igual + 1);
+        if (campo == "fotones") {
+            descripcion.fotones = valor;
+        } else {
+            asignarParametro(descripcion.parametros, campo, valor);
+        }
+    }
+}
+
+// Función que añade a <descripcion> el elemento de tipo <tipo> con <atributos>, quitando
+// de <atributos> los que usa
+static void leerElemento(const string& tipo, Atributos& atributos, DescripcionRender& descripcion) {
+    const array<float, 3> blanco = {1.0f, 1.0f, 1.0f}, negro = {0.0f, 0.0f, 0.0f};
+
+    if (tipo == "camara") {
+        Camara& cam = descripcion.camara;
+        cam.o = Punto(extraerVector3(atributos, "o", cam.o.coord));
+        cam.f = Direccion(extraerVector3(atributos, "f", cam.f.coord));
+        cam.u = Direccion(extraerVector3(atributos, "u", cam.u.coord));
+        cam.l = Direccion(extraerVector3(atributos, "l", cam.l.coord));
+
+    } else if (tipo == "plano") {
+        Direccion n(extraerVector3(atributos, "n", negro, true));
+        float d = extraerFloat(atributos, "d", 0.0f, true);
+        RGB color(extraerVector3(atributos, "color", blanco));
+        string material = extraerMaterial(atributos, "difuso");
+        RGB emision(extraerVector3(atributos, "emision", negro));
+        float minLimite = extraerFloat(atributos, "min", -0.5f), maxLimite = extraerFloat(atributos, "max", 0.5f);
+        Punto centro(extraerVector3(atributos, "centro", negro));
+        string textura = extraer(atributos, "textura");
+        array<float, 3> escala = extraerVector3(atributos, "escalaTextura", {1.0f, -1.0f, 0.0f});
+        descripcion.objetos.push_back(new Plano(n, d, color, material, emision, minLimite, maxLimite, centro,
+                                                textura, escala[0], escala[1]));
+
+    } else if (tipo == "esfera") {
+        Punto centro(extraerVector3(atributos, "centro", negro, true));
+        float radio = extraerFloat(atributos, "radio", 0.0f, true);
+        RGB color(extraerVector3(atributos, "color", blanco));
+        string material = extraerMaterial(atributos, "difuso");
+        RGB emision(extraerVector3(atributos, "emision", negro));
+        descripcion.objetos.push_back(new Esfera(centro, radio, color, material, emision,
+                                                 extraer(atributos, "textura")));
+
+    } else if (tipo == "triangulo") {
+        Punto p0(extraerVector3(atributos, "p0", negro, true));
+        Punto p1(extraerVector3(atributos, "p1", negro, true));
+        Punto p2(extraerVector3(atributos, "p2", negro, true));
+        RGB color(extraerVector3(atributos, "color", blanco));
+        string material = extraerMaterial(atributos, "difuso");
+        RGB emision(extraerVector3(atributos, "emision", negro));
+        descripcion.objetos.push_back(new Triangulo(p0, p1, p2, color, material, extraer(atributos, "textura"),
+                                                    emision));
+
+    } else if (tipo == "cuboide") {
+        float tamano = extraerFloat(atributos, "tamano", 0.0f, true);
+        RGB color(extraerVector3(atributos, "color", blanco));
+        descripcion.objetos.push_back(new Cuboide(tamano, color, extraerMaterial(atributos, "muy_difuso")));
+
+    } else if (tipo == "malla") {
+        string ruta = extraer(atributos, "ruta", "", true);
+        string textura = extraer(atributos, "textura");
+        float escala = extraerFloat(atributos, "escala", 1.0f);
+        Punto centro(extraerVector3(atributos, "centro", negro));
+        array<float, 3> rotacion = extraerVector3(atributos, "rotacion", negro);
+        string invertir = extraer(atributos, "invertir");
+        if (invertir.find_first_not_of("xyz") != string::npos) {
+            throw invalid_argument("invertir solo admite los ejes x, y, z: " + invertir);
+        }
+        RGB color(extraerVector3(atributos, "color", blanco));
+        string material = extraerMaterial(atributos, "difuso");
+        RGB emision(extraerVector3(atributos, "emision", negro));
+        descripcion.objetos.push_back(new Mesh(ruta, textura, escala, centro,
+                                               rotacion[0], invertir.find('x') != string::npos,
+                                               rotacion[1], invertir.find('y') != string::npos,
+                                               rotacion[2], invertir.find('z') != string::npos,
+                                               color, material, emision));
+
+    } else if (tipo == "luz") {
+        Punto posicion(extraerVector3(atributos, "posicion", negro, true));
+        descripcion.luces.push_back(LuzPuntual(posicion, RGB(extraerVector3(atributos, "potencia", blanco))));
+
+    } else if (tipo == "parametros") {
+        for (const auto& [campo, valor] : atributos) {
+            asignarParametro(descripcion.parametros, campo, valor);
+        }
+        atributos.clear();
+
+    } else if (tipo == "render") {
+        string threads = extraer(atributos, "threads");
+        if (!threads.empty()) descripcion.numThreads = aEntero<unsigned>("threads", threads);
+        if (descripcion.numThreads < 1) throw invalid_argument("threads debe ser al menos 1");
+        descripcion.salida = extraer(atributos, "salida", descripcion.salida);
+        descripcion.fotones = extraer(atributos, "fotones", descripcion.fotones);
+
+    } else {
+        throw invalid_argument("elemento desconocido: " + tipo);
+    }
+}
+
+void leerFicheroEscena(const string& ruta, DescripcionRender& descripcion) {
+    ifstream fichero(ruta);
+    if (!fichero.is_open()) {
+        throw runtime_error("No se pudo abrir el fichero de escena: " + ruta);
+    }
+    if (descripcion.salida.empty()) {
+        size_t inicio = ruta.find_last_of('/') + 1;     // 0 si no hay directorio
+        descripcion.salida = ruta.substr(inicio, ruta.find_last_of('.') - inicio);
+    }
+
+    string linea;
+    unsigned numLinea = 0;
+    while (getline(fichero, linea)) {
+        numLinea++;
+        std::stringstream ss(linea);
+        string tipo, token;
+        ss >> tipo;
+        if (tipo.empty() || tipo[0] == '#') continue;
+
+        try {
+            Atributos atributos;
+            while (ss >> token) {
+                if (token[0] == '#') break;     // Comentario al final de la línea
+                size_t igual = token.find('=');
+                if (igual == string::npos || igual == 0 || igual + 1 == token.size()) {
+                    throw invalid_argument("se esperaba clave=valor: " + token);
+                }
+                if (!atributos.emplace(token.substr(0, igual), token.substr(igual + 1)).second) {
+                    throw invalid_argument("atributo repetido: " + token.substr(0, igual));
+                }
+            }
+            leerElemento(tipo, atributos, descripcion);
+            if (!atributos.empty()) {
+                throw invalid_argument("atributo desconocido para " + tipo + ": " + atributos.begin()->first);
+            }
+        } catch (const std::exception& e) {
+            throw runtime_error(ruta + ":" + std::to_string(numLinea) + ": " + e.what());
+        }
+    }
+}
@@ -0,0 +1,72 @@
+//*****************************************************************
+// File:   ficheroEscena.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+
+#include <map>
+#include "camara.h"
+#include "luzpuntual.h"
+#include "parametros.h"
+#include "primitiva.h"
+#include "utilidades.h"
+
+// Ficheros de escena: cada línea no vacía que no empiece por '#' es un elemento, formado
+// por su tipo y una lista de atributos clave=valor (los vectores y colores se escriben
+// x,y,z sin espacios). Los atributos que no se indican toman su valor por defecto.
+//
+//   camara     o=  f=  u=  l=
+//   plano      n=  d=  [color= material= emision= min= max= centro= textura= escalaTextura=sx,sy]
+//   esfera     centro=  radio=  [color= material= emision= textura=]
+//   triangulo  p0=  p1=  p2=  [color= material= emision= textura=]
+//   cuboide    tamano=  [color= material=]
+//   malla      ruta=  [textura= escala= centro= rotacion=rx,ry,rz invertir=xyz color= material= emision=]
+//   luz        posicion=  [potencia=]
+//   parametros <campo de Parametros>=<valor> ...     (p.ej. rpp=16 kernel=GAUSSIANO)
+//   render     [threads= salida= fotones=]
+//
+// Las primitivas con emisión son luces de área. Con fotones=<fichero> (de guardarFotones, p.ej.
+// la fusión de varios fragmentos) no se trazan fotones: se usan los del fichero. Ver
+// escenas/cornell.escena.
+
+// Descripción completa de un render leída de un fichero de escena. Es dueña de sus
+// primitivas, que se liberan al destruirla.
+class DescripcionRender {
+public:
+    vector<Primitiva*> objetos;
+    vector<LuzPuntual> luces;
+    Camara camara;
+    Parametros parametros;
+    unsigned numThreads;
+    string salida;      // Nombre de la imagen de salida, sin extensión
+    string fotones;     // Fichero de fotones ya trazados (vacío: se trazan al renderizar)
+
+    // Constructor con la cámara y los parámetros por defecto (los de la caja de Cornell)
+    DescripcionRender();
+
+    DescripcionRender(const DescripcionRender&) = delete;
+    DescripcionRender& operator=(const DescripcionRender&) = delete;
+
+    ~DescripcionRender();
+};
+
+// Función que lee el fichero de escena <ruta> y añade sus elementos a <descripcion>. Si no
+// indica salida, se usa el nombre del fichero sin extensión. Lanza runtime_error con el
+// fichero y la línea si el fichero no existe o tiene un elemento o atributo incorrecto.
+void leerFicheroEscena(const string& ruta, DescripcionRender& descripcion);
+
+// Función que asigna a <parametros> el campo <campo> con el valor <valor> (en texto, los
+// enumerados por su nombre). Lanza invalid_argument si el campo o el valor no son válidos.
+void asignarParametro(Parametros& parametros, const string& campo, const string& valor);
+
+// Función que convierte <valor> en un entero entre <minimo> y <maximo>, escrito solo con
+// dígitos. Lanza invalid_argument, citando <clave>, si no lo es.
+unsigned long aEntero(const string& clave, const string& valor, const unsigned long minimo,
+                      const unsigned long maximo);
+
+// Función que aplica a <descripcion> las asignaciones campo=valor de <asignaciones>: fotones=
+// cambia su fichero de fotones y el resto, sus parámetros (ver asignarParametro).
+// Lanza invalid_argument si alguna no es válida.
+void aplicarAsignaciones(DescripcionRender& descripcion, const vector<string>& asignaciones);
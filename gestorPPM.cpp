@@ -7,6 +7,7 @@
 
 #include "gestorPPM.h"
 #include "toneMapping.h"
+#include "instrumentacion.h"
 #include <algorithm>
 #include <iomanip>
 
@@ -98,6 +99,7 @@ void imprimir_resultados(const vector<float>& valores, float maxColorRes, size_t
 
 bool leerFicheroPPM(const string&nombreFich, vector<float>& valores, float& maxColorRes,
                     size_t& ancho, size_t& alto, float& c) {
+    MEDIR_FASE(FASE_LECTURA_PPM);
     ifstream fichero = abrir_fichero(nombreFich);
     if (!validar_formato(fichero)) {
         return false;
@@ -155,6 +157,7 @@ string encontrarNombreFinalFichero(const string& ruta){
 void escribirFicheroPPM(const string& nombreFich, const vector<float>& valores,
                             const float maxColorRes, const int ancho, const int alto,
                                 const float c, const string& nombreFuncion){
+    MEDIR_FASE(FASE_ESCRITURA_PPM);
     string nombreFichRes = encontrarNombreFinalFichero(nombreFich);
     string rutaFichRes = nombreFich.substr(0, nombreFich.find_last_of(".")) +
                          "_" + nombreFuncion + ".ppm";
@@ -172,6 +175,7 @@ void escribirFicheroPPM(const string& nombreFich, const vector<float>& valores,
 
 
 string transformarValores(vector<float>& valores, const int tipoTransform, const float maxValue){
+    MEDIR_FASE(FASE_TONE_MAPPING);
     string res = "";
     switch (tipoTransform) {
     case 0:     // Misma imagen de entrada y salida
@@ -260,6 +264,7 @@ float maximoValorRGB(const vector<vector<RGB>>& matrizRGB) {
 }
 
 void pintarEscenaEnPPM(const string& nombreArchivo, const vector<vector<RGB>>& imagen) {
+    MEDIR_FASE(FASE_ESCRITURA_PPM);
     ofstream archivo(nombreArchivo);
     if (!archivo) {
         cerr << "Error al abrir el archivo " << nombreArchivo << endl;
@@ -0,0 +1,198 @@
+//*****************************************************************
+// File:   instrumentacion.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "instrumentacion.h"
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* NOMBRE_FASE[NUM_FASES] = {
+    "render", "paso1", "trazado_fotones", "construccion_kdtree", "paso2", "impactos", "sombreado",
+    "tone_mapping", "lectura_ppm", "escritura_ppm"
+};
+
+// Fase que contiene a cada fase (-1: ninguna)
+static const int FASE_PADRE[NUM_FASES] = {
+    -1, FASE_RENDER, FASE_PASO1, FASE_PASO1, FASE_RENDER, FASE_PASO2, FASE_PASO2, FASE_RENDER, FASE_RENDER,
+    FASE_RENDER
+};
+
+static const char* NOMBRE_CONTADOR[NUM_CONTADORES] = {
+    "rayos_trazados", "rayos_sombra", "fotones_globales", "fotones_causticos", "consultas_knn",
+    "fotones_visitados", "paginas_cargadas", "bloqueos_cache_paginas"
+};
+
+static std::atomic<uint64_t> nanosegundosFase[NUM_FASES];
+static std::atomic<uint64_t> llamadasFase[NUM_FASES];
+static std::atomic<uint64_t> contadoresGlobales[NUM_CONTADORES];
+
+// Contadores de un thread, que se vuelcan en los globales cuando el thread termina
+struct ContadoresThread {
+    uint64_t valores[NUM_CONTADORES] = {};
+
+    void volcar() {
+        for (unsigned i = 0; i < NUM_CONTADORES; ++i) {
+            contadoresGlobales[i] += valores[i];
+            valores[i] = 0;
+        }
+    }
+
+    ~ContadoresThread() { volcar(); }
+};
+
+static thread_local ContadoresThread contadoresThread;
+
+void sumarContador(const Contador contador, const uint64_t n) {
+    contadoresThread.valores[contador] += n;
+}
+
+TemporizadorFase::TemporizadorFase(const Fase _fase) : fase(_fase), inicio(std::chrono::steady_clock::now()) {}
+
+TemporizadorFase::~TemporizadorFase() {
+    auto duracion = std::chrono::steady_clock::now() - inicio;
+    nanosegundosFase[fase] += std::chrono::duration_cast<std::chrono::nanoseconds>(duracion).count();
+    llamadasFase[fase]++;
+}
+
+void reiniciarInstrumentacion() {
+    for (unsigned i = 0; i < NUM_FASES; ++i) {
+        nanosegundosFase[i] = 0;
+        llamadasFase[i] = 0;
+    }
+    contadoresThread.volcar();
+    for (unsigned i = 0; i < NUM_CONTADORES; ++i) {
+        contadoresGlobales[i] = 0;
+    }
+}
+
+// Función que escribe en <os> la fase <fase> y, dentro de "fases", sus hijas
+static void escribirFaseJSON(std::ostringstream& os, const unsigned fase, const string& sangria) {
+    os << sangria << "\"" << NOMBRE_FASE[fase] << "\": {\"segundos\": " << nanosegundosFase[fase] / 1e9
+       << ", \"llamadas\": " << llamadasFase[fase];
+    bool primeraHija = true;
+    for (unsigned hija = 0; hija < NUM_FASES; ++hija) {
+        if (FASE_PADRE[hija] != static_cast<int>(fase)) continue;
+        os << (primeraHija ? ", \"fases\": {\n" : ",\n");
+        escribirFaseJSON(os, hija, sangria + "  ");
+        primeraHija = false;
+    }
+    os << (primeraHija ? "}" : "\n" + sangria + "}}");
+}
+
+string informeInstrumentacionJSON() {
+    contadoresThread.volcar();
+    std::ostringstream os;
+    os << "{\n  \"instrumentacion\": "
+#ifdef INSTRUMENTACION
+       << "true"
+#else
+       << "false"
+#endif
+       << ",\n  \"fases\": {\n";
+    bool primera = true;
+    for (unsigned fase = 0; fase < NUM_FASES; ++fase) {
+        if (FASE_PADRE[fase] != -1) continue;
+        if (!primera) os << ",\n";
+        escribirFaseJSON(os, fase, "    ");
+        primera = false;
+    }
+    os << "\n  },\n  \"contadores\": {";
+    for (unsigned i = 0; i < NUM_CONTADORES; ++i) {
+        os << (i > 0 ? ", " : "") << "\"" << NOMBRE_CONTADOR[i] << "\": " << contadoresGlobales[i];
+    }
+    const uint64_t consultas = contadoresGlobales[CONSULTAS_KNN];
+    os << "},\n  \"fotones_visitados_por_consulta\": "
+       << (consultas > 0 ? static_cast<double>(contadoresGlobales[FOTONES_VISITADOS]) / consultas : 0.0)
+       << "\n}\n";
+    return os.str();
+}
+
+void escribirInformeInstrumentacion(const string& ruta) {
+    std::ofstream fichero(ruta);
+    if (!fichero) {
+        cerr << "Error al abrir el archivo " << ruta << endl;
+        return;
+    }
+    fichero << informeInstrumentacionJSON();
+}
+
+#ifdef __linux__
+// Función que abre el contador hardware <config> del thread que la llama, heredado por los
+// threads que cree después, parado. Devuelve su descriptor o -1 si no se puede.
+static int abrirContadorHardware(const uint64_t config) {
+    perf_event_attr atributos = {};
+    atributos.type = PERF_TYPE_HARDWARE;
+    atributos.size = sizeof(atributos);
+    atributos.config = config;
+    atributos.disabled = 1;
+    atributos.inherit = 1;
+    atributos.exclude_kernel = 1;
+    atributos.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &atributos, 0, -1, -1, 0));
+}
+
+ContadoresHardware::ContadoresHardware()
+    : descriptores({abrirContadorHardware(PERF_COUNT_HW_CACHE_MISSES),
+                    abrirContadorHardware(PERF_COUNT_HW_CACHE_REFERENCES),
+                    abrirContadorHardware(PERF_COUNT_HW_INSTRUCTIONS)}) {}
+
+ContadoresHardware::~ContadoresHardware() {
+    for (int fd : descriptores) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+void ContadoresHardware::iniciar() {
+    for (int fd : descriptores) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void ContadoresHardware::parar() {
+    for (int fd : descriptores) {
+        if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+}
+
+uint64_t ContadoresHardware::leer(const unsigned i) const {
+    uint64_t valor = 0;
+    if (descriptores[i] < 0 || read(descriptores[i], &valor, sizeof(valor)) != sizeof(valor)) {
+        return 0;
+    }
+    return valor;
+}
+#else
+ContadoresHardware::ContadoresHardware() : descriptores({-1, -1, -1}) {}
+ContadoresHardware::~ContadoresHardware() {}
+void ContadoresHardware::iniciar() {}
+void ContadoresHardware::parar() {}
+uint64_t ContadoresHardware::leer(const unsigned) const { return 0; }
+#endif
+
+bool ContadoresHardware::disponibles() const {
+    return descriptores[0] >= 0;
+}
+
+uint64_t ContadoresHardware::fallosCache() const {
+    return leer(0);
+}
+
+uint64_t ContadoresHardware::accesosCache() const {
+    return leer(1);
+}
+
+uint64_t ContadoresHardware::instrucciones() const {
+    return leer(2);
+}
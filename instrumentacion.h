@@ -0,0 +1,114 @@
+//*****************************************************************
+// File:   instrumentacion.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include "utilidades.h"
+
+// Instrumentación del render: tiempos por fase y contadores de eventos. Solo se compila con
+// -DINSTRUMENTACION (`make INSTRUMENTACION=1`); sin él, MEDIR_FASE y CONTAR no generan código
+// y el informe sale vacío.
+
+// Fases del render. Cada una tiene una fase padre fija (ver FASE_PADRE en instrumentacion.cpp),
+// de modo que el informe las muestra anidadas.
+enum Fase {
+    FASE_RENDER = 0,
+    FASE_PASO1,
+    FASE_TRAZADO_FOTONES,       // Hija de FASE_PASO1
+    FASE_CONSTRUCCION_KDTREE,   // Hija de FASE_PASO1
+    FASE_PASO2,
+    FASE_IMPACTOS,              // Hija de FASE_PASO2: primera etapa del sombreado diferido
+    FASE_SOMBREADO,             // Hija de FASE_PASO2: segunda etapa del sombreado diferido
+    FASE_TONE_MAPPING,
+    FASE_LECTURA_PPM,
+    FASE_ESCRITURA_PPM,
+    NUM_FASES
+};
+
+// Contadores de eventos. Cada thread acumula en los suyos y los vuelca en los globales al
+// terminar, así que incrementarlos no necesita operaciones atómicas.
+enum Contador {
+    RAYOS_TRAZADOS = 0,         // Intersecciones de un rayo con la escena (incluye los de sombra)
+    RAYOS_SOMBRA,               // Comprobaciones de visibilidad de una luz
+    FOTONES_GLOBALES,           // Fotones guardados en el mapa global
+    FOTONES_CAUSTICOS,          // Fotones guardados en el mapa de cáusticas
+    CONSULTAS_KNN,              // Búsquedas de vecinos en un KD-tree
+    FOTONES_VISITADOS,          // Nodos (fotones) del KD-tree examinados en esas búsquedas
+    PAGINAS_CARGADAS,           // Páginas del mapa de fotones paginado que entran en su caché
+    BLOQUEOS_CACHE_PAGINAS,     // Accesos a la caché compartida (y su mutex) del mapa paginado
+    NUM_CONTADORES
+};
+
+// Función que suma <n> al contador <contador> del thread que la llama
+void sumarContador(const Contador contador, const uint64_t n);
+
+// Clase que, mientras existe, mide el tiempo de la fase <fase> (temporizador con ámbito).
+// Las llamadas anidadas o desde varios threads a la misma fase suman sus tiempos.
+class TemporizadorFase {
+public:
+    explicit TemporizadorFase(const Fase _fase);
+    ~TemporizadorFase();
+
+private:
+    Fase fase;
+    std::chrono::steady_clock::time_point inicio;
+};
+
+#ifdef INSTRUMENTACION
+#define CONCATENAR_INSTRUMENTACION_(a, b) a##b
+#define CONCATENAR_INSTRUMENTACION(a, b) CONCATENAR_INSTRUMENTACION_(a, b)
+#define MEDIR_FASE(fase) TemporizadorFase CONCATENAR_INSTRUMENTACION(temporizador_, __LINE__)(fase)
+#define CONTAR(contador, n) sumarContador((contador), (n))
+#else
+#define MEDIR_FASE(fase) ((void)0)
+#define CONTAR(contador, n) ((void)0)
+#endif
+
+// Función que pone a cero todos los tiempos y contadores (los del thread que la llama incluidos)
+void reiniciarInstrumentacion();
+
+// Función que devuelve en JSON los tiempos de las fases (anidadas según su fase padre) y los
+// contadores acumulados hasta ahora por los threads que ya han terminado y el que la llama
+string informeInstrumentacionJSON();
+
+// Función que escribe informeInstrumentacionJSON() en el fichero <ruta>
+void escribirInformeInstrumentacion(const string& ruta);
+
+// Contadores hardware del procesador leídos con perf_event_open: fallos y accesos a la caché de
+// último nivel e instrucciones, del thread que los crea y de los threads que lance mientras
+// cuentan. No dependen de INSTRUMENTACION. Si el sistema no los da (fuera de Linux, con
+// perf_event_paranoid restrictivo, en muchas máquinas virtuales...), disponibles() es false y
+// todos valen 0.
+class ContadoresHardware {
+public:
+    ContadoresHardware();
+
+    ContadoresHardware(const ContadoresHardware&) = delete;
+    ContadoresHardware& operator=(const ContadoresHardware&) = delete;
+
+    ~ContadoresHardware();
+
+    // Método que indica si se han podido abrir los contadores
+    bool disponibles() const;
+
+    // Método que pone los contadores a cero y empieza a contar
+    void iniciar();
+
+    // Método que deja de contar
+    void parar();
+
+    uint64_t fallosCache() const;
+    uint64_t accesosCache() const;
+    uint64_t instrucciones() const;
+
+private:
+    array<int, 3> descriptores;
+
+    // Método que devuelve el valor del contador <i> (0 si no está abierto)
+    uint64_t leer(const unsigned i) const;
+};
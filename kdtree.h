@@ -4,6 +4,7 @@
 #include <array>
 #include <algorithm>
 #include <cmath>
+#include <type_traits>
 
 namespace nn {
     
@@ -18,6 +19,15 @@ namespace {
         template<typename T>
         constexpr auto operator()(const T& t, std::size_t i) const { return std::get<0>(t)[i]; } 
     };
+    class AcceptAll {
+    public:
+        template<typename T>
+        constexpr bool operator()(const T&) const { return true; }
+    };
+    class IgnoreVisits {
+    public:
+        constexpr void operator()(std::size_t) const {}
+    };
     template <typename> struct is_tuple: std::false_type {};
     template <typename ...T> struct is_tuple<std::tuple<T...>>: std::true_type {};
 };
@@ -37,7 +47,8 @@ public:
    
 private:
     A axis_position;
-    using axis_type = std::size_t; //The axis type is std::size_t but we might want to reduce its size in compile time when N<256...
+    //One byte per node when N<256, so the node array is 8 times smaller than with std::size_t and a query touches fewer cache lines
+    using axis_type = std::conditional_t<(N < 256), unsigned char, std::size_t>;
     //elements and nodes are sorted equally so the element pointed by the ith node in node is the ith element in elements 
     std::vector<axis_type> nodes;
     std::vector<T> elements;
@@ -101,21 +112,30 @@ private:
         build_tree(0,elements.size());
     }
     
-    template<typename Norm> //Norm is a norm of a vector (euclidean or any other one, even a weighted one) for std::array<real,N>
-    void nearest_neighbors_impl(std::vector<const T*>& values, std::size_t left, std::size_t right, const std::array<real,N>& p, std::size_t number, float& max_distance, const Norm& norm) const {
+    template<typename Norm>
+    //Adds element e (already within max_distance of p) to the neighbors of p. Once there are number of them they are kept as a max-heap and max_distance shrinks to the farthest one
+    void insert_neighbor(std::vector<const T*>& values, const T& e, const std::array<real,N>& p, std::size_t number, float& max_distance, const Norm& norm) const {
+        auto distance_comparison = [&] (const T* a, const T* b) { return norm(difference(p,*a))<norm(difference(p,*b)); };
+        values.push_back(&e);
+        if (values.size() == number) { //We reach the number so we make this a heap
+            std::make_heap(values.begin(),values.end(),distance_comparison);
+        } else if (values.size() > number) { //We reached the number a while ago, so we push heap and pop heap
+            std::push_heap(values.begin(),values.end(),distance_comparison);
+            std::pop_heap(values.begin(),values.end(),distance_comparison);
+            values.pop_back();
+            max_distance = norm(difference(p,*values.front())); //We update max_distance so elements further away are just ignored
+        }
+    }
+
+    template<typename Norm, typename Filter, typename Visit> //Norm is a norm of a vector (euclidean or any other one, even a weighted one) for std::array<real,N>
+    //Filter is a predicate over T, elements for which it returns false are never returned (but the tree is still traversed the same way)
+    //Visit is called with the number of nodes examined (e.g. to count them)
+    void nearest_neighbors_impl(std::vector<const T*>& values, std::size_t left, std::size_t right, const std::array<real,N>& p, std::size_t number, float& max_distance, const Norm& norm, const Filter& filter, const Visit& visit) const {
         if (right > left) {
+            visit(1);
             std::size_t median = (right+left)/2; //Points to the actual node which is always in the median
-            auto distance_comparison = [&] (const T* a, const T* b) { return norm(difference(p,*a))<norm(difference(p,*b)); };
-            if (norm(difference(p,elements[median]))<max_distance) {
-                values.push_back(&elements[median]);
-                if (values.size() == number) { //We reach the number so we make this a heap
-                    std::make_heap(values.begin(),values.end(),distance_comparison);
-                } else if (values.size() > number) { //We reached the number a while ago, so we push heap and pop heap
-                    std::push_heap(values.begin(),values.end(),distance_comparison);
-                    std::pop_heap(values.begin(),values.end(),distance_comparison);
-                    values.pop_back();
-                    max_distance = norm(difference(p,*values.front())); //We update max_distance so elements further away are just ignored
-                }
+            if (norm(difference(p,elements[median]))<max_distance && filter(elements[median])) {
+                insert_neighbor(values,elements[median],p,number,max_distance,norm);
             }
             //We have to explore the children, so we choose according to the node
             if ((right-left)>1) {
@@ -123,17 +143,62 @@ private:
                 std::array<real,N> pplane = p; 
                 pplane[nodes[median]] = axis_position(elements[median],nodes[median]);
                 if (p[nodes[median]] < axis_position(elements[median],nodes[median])) {//First left node and then, if needed, right node
-                    nearest_neighbors_impl(values,left,median,p,number,max_distance,norm);
+                    nearest_neighbors_impl(values,left,median,p,number,max_distance,norm,filter,visit);
                     if (norm(difference(p,pplane)) < max_distance) //We still need to explore the other node
-                        nearest_neighbors_impl(values,median+1,right,p,number,max_distance,norm);
+                        nearest_neighbors_impl(values,median+1,right,p,number,max_distance,norm,filter,visit);
                 } else { //First right node and then, if needed, left node
-                    nearest_neighbors_impl(values,median+1,right,p,number,max_distance,norm);
+                    nearest_neighbors_impl(values,median+1,right,p,number,max_distance,norm,filter,visit);
                     if (norm(difference(p,pplane)) < max_distance) //We still need to explore the other node
-                        nearest_neighbors_impl(values,left,median,p,number,max_distance,norm);                      
+                        nearest_neighbors_impl(values,left,median,p,number,max_distance,norm,filter,visit);                      
                 }
             }
         }
     }     
+
+    template<typename Norm, typename Filter, typename Visit> //Filter is a predicate over (index of the point, T)
+    //Same traversal as nearest_neighbors_impl for all the points whose indices are in active[first,last) at once, so each node is read once for all of them.
+    //The lists of points for the children are appended at the end of active and removed afterwards (active works as a stack).
+    //Each point visits the same nodes in the same order as alone, so it gets the same neighbors as with nearest_neighbors.
+    void nearest_neighbors_batch_impl(std::vector<std::vector<const T*>>& values, std::vector<std::size_t>& active, std::size_t first, std::size_t last, std::size_t left, std::size_t right, const std::vector<std::array<real,N>>& points, std::size_t number, std::vector<float>& max_distances, const Norm& norm, const Filter& filter, const Visit& visit) const {
+        if ((last - first) == 1) { //A single point left in this subtree, so there is nothing to share and the lists are not worth it
+            std::size_t q = active[first];
+            nearest_neighbors_impl(values[q],left,right,points[q],number,max_distances[q],norm,
+                [&] (const T& t) { return filter(q,t); },visit);
+        } else if ((right > left) && (last > first)) {
+            visit(last-first);
+            std::size_t median = (right+left)/2;
+            for (std::size_t a = first; a < last; ++a) {
+                std::size_t q = active[a];
+                if (norm(difference(points[q],elements[median]))<max_distances[q] && filter(q,elements[median])) {
+                    insert_neighbor(values[q],elements[median],points[q],number,max_distances[q],norm);
+                }
+            }
+            if ((right-left)>1) {
+                std::size_t axis = nodes[median];
+                real split = axis_position(elements[median],axis);
+                auto left_first = [&] (std::size_t q) { return points[q][axis] < split; };
+                auto needs_other = [&] (std::size_t q) {
+                    std::array<real,N> pplane = points[q];
+                    pplane[axis] = split;
+                    return norm(difference(points[q],pplane)) < max_distances[q];
+                };
+                //First the left node for the points on its side
+                std::size_t start = active.size();
+                for (std::size_t a = first; a < last; ++a) { std::size_t q = active[a]; if (left_first(q)) active.push_back(q); }
+                nearest_neighbors_batch_impl(values,active,start,active.size(),left,median,points,number,max_distances,norm,filter,visit);
+                //Then the right node, first for the points on its side and second for the others if they still need it
+                std::size_t start_right = active.size();
+                for (std::size_t a = start; a < start_right; ++a) { std::size_t q = active[a]; if (needs_other(q)) active.push_back(q); }
+                for (std::size_t a = first; a < last; ++a) { std::size_t q = active[a]; if (!left_first(q)) active.push_back(q); }
+                nearest_neighbors_batch_impl(values,active,start_right,active.size(),median+1,right,points,number,max_distances,norm,filter,visit);
+                active.resize(start);
+                //Finally the left node for the points on the right side that still need it
+                for (std::size_t a = first; a < last; ++a) { std::size_t q = active[a]; if (!left_first(q) && needs_other(q)) active.push_back(q); }
+                nearest_neighbors_batch_impl(values,active,start,active.size(),left,median,points,number,max_distances,norm,filter,visit);
+                active.resize(start);
+            }
+        }
+    }
     
 public:
     KDTree(std::vector<T>&& elements, const A& axis_position = A()) : elements(std::move(elements)), axis_position(axis_position) { build_tree(); }
@@ -141,12 +206,17 @@ public:
     template<typename C> //Constructing from a general collection if possible
     KDTree(const C& c, const A& axis_position = A(), typename std::enable_if<std::is_same<T,typename C::value_type>::value>::type* sfinae = nullptr) : axis_position(axis_position), elements(c.begin(),c.end()) { (void)sfinae; build_tree(); }
     
-    template<typename Norm>
-    std::vector<const T*> nearest_neighbors(const std::array<real,N>& p, std::size_t number, float max_distance, const Norm& norm) const {
+    template<typename Norm, typename Filter, typename Visit = IgnoreVisits> //Visit is called with the number of nodes examined by the search
+    std::vector<const T*> nearest_neighbors(const std::array<real,N>& p, std::size_t number, float max_distance, const Norm& norm, const Filter& filter, const Visit& visit = Visit()) const {
         std::vector<const T*> sol;
-        nearest_neighbors_impl(sol,0,elements.size(),p,number,max_distance,norm);
+        nearest_neighbors_impl(sol,0,elements.size(),p,number,max_distance,norm,filter,visit);
         return sol;
     }
+
+    template<typename Norm>
+    std::vector<const T*> nearest_neighbors(const std::array<real,N>& p, std::size_t number, float max_distance, const Norm& norm) const {
+        return nearest_neighbors(p,number,max_distance,norm,AcceptAll());
+    }
     
 
     std::vector<const T*> nearest_neighbors(const std::array<real,N>& p, std::size_t number = 1, float max_distance = std::numeric_limits<float>::infinity()) const {
@@ -156,6 +226,25 @@ public:
             });            
     }
 
+    //Nearest neighbors of every point in points (the ith vector of the solution for points[i]), each one within max_distances[i] and accepted by filter(i,t).
+    //The points traverse the tree together, so for nearby points (e.g. those seen by a tile of pixels) the top levels are read once for all of them instead of once per point.
+    template<typename Norm, typename Filter, typename Visit = IgnoreVisits>
+    std::vector<std::vector<const T*>> nearest_neighbors_batch(const std::vector<std::array<real,N>>& points, std::size_t number, std::vector<float> max_distances, const Norm& norm, const Filter& filter, const Visit& visit = Visit()) const {
+        std::vector<std::vector<const T*>> sol(points.size());
+        std::vector<std::size_t> active(points.size());
+        for (std::size_t i = 0; i<points.size(); ++i) active[i] = i;
+        nearest_neighbors_batch_impl(sol,active,0,active.size(),0,elements.size(),points,number,max_distances,norm,filter,visit);
+        return sol;
+    }
+
+    std::vector<std::vector<const T*>> nearest_neighbors_batch(const std::vector<std::array<real,N>>& points, std::size_t number = 1, float max_distance = std::numeric_limits<float>::infinity()) const {
+        return nearest_neighbors_batch(points,number,std::vector<float>(points.size(),max_distance),
+            [] (const std::array<real,N>& v) {
+                real s(0); for (real r : v) s+=r*r; return std::sqrt(s);
+            },
+            [] (std::size_t, const T&) { return true; });
+    }
+
     template<typename P, typename Norm> //P -> position N dimensional, should have random access
     std::vector<const T*> nearest_neighbors(const P& p, std::size_t number, float max_distance, const Norm& norm) const {
         std::array<real,N> p_impl;
@@ -170,6 +259,11 @@ public:
                 real s(0); for (real r : v) s+=r*r; return std::sqrt(s);
             });            
     }
+
+protected:
+    //For derived classes that keep their own data per node: the node of the range [left,right) is its median (right+left)/2, as in nearest_neighbors_impl
+    const std::vector<T>& tree_elements() const { return elements; }
+    std::size_t tree_axis(std::size_t node) const { return nodes[node]; }
 };
 
 template<std::size_t N,typename C,typename A>
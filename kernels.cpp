@@ -0,0 +1,51 @@
+//*****************************************************************
+// File:   kernels.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#include "kernels.h"
+
+
+RGB radianciaKernel(const vector<const Photon*>& fotones, const Punto& centro, const TipoKernel tipo,
+                    const float radioMinimo2){
+    switch (tipo) {
+        case CONSTANTE:     return radianciaKernel<KernelConstante>(fotones, centro, radioMinimo2);
+        case CONICO:        return radianciaKernel<KernelConico>(fotones, centro, radioMinimo2);
+        case EPANECHNIKOV:  return radianciaKernel<KernelEpanechnikov>(fotones, centro, radioMinimo2);
+        case BIPESO:        return radianciaKernel<KernelBipeso>(fotones, centro, radioMinimo2);
+        case LOGISTICO:     return radianciaKernel<KernelLogistico>(fotones, centro, radioMinimo2);
+        case GAUSSIANO:
+        default:            return radianciaKernel<KernelGaussiano>(fotones, centro, radioMinimo2);
+    }
+}
+
+void VecinosSoA::cargar(const vector<const Photon*>& fotones, const Punto& centro) {
+    n = fotones.size();
+    const size_t tam = conRelleno(n);
+    if (x.size() < tam) {
+        x.resize(tam);
+        y.resize(tam);
+        z.resize(tam);
+        r.resize(tam);
+        g.resize(tam);
+        b.resize(tam);
+        pesos.resize(tam);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        const Photon& foton = *fotones[i];
+        x[i] = foton.coord[0];
+        y[i] = foton.coord[1];
+        z[i] = foton.coord[2];
+        r[i] = foton.flujo.rgb[0];
+        g[i] = foton.flujo.rgb[1];
+        b[i] = foton.flujo.rgb[2];
+    }
+    for (size_t i = n; i < tam; ++i) {
+        x[i] = centro.coord[0];
+        y[i] = centro.coord[1];
+        z[i] = centro.coord[2];
+        r[i] = g[i] = b[i] = 0.0f;
+    }
+}
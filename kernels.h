@@ -0,0 +1,131 @@
+//*****************************************************************
+// File:   kernels.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+#include <cmath>
+#include <vector>
+#include "photon.h"
+#include "punto.h"
+#include "rgb.h"
+#include "parametros.h"
+#include "simd.h"
+#include "utilidades.h"
+
+// Kernels de estimación de densidad. Cada uno se construye una vez por estimación a partir
+// del radio máximo al cuadrado de los fotones cercanos, y su operator() devuelve el peso de
+// un fotón a distancia al cuadrado <d2>. Las constantes se precalculan en el constructor
+// para que el bucle por fotón no tenga pow ni sqrt (salvo Cónico y Logístico, que dependen
+// de la distancia sin elevar).
+// Los fotones se copian antes a VecinosSoA, de modo que distancias y sumas de flujo se
+// calculan con flotante8 (ver simd.h).
+
+// Kernel Constante: 1 / (PI * r^2)
+struct KernelConstante {
+    float peso;
+    explicit KernelConstante(const float radioMaximo2) : peso(1.0f / (M_PI * radioMaximo2)) {}
+    float operator()(const float) const { return peso; }
+};
+
+// Kernel Gaussiano: e^(-d^2 / (2 r^2)) / (r * sqrt(2 PI))
+struct KernelGaussiano {
+    float cteNormalizacion, factorExp;
+    explicit KernelGaussiano(const float radioMaximo2)
+        : cteNormalizacion(1.0f / std::sqrt(2.0f * M_PI * radioMaximo2)), factorExp(-0.5f / radioMaximo2) {}
+    float operator()(const float d2) const { return cteNormalizacion * std::exp(d2 * factorExp); }
+};
+
+// Kernel Cónico: 1 - d / r
+struct KernelConico {
+    float invRadio;
+    explicit KernelConico(const float radioMaximo2) : invRadio(1.0f / std::sqrt(radioMaximo2)) {}
+    float operator()(const float d2) const { return 1.0f - std::sqrt(d2) * invRadio; }
+};
+
+// Kernel Epanechnikov: 3/4 (1 - d^2 / r^2)
+struct KernelEpanechnikov {
+    float invRadio2;
+    explicit KernelEpanechnikov(const float radioMaximo2) : invRadio2(1.0f / radioMaximo2) {}
+    float operator()(const float d2) const { return 0.75f * (1.0f - d2 * invRadio2); }
+};
+
+// Kernel Bipeso: 15/16 (1 - d^2 / r^2)^2
+struct KernelBipeso {
+    float invRadio2;
+    explicit KernelBipeso(const float radioMaximo2) : invRadio2(1.0f / radioMaximo2) {}
+    float operator()(const float d2) const {
+        float u = 1.0f - d2 * invRadio2;
+        return (15.0f / 16.0f) * u * u;
+    }
+};
+
+// Kernel Logístico: 1 / (e^(d/r) + 2 + e^(-d/r))
+struct KernelLogistico {
+    float invRadio;
+    explicit KernelLogistico(const float radioMaximo2) : invRadio(1.0f / std::sqrt(radioMaximo2)) {}
+    float operator()(const float d2) const {
+        float e = std::exp(std::sqrt(d2) * invRadio);
+        return 1.0f / (e + 2.0f + 1.0f / e);
+    }
+};
+
+// Fotones vecinos de un punto copiados a estructura de arrays (SoA), para que el cálculo de
+// distancias, pesos y flujos recorra floats contiguos de ANCHO_PAQUETE en ANCHO_PAQUETE en vez
+// de saltar por punteros a Photon. Los arrays tienen relleno hasta múltiplo de ANCHO_PAQUETE:
+// los huecos se sitúan en el centro (distancia 0) y con flujo nulo, así que no aportan nada.
+struct VecinosSoA {
+    vector<float> x, y, z, r, g, b;
+
+    // Distancias al cuadrado y después pesos de cada vecino
+    vector<float> pesos;
+
+    // Número de vecinos sin contar el relleno
+    size_t n = 0;
+
+    // Método que copia las posiciones y flujos de <fotones>, rellenando con <centro>
+    void cargar(const vector<const Photon*>& fotones, const Punto& centro);
+};
+
+// Función que devuelve la suma de los flujos de <fotones> ponderados por el kernel <Kernel>,
+// centrado en <centro> y con radio la distancia al fotón más lejano, o la raíz de <radioMinimo2>
+// si es mayor
+template <typename Kernel>
+RGB radianciaKernel(const vector<const Photon*>& fotones, const Punto& centro, const float radioMinimo2 = 0.0f) {
+    thread_local VecinosSoA v;
+    v.cargar(fotones, centro);
+    const size_t tam = conRelleno(v.n);
+
+    const Vec3 c = centro.vec();
+    const flotante8 cx = flotante8{} + c.x, cy = flotante8{} + c.y, cz = flotante8{} + c.z;
+    flotante8 maximo8 = {};
+    for (size_t i = 0; i < tam; i += ANCHO_PAQUETE) {
+        const flotante8 dx = cargar(v.x, i) - cx, dy = cargar(v.y, i) - cy, dz = cargar(v.z, i) - cz;
+        const flotante8 d2 = dx * dx + dy * dy + dz * dz;
+        guardar(v.pesos, i, d2);
+        maximo8 = d2 > maximo8 ? d2 : maximo8;
+    }
+    const float radioMaximo2 = std::max(maximoHorizontal(maximo8), radioMinimo2);
+    if (radioMaximo2 <= 0.0f) {     // Sin fotones o todos en el propio punto: no hay radio
+        return RGB();
+    }
+
+    const Kernel kernel(radioMaximo2);
+    for (size_t i = 0; i < tam; ++i) {      // Bucle sobre floats contiguos: vectorizable
+        v.pesos[i] = kernel(v.pesos[i]);
+    }
+
+    flotante8 sumaR = {}, sumaG = {}, sumaB = {};
+    for (size_t i = 0; i < tam; i += ANCHO_PAQUETE) {
+        const flotante8 w = cargar(v.pesos, i);
+        sumaR += cargar(v.r, i) * w;
+        sumaG += cargar(v.g, i) * w;
+        sumaB += cargar(v.b, i) * w;
+    }
+    return RGB(sumaHorizontal(sumaR), sumaHorizontal(sumaG), sumaHorizontal(sumaB));
+}
+
+// Función que elige una vez la especialización de radianciaKernel correspondiente a <tipo>
+RGB radianciaKernel(const vector<const Photon*>& fotones, const Punto& centro, const TipoKernel tipo,
+                    const float radioMinimo2 = 0.0f);
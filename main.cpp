@@ -9,6 +9,10 @@
 #include <memory>       // para los shared_pointers
 #include <string>
 #include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <cctype>
 #include "base.h"
 #include "punto.h"
 #include "direccion.h"
@@ -25,6 +29,15 @@
 #include "luzpuntual.h"
 #include "photonMapping.h"
 #include "parametros.h"
+#include "mesh.h"
+#include "aleatorio.h"
+#include "photonMap.h"
+#include "kernels.h"
+#include "muestreo.h"
+#include "wavefront.h"
+#include "ficheroEscena.h"
+#include "distribuido.h"
+#include "instrumentacion.h"
 
 
 void comprobarRelacionAspecto(const Camara& camUtilizada, const float ratioPantalla){
@@ -53,10 +66,9 @@ void liberarMemoriaDePrimitivas(vector<Primitiva*>& objetos) {
 // +z = lejos
 // -z = cerca
 
-void cajaDeCornell(){
+// Función que añade a <objetos> y <luces> las primitivas y luces de la caja de Cornell
+void construirCajaDeCornell(vector<Primitiva*>& objetos, vector<LuzPuntual>& luces){
     // ------------------------------ Primitivas base con o sin texturas ------------------------------
-    vector<Primitiva*> objetos;
-    
     objetos.push_back(new Plano({1.0f, 0.0f, 0.0f}, 1.0f, RGB({1.0f, 0.0f, 0.0f}), "muy_difuso")); // plano izquierdo, rojo
     objetos.push_back(new Plano({-1.0f, 0.0f, 0.0f}, 1.0f, RGB({0.0f, 1.0f, 0.0f}), "muy_difuso")); // plano derecho, verde
     objetos.push_back(new Plano({0.0f, 1.0f, 0.0f}, 1.0f, RGB({1.0f, 1.0f, 1.0f}), "muy_difuso")); // plano suelo, blanco
@@ -72,23 +84,123 @@ void cajaDeCornell(){
     
     
     // ------------------------------ Luces puntuales ------------------------------
-    vector<LuzPuntual> luces;
-
     RGB potencia(1.0f, 1.0f, 1.0f);
     luces.push_back(LuzPuntual({0.0f, 0.5f, 0.0f}, potencia));
     //luces.push_back(LuzPuntual({0.0f, 0.0f, -1.0f}, potencia));
     
     // ---------------------------------------------
-    
+}
+
+// Función que devuelve la cámara con la que se ve entera la caja de Cornell (1:1)
+Camara camaraCajaDeCornell(){
+    return Camara({0.0f, 0.0f, -3.5f},
+                  {0.0f, 0.0f, 3.0f},
+                  {0.0f, 1.0f, 0.0f},
+                  {-1.0f, 0.0f, 0.0f});
+}
+
+// Semilla de las entradas y renders de los benchmarks reproducibles
+const uint32_t SEMILLA_BENCHMARK = 839757;
+
+// Punto de la escena visto por el rayo del centro de un pixel, con la normal de la superficie,
+// la dirección del rayo y el objeto intersecado
+struct PuntoVisto {
+    Punto punto;
+    Direccion normal;
+    Direccion direccion;
+    Primitiva* objeto;
+};
+
+// Función que devuelve los puntos de <escena> vistos por el centro de los píxeles de <pixeles>
+// en [<primero>, <ultimo>), en su orden, con <cam> y píxeles de lado <tamanoPorPixel>. Los
+// píxeles cuyo rayo no interseca con nada no aportan ningún punto.
+vector<PuntoVisto> calcularPuntosVistos(const Camara& cam, const Escena& escena, const float tamanoPorPixel,
+                                        const vector<array<unsigned, 2>>& pixeles, const size_t primero,
+                                        const size_t ultimo){
+    vector<PuntoVisto> puntos;
+    for (size_t i = primero; i < ultimo; ++i) {
+        Rayo rayo = cam.obtenerRayoCentroPixel(pixeles[i][0], tamanoPorPixel, pixeles[i][1], tamanoPorPixel);
+        globalizarYNormalizarRayo(rayo, cam.o, cam.f, cam.u, cam.l);
+        PuntoVisto visto;
+        visto.objeto = nullptr;
+        if (escena.interseccion(rayo, visto.punto, visto.normal, &visto.objeto)) {
+            visto.direccion = rayo.d;
+            puntos.push_back(visto);
+        }
+    }
+    return puntos;
+}
+
+// Función que devuelve los píxeles de una imagen de <numPxlsAncho> x <numPxlsAlto> por filas
+vector<array<unsigned, 2>> pixelesPorFilas(const unsigned numPxlsAncho, const unsigned numPxlsAlto){
+    vector<array<unsigned, 2>> pixeles;
+    for (unsigned alto = 0; alto < numPxlsAlto; ++alto) {
+        for (unsigned ancho = 0; ancho < numPxlsAncho; ++ancho) pixeles.push_back({ancho, alto});
+    }
+    return pixeles;
+}
+
+// Caja de Cornell común a los benchmarks: la escena de construirCajaDeCornell vista con
+// camaraCajaDeCornell, parámetros de <numPxls> x <numPxls> píxeles, 1 rpp y <numCaminos>
+// caminos de fotones con la semilla SEMILLA_BENCHMARK, y los puntos vistos por el centro de
+// cada pixel, por filas. Los benchmarks cambian los parámetros que necesiten antes de trazar
+// los fotones con generarMapas. Libera las primitivas al destruirse, así que no se copia.
+class FixtureCornell {
+public:
+    vector<Primitiva*> objetos;
+    Escena escena;
+    Camara cam;
+    Parametros parametros;
+    float tamanoPorPixel;
+    vector<PuntoVisto> puntosVistos;
+
+    // Mapas de fotones, vacíos hasta llamar a generarMapas
+    PhotonMap mapaGlobal, mapaCaustico;
+    size_t numGlobales = 0, numCausticos = 0;
+
+    FixtureCornell(const unsigned numPxls, const int numCaminos):
+            cam(camaraCajaDeCornell()),
+            parametros(numPxls, numPxls, 1, numCaminos, RADIONUMERO, 100, 0.05, RADIONUMERO, 100, 0.025,
+                       false, true, false) {
+        vector<LuzPuntual> luces;
+        construirCajaDeCornell(objetos, luces);
+        escena = Escena(objetos, luces);
+        parametros.semilla = SEMILLA_BENCHMARK;
+        tamanoPorPixel = std::min(cam.calcularAnchoPixel(numPxls), cam.calcularAltoPixel(numPxls));
+        const vector<array<unsigned, 2>> pixeles = pixelesPorFilas(numPxls, numPxls);
+        puntosVistos = calcularPuntosVistos(cam, escena, tamanoPorPixel, pixeles, 0, pixeles.size());
+    }
+
+    FixtureCornell(const FixtureCornell&) = delete;
+    FixtureCornell& operator=(const FixtureCornell&) = delete;
+
+    ~FixtureCornell() {
+        liberarMemoriaDePrimitivas(objetos);
+    }
+
+    // Método que traza los fotones de la escena con los parámetros actuales y construye con
+    // ellos <mapaGlobal> y <mapaCaustico>
+    void generarMapas() {
+        paso1GenerarPhotonMap(mapaGlobal, mapaCaustico, numGlobales, numCausticos, escena, parametros);
+    }
+
+    // Método que devuelve los puntos vistos por los píxeles de <pixeles> en [<primero>, <ultimo>)
+    vector<PuntoVisto> puntosVistosDesde(const vector<array<unsigned, 2>>& pixeles, const size_t primero,
+                                         const size_t ultimo) const {
+        return calcularPuntosVistos(cam, escena, tamanoPorPixel, pixeles, primero, ultimo);
+    }
+};
+
+void cajaDeCornell(){
+    vector<Primitiva*> objetos;
+    vector<LuzPuntual> luces;
+    construirCajaDeCornell(objetos, luces);
     Escena cornell = Escena(objetos, luces);
     
     
     // ------------------------------ Cámaras ------------------------------
     
-    Camara cam = Camara({0.0f, 0.0f, -3.5f},
-                        {0.0f, 0.0f, 3.0f},
-                        {0.0f, 1.0f, 0.0f},
-                        {-1.0f, 0.0f, 0.0f});
+    Camara cam = camaraCajaDeCornell();
 
     Camara cam16_9 = Camara({0.0f, 0.0f, -3.5f},
                         {0.0f, 0.0f, 3.0f},
@@ -140,8 +252,1214 @@ void cajaDeCornell(){
 
 
 
-int main() {
-    int test = 12;
+// Compara el rendimiento (Mrayos/s) del trazado de fotones camino a camino con el
+// trazado wavefront sobre la caja de Cornell, con el mismo número de fotones
+void benchmarkTrazadoFotones(){
+    FixtureCornell cornell(1, 200000);
+    for (bool wavefront : {false, true}) {
+        cout << endl << (wavefront ? "--- Trazado wavefront ---" : "--- Trazado camino a camino ---") << endl;
+        cornell.parametros.trazadoWavefront = wavefront;
+        cornell.generarMapas();
+    }
+}
+
+// Compara la intersección rayo-malla triángulo a triángulo (Triangulo::interseccion) con
+// el kernel SIMD por bloques de Mesh::interseccion, con rayos aleatorios dirigidos al conejo
+void benchmarkInterseccionMalla(){
+    Mesh conejo("modelos/bun_zipper.ply", "", 1.0f);
+    const Punto& centro = conejo.esferaLimite.centro;
+    const float radio = conejo.esferaLimite.radio;
+    cout << "Triangulos: " << conejo.triangulos.size() << ", kernel: " << KERNEL_INTERSECCION_TRIANGULOS << endl;
+
+    const int numRayos = 500;
+    vector<Rayo> rayos;
+    for (int i = 0; i < numRayos; ++i) {
+        Punto origen = centro + generarDireccionAleatoriaEsfera() * (2.0f * radio);
+        Punto objetivo = centro + generarDireccionAleatoriaEsfera() * (0.5f * radio * numeroAleatorio());
+        rayos.push_back(Rayo(normalizar(objetivo - origen), origen));
+    }
+
+    int impactosReferencia = 0, impactosBloques = 0, discrepancias = 0;
+    vector<float> distanciasReferencia(numRayos, -1.0f);
+    auto inicio = std::chrono::steady_clock::now();
+    for (int i = 0; i < numRayos; ++i) {
+        for (const Triangulo& tri : conejo.triangulos) {
+            vector<Punto> ptos;
+            BSDFs coefs;
+            tri.interseccion(rayos[i], ptos, coefs);
+            if (!ptos.empty()) {
+                float dist = modulo(ptos[0] - rayos[i].o);
+                if (distanciasReferencia[i] < 0.0f || dist < distanciasReferencia[i]) distanciasReferencia[i] = dist;
+            }
+        }
+        if (distanciasReferencia[i] >= 0.0f) impactosReferencia++;
+    }
+    std::chrono::duration<double> tReferencia = std::chrono::steady_clock::now() - inicio;
+
+    inicio = std::chrono::steady_clock::now();
+    for (int i = 0; i < numRayos; ++i) {
+        vector<Punto> ptos;
+        BSDFs coefs;
+        conejo.interseccion(rayos[i], ptos, coefs);
+        float dist = ptos.empty() ? -1.0f : modulo(ptos[0] - rayos[i].o);
+        if (!ptos.empty()) impactosBloques++;
+        if (abs(dist - distanciasReferencia[i]) > 1e-4f) discrepancias++;
+    }
+    std::chrono::duration<double> tBloques = std::chrono::steady_clock::now() - inicio;
+
+    cout << "Triangulo a triangulo: " << impactosReferencia << " impactos, "
+         << numRayos / tReferencia.count() << " rayos/s" << endl;
+    cout << "Bloques " << KERNEL_INTERSECCION_TRIANGULOS << ": " << impactosBloques << " impactos, "
+         << numRayos / tBloques.count() << " rayos/s (x" << tReferencia.count() / tBloques.count() << ")" << endl;
+    cout << "Discrepancias: " << discrepancias << endl;
+}
+
+// Renderiza una versión reducida de la caja de Cornell y muestra el tiempo total, para
+// comparar configuraciones de compilación (ver `make benchmark`)
+void benchmarkCornell(){
+    FixtureCornell cornell(128, 200000);
+    const Parametros& parametros = cornell.parametros;
+    cornell.parametros.rpp = 4;
+    const unsigned numThreads = std::max(1u, thread::hardware_concurrency());
+
+    auto inicio = std::chrono::steady_clock::now();
+    renderizarEscenaConThreads(cornell.cam, cornell.escena, "cornell_benchmark", parametros, numThreads);
+    std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - inicio;
+    cout << "Benchmark Cornell (" << parametros.numPxlsAncho << "x" << parametros.numPxlsAlto << ", "
+         << parametros.rpp << " rpp, " << parametros.numRandomWalks << " fotones, " << numThreads
+         << " threads): " << duracion.count() << " s" << endl;
+}
+
+
+// Versión de referencia de radianciaKernel<KernelGaussiano> que recorre los fotones
+// a través de sus punteros, sin copiarlos a VecinosSoA
+RGB radianciaGaussianaPorPunteros(const vector<const Photon*>& fotones, const Punto& centro) {
+    const Vec3 c = centro.vec();
+    float radioMaximo2 = 0.0f;
+    for (const Photon* foton : fotones) {
+        radioMaximo2 = std::max(radioMaximo2, modulo2(vec3(foton->coord) - c));
+    }
+    if (radioMaximo2 <= 0.0f) return RGB();
+
+    const KernelGaussiano kernel(radioMaximo2);
+    RGB radiancia;
+    for (const Photon* foton : fotones) {
+        radiancia += foton->flujo * kernel(modulo2(vec3(foton->coord) - c));
+    }
+    return radiancia;
+}
+
+// Mide el coste por punto de sombreado de la estimación de densidad con k = 100, 500 y
+// 2000 vecinos, con los fotones recorridos por punteros y copiados a VecinosSoA
+void benchmarkEstimacionDensidad(){
+    const int numFotones = 200000, numPuntos = 2000;
+    vector<Photon> fotones;
+    fotones.reserve(numFotones);
+    for (int i = 0; i < numFotones; ++i) {
+        Punto p = Punto(0.0f, 0.0f, 0.0f) + generarDireccionAleatoriaEsfera() * numeroAleatorio();
+        fotones.push_back(Photon(p.coord, generarDireccionAleatoriaEsfera(),
+                                 RGB(numeroAleatorio(), numeroAleatorio(), numeroAleatorio())));
+    }
+    PhotonMap mapa = generarPhotonMap(fotones);
+    cout << "Kernel SIMD de " << ANCHO_PAQUETE << " floats, " << numFotones << " fotones" << endl;
+
+    for (unsigned long k : {100ul, 500ul, 2000ul}) {
+        vector<Punto> puntos;
+        vector<vector<const Photon*>> vecinos(numPuntos);
+        for (int i = 0; i < numPuntos; ++i) {
+            puntos.push_back(Punto(0.0f, 0.0f, 0.0f) + generarDireccionAleatoriaEsfera() * (0.8f * numeroAleatorio()));
+            fotonesCercanosPorNumFotones(mapa, puntos[i].coord, k, vecinos[i]);
+        }
+
+        RGB sumaPunteros, sumaSoA;
+        auto inicio = std::chrono::steady_clock::now();
+        for (int i = 0; i < numPuntos; ++i) {
+            sumaPunteros += radianciaGaussianaPorPunteros(vecinos[i], puntos[i]);
+        }
+        std::chrono::duration<double, std::nano> tPunteros = std::chrono::steady_clock::now() - inicio;
+
+        inicio = std::chrono::steady_clock::now();
+        for (int i = 0; i < numPuntos; ++i) {
+            sumaSoA += radianciaKernel<KernelGaussiano>(vecinos[i], puntos[i]);
+        }
+        std::chrono::duration<double, std::nano> tSoA = std::chrono::steady_clock::now() - inicio;
+
+        cout << "k = " << k << ": punteros " << tPunteros.count() / numPuntos << " ns/punto, SoA "
+             << tSoA.count() / numPuntos << " ns/punto (x" << tPunteros.count() / tSoA.count()
+             << "), diferencia relativa " << modulo(vec3((sumaSoA - sumaPunteros).rgb)) / modulo(vec3(sumaPunteros.rgb))
+             << endl;
+    }
+}
+
+
+// Compara la búsqueda de vecinos RADIONUMERO (radio fijo) con ADAPTATIVO (radio estimado
+// con la rejilla de densidad) en los puntos de la caja de Cornell vistos desde la cámara
+void benchmarkBusquedaVecinos(){
+    FixtureCornell cornell(128, 200000);
+    cornell.generarMapas();
+    const Parametros& parametros = cornell.parametros;
+    const vector<PuntoVisto>& puntos = cornell.puntosVistos;
+
+    for (const bool causticos : {false, true}) {
+        const PhotonMap& mapa = causticos ? cornell.mapaCaustico : cornell.mapaGlobal;
+        const float radio = causticos ? parametros.vecinosCausticosRadio : parametros.vecinosGlobalesRadio;
+        const unsigned long k = causticos ? parametros.vecinosCausticosNum : parametros.vecinosGlobalesNum;
+        if ((causticos ? cornell.numCausticos : cornell.numGlobales) == 0) continue;
+        cout << endl << (causticos ? "--- Mapa caustico ---" : "--- Mapa global ---") << endl;
+        for (const TipoVecinos tipo : {RADIONUMERO, ADAPTATIVO}) {
+            double sumaFotones = 0.0, sumaRadio = 0.0;
+            vector<const Photon*> vecinos;
+            auto inicio = std::chrono::steady_clock::now();
+            for (const PuntoVisto& visto : puntos) {
+                const Punto& p = visto.punto;
+                if (tipo == ADAPTATIVO) {
+                    fotonesCercanosAdaptativo(mapa, p.coord, radio, k, vecinos);
+                } else {
+                    fotonesCercanos(mapa, p.coord, radio, k, vecinos);
+                }
+                float radio2 = 0.0f;
+                for (const Photon* f : vecinos) radio2 = std::max(radio2, modulo2(vec3(f->coord) - p.vec()));
+                sumaFotones += vecinos.size();
+                sumaRadio += std::sqrt(radio2);
+            }
+            std::chrono::duration<double, std::micro> duracion = std::chrono::steady_clock::now() - inicio;
+            cout << (tipo == ADAPTATIVO ? "ADAPTATIVO:  " : "RADIONUMERO: ") << duracion.count() / puntos.size()
+                 << " us/consulta, " << sumaFotones / puntos.size() << " fotones, radio medio "
+                 << sumaRadio / puntos.size() << endl;
+        }
+    }
+}
+
+
+// Compara el coste y el error del NEE sumando todas las luces frente a muestrear unas pocas
+// con la tabla de alias, en la caja de Cornell iluminada por una rejilla de 16x16 luces
+void benchmarkLucesNEE(){
+    vector<Primitiva*> objetos;
+    vector<LuzPuntual> luces;
+    construirCajaDeCornell(objetos, luces);
+    luces.clear();
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < 16; ++j) {
+            float potencia = 0.05f + 0.5f * numeroAleatorio();
+            luces.push_back(LuzPuntual({-0.9f + 1.8f * i / 15.0f, 0.9f, -0.9f + 1.8f * j / 15.0f},
+                                       RGB(potencia, potencia, potencia) / 64.0f));
+        }
+    }
+    Escena cornell = Escena(objetos, luces);
+    const Camara cam = camaraCajaDeCornell();
+
+    const unsigned numPxls = 64;
+    const float tamanoPorPixel = std::min(cam.calcularAnchoPixel(numPxls), cam.calcularAltoPixel(numPxls));
+    const vector<array<unsigned, 2>> pixeles = pixelesPorFilas(numPxls, numPxls);
+    const vector<PuntoVisto> puntos = calcularPuntosVistos(cam, cornell, tamanoPorPixel, pixeles, 0, pixeles.size());
+    cout << luces.size() << " luces, " << puntos.size() << " puntos" << endl;
+
+    vector<RGB> referencia;
+    for (unsigned numLuces : {0u, 1u, 4u, 16u}) {
+        vector<RGB> resultado;
+        auto inicio = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < puntos.size(); ++i) {
+            resultado.push_back(nextEventEstimation(puntos[i].punto, puntos[i].normal, cornell, puntos[i].objeto,
+                                                    numLuces));
+        }
+        std::chrono::duration<double, std::micro> duracion = std::chrono::steady_clock::now() - inicio;
+        if (numLuces == 0) referencia = resultado;
+
+        double media = 0.0, mediaRef = 0.0, error = 0.0;
+        for (size_t i = 0; i < puntos.size(); ++i) {
+            media += modulo(vec3(resultado[i].rgb));
+            mediaRef += modulo(vec3(referencia[i].rgb));
+            error += modulo(vec3((resultado[i] - referencia[i]).rgb));
+        }
+        cout << (numLuces == 0 ? string("Todas las luces") : std::to_string(numLuces) + " luces muestreadas")
+             << ": " << duracion.count() / puntos.size() << " us/punto, media " << media / puntos.size()
+             << " (referencia " << mediaRef / puntos.size() << "), error medio relativo "
+             << error / mediaRef << endl;
+    }
+
+    liberarMemoriaDePrimitivas(objetos);
+}
+
+
+void benchmarkLucesArea(){
+    vector<Primitiva*> objetos;
+    vector<LuzPuntual> luces;
+    construirCajaDeCornell(objetos, luces);
+    luces.clear();
+    delete objetos[3];      // El techo pasa a ser una luz de área de 0.6 x 0.6
+    objetos[3] = new Plano({0.0f, -1.0f, 0.0f}, 1.0f, RGB({1.0f, 1.0f, 1.0f}), "muy_difuso",
+                           RGB(1.0f, 1.0f, 1.0f), -0.3f, 0.3f);
+    Escena cornell = Escena(objetos, luces);
+    const Camara cam = camaraCajaDeCornell();
+
+    const unsigned numPxls = 64;
+    const float tamanoPorPixel = std::min(cam.calcularAnchoPixel(numPxls), cam.calcularAltoPixel(numPxls));
+    const vector<array<unsigned, 2>> pixeles = pixelesPorFilas(numPxls, numPxls);
+    vector<PuntoVisto> puntos = calcularPuntosVistos(cam, cornell, tamanoPorPixel, pixeles, 0, pixeles.size());
+    std::erase_if(puntos, [](const PuntoVisto& visto) { return visto.objeto->soyFuenteDeLuz(); });
+    cout << cornell.lucesArea.size() << " luces de area, " << puntos.size() << " puntos" << endl;
+
+    vector<RGB> referencia;
+    for (unsigned numMuestras : {1024u, 1u, 4u, 16u, 64u}) {
+        vector<RGB> resultado;
+        auto inicio = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < puntos.size(); ++i) {
+            resultado.push_back(nextEventEstimation(puntos[i].punto, puntos[i].normal, cornell, puntos[i].objeto, 0,
+                                                    numMuestras));
+        }
+        std::chrono::duration<double, std::micro> duracion = std::chrono::steady_clock::now() - inicio;
+        if (referencia.empty()) referencia = resultado;
+
+        double media = 0.0, mediaRef = 0.0, error = 0.0;
+        for (size_t i = 0; i < puntos.size(); ++i) {
+            media += modulo(vec3(resultado[i].rgb));
+            mediaRef += modulo(vec3(referencia[i].rgb));
+            error += modulo(vec3((resultado[i] - referencia[i]).rgb));
+        }
+        cout << numMuestras << " muestras por luz: " << duracion.count() / puntos.size() << " us/punto, media "
+             << media / puntos.size() << " (referencia " << mediaRef / puntos.size()
+             << "), error medio relativo " << error / mediaRef << endl;
+    }
+
+    liberarMemoriaDePrimitivas(objetos);
+}
+
+
+// Compara un panel de 8x8 luces puntuales bajo el techo con una única luz de área del mismo
+// tamaño y la misma potencia: trazado de fotones y render reducido (la radiancia media no
+// cuenta el techo, donde las puntuales dejan manchas muy brillantes a 1 cm)
+void benchmarkPanelLuces(){
+    const int numFotones = 30000;
+    const unsigned numPxls = 64;
+    const float ladoPanel = 0.6f;
+    const unsigned lucesLado = 8;
+    const float potenciaLuz = 0.05f;
+    const Camara cam = camaraCajaDeCornell();
+
+    for (bool areaLuz : {false, true}) {
+        vector<Primitiva*> objetos;
+        vector<LuzPuntual> luces;
+        construirCajaDeCornell(objetos, luces);
+        luces.clear();
+        if (areaLuz) {
+            // Potencia de las puntuales: 4 PI p por luz = PI * área * L (la mitad que
+            // emiten hacia arriba la devuelve el techo blanco)
+            float radiancia = 4.0f * potenciaLuz * lucesLado * lucesLado / (ladoPanel * ladoPanel);
+            delete objetos[3];
+            objetos[3] = new Plano({0.0f, -1.0f, 0.0f}, 1.0f, RGB({1.0f, 1.0f, 1.0f}), "muy_difuso",
+                                   RGB(radiancia, radiancia, radiancia), -ladoPanel / 2, ladoPanel / 2);
+        } else {
+            for (unsigned i = 0; i < lucesLado; ++i) {
+                for (unsigned j = 0; j < lucesLado; ++j) {
+                    float x = ladoPanel * ((i + 0.5f) / lucesLado - 0.5f);
+                    float z = ladoPanel * ((j + 0.5f) / lucesLado - 0.5f);
+                    luces.push_back(LuzPuntual({x, 0.99f, z}, RGB(potenciaLuz, potenciaLuz, potenciaLuz)));
+                }
+            }
+        }
+        Escena cornell = Escena(objetos, luces);
+        cout << endl << (areaLuz ? "--- 1 luz de area ---" : "--- " + std::to_string(luces.size()) + " luces puntuales ---") << endl;
+
+        // Kernel constante: normalizado por área, así que la media es comparable con el NEE
+        Parametros parametros(numPxls, numPxls, 1, numFotones, RADIONUMERO, 50, 0.1, RADIONUMERO, 50, 0.05,
+                              true, true, false, PROFUNDIDAD_MAXIMA_CAMINO, false, TAM_LOTE_WAVEFRONT, CONSTANTE);
+        PhotonMap mapaGlobal, mapaCaustico;
+        size_t numGlobales = 0, numCausticos = 0;
+        paso1GenerarPhotonMap(mapaGlobal, mapaCaustico, numGlobales, numCausticos, cornell, parametros);
+
+        float tamanoPorPixel = std::min(cam.calcularAnchoPixel(numPxls), cam.calcularAltoPixel(numPxls));
+        double media = 0.0;
+        unsigned numMedia = 0;
+        auto inicio = std::chrono::steady_clock::now();
+        for (unsigned alto = 0; alto < numPxls; ++alto) {
+            for (unsigned ancho = 0; ancho < numPxls; ++ancho) {
+                Rayo rayo = cam.obtenerRayoCentroPixel(ancho, tamanoPorPixel, alto, tamanoPorPixel);
+                globalizarYNormalizarRayo(rayo, cam.o, cam.f, cam.u, cam.l);
+                RGB radiancia = obtenerRadianciaPixel(rayo, cornell, mapaGlobal, mapaCaustico,
+                                                      numGlobales, numCausticos, parametros);
+                Punto p;
+                Direccion n;
+                Primitiva* obj = nullptr;
+                if (cornell.interseccion(rayo, p, n, &obj) && obj != objetos[3]) {
+                    media += modulo(vec3(radiancia.rgb));
+                    numMedia++;
+                }
+            }
+        }
+        std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - inicio;
+        cout << "Render " << numPxls << "x" << numPxls << ": " << duracion.count() << " s, radiancia media "
+             << media / numMedia << endl;
+
+        liberarMemoriaDePrimitivas(objetos);
+    }
+}
+
+// Función auxiliar que devuelve el error cuadrático medio relativo de <imagen> respecto a <referencia>
+double errorRelativoImagen(const vector<RGB>& imagen, const vector<RGB>& referencia){
+    double error = 0.0, norma = 0.0;
+    for (size_t i = 0; i < imagen.size(); ++i) {
+        error += modulo2(vec3((imagen[i] - referencia[i]).rgb));
+        norma += modulo2(vec3(referencia[i].rgb));
+    }
+    return std::sqrt(error / norma);
+}
+
+// Compara el error frente a número de muestras de los muestreadores ALEATORIO, HALTON y SOBOL
+// en la caja de Cornell: (1) en la estimación de densidad según el número de fotones, con rayos
+// por el centro de cada pixel; (2) en el antialiasing según los rpp, con un mismo mapa de fotones
+void benchmarkMuestreadores(){
+    // Cada variante usa sus propios parámetros, así que del fixture solo se usan la escena y la cámara
+    const unsigned numPxls = 32;
+    const FixtureCornell fixture(numPxls, 0);
+    const Escena& cornell = fixture.escena;
+    const Camara& cam = fixture.cam;
+    const float tamanoPorPixel = fixture.tamanoPorPixel;
+    const std::pair<TipoMuestreador, string> muestreadores[] = {{ALEATORIO, "ALEATORIO"}, {HALTON, "HALTON"},
+                                                                {SOBOL, "SOBOL"}};
+
+    // Imagen con un rayo por el centro de cada pixel (solo depende del mapa de fotones)
+    auto imagenCentros = [&](const Parametros& parametros) {
+        PhotonMap mapaGlobal, mapaCaustico;
+        size_t numGlobales = 0, numCausticos = 0;
+        paso1GenerarPhotonMap(mapaGlobal, mapaCaustico, numGlobales, numCausticos, cornell, parametros);
+        vector<RGB> imagen;
+        for (unsigned alto = 0; alto < numPxls; ++alto) {
+            for (unsigned ancho = 0; ancho < numPxls; ++ancho) {
+                Rayo rayo = cam.obtenerRayoCentroPixel(ancho, tamanoPorPixel, alto, tamanoPorPixel);
+                globalizarYNormalizarRayo(rayo, cam.o, cam.f, cam.u, cam.l);
+                imagen.push_back(obtenerRadianciaPixel(rayo, cornell, mapaGlobal, mapaCaustico,
+                                                       numGlobales, numCausticos, parametros));
+            }
+        }
+        return imagen;
+    };
+    auto parametrosFotones = [&](const int numFotones, const TipoMuestreador tipo) {
+        // Radio fijo (sin límite práctico de vecinos), para que el sesgo no cambie con los fotones
+        return Parametros(numPxls, numPxls, 1, numFotones, RADIONUMERO, 1000000, 0.15, RADIONUMERO, 50, 0.05,
+                          false, true, false, PROFUNDIDAD_MAXIMA_CAMINO, false, TAM_LOTE_WAVEFRONT, CONSTANTE,
+                          false, 0.0f, 0, MUESTRAS_LUZ_AREA, tipo);
+    };
+
+    cout << "--- Estimacion de densidad: error relativo frente a fotones ---" << endl;
+    const vector<RGB> referenciaFotones = imagenCentros(parametrosFotones(256000, SOBOL));
+    for (const auto& [tipo, nombre] : muestreadores) {
+        for (int numFotones : {4000, 16000, 64000}) {
+            vector<RGB> imagen = imagenCentros(parametrosFotones(numFotones, tipo));
+            cout << nombre << ", " << numFotones << " fotones: error " << errorRelativoImagen(imagen, referenciaFotones) << endl;
+        }
+    }
+
+    cout << endl << "--- Antialiasing: error relativo frente a rpp ---" << endl;
+    Parametros parametrosMapa = parametrosFotones(16000, ALEATORIO);
+    parametrosMapa.nee = true;
+    PhotonMap mapaGlobal, mapaCaustico;
+    size_t numGlobales = 0, numCausticos = 0;
+    paso1GenerarPhotonMap(mapaGlobal, mapaCaustico, numGlobales, numCausticos, cornell, parametrosMapa);
+    auto imagenRpp = [&](const unsigned rpp, const TipoMuestreador tipo) {
+        Parametros parametros = parametrosMapa;
+        parametros.rpp = rpp;
+        parametros.muestreador = tipo;
+        vector<RGB> imagen;
+        for (unsigned alto = 0; alto < numPxls; ++alto) {
+            for (unsigned ancho = 0; ancho < numPxls; ++ancho) {
+                imagen.push_back(obtenerRadianciaPixelAntialiasing(cam, cornell, ancho, tamanoPorPixel, alto,
+                                                                   tamanoPorPixel, mapaGlobal, mapaCaustico,
+                                                                   numGlobales, numCausticos, parametros));
+            }
+        }
+        return imagen;
+    };
+    const vector<RGB> referenciaRpp = imagenRpp(256, SOBOL);
+    for (const auto& [tipo, nombre] : muestreadores) {
+        for (unsigned rpp : {1u, 4u, 16u}) {
+            cout << nombre << ", " << rpp << " rpp: error " << errorRelativoImagen(imagenRpp(rpp, tipo), referenciaRpp) << endl;
+        }
+    }
+}
+
+// Compara en direcciones por segundo el muestreo de direcciones anterior (acos y sin/cos de la
+// librería, base ortonormal con rama y normalizaciones) con el de muestreo.h, escalar y por lotes
+void benchmarkMuestreoDirecciones(){
+    const size_t n = 1 << 20;
+    vector<float> u1(conRelleno(n)), u2(conRelleno(n));
+    for (size_t i = 0; i < n; ++i) {
+        u1[i] = numeroAleatorio();
+        u2[i] = numeroAleatorio();
+    }
+    vector<float> x(conRelleno(n)), y(conRelleno(n)), z(conRelleno(n)), prob(conRelleno(n));
+    const Direccion normal = normalizar(Direccion(0.3f, 0.8f, -0.5f));
+    const Vec3 n3 = normal.vec();
+
+    auto medir = [&](const string& nombre, auto&& generar) {
+        auto inicio = std::chrono::steady_clock::now();
+        generar();
+        std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - inicio;
+        double suma = 0.0;      // Para que no se descarte el cálculo
+        for (size_t i = 0; i < n; ++i) suma += x[i] + y[i] + z[i];
+        cout << nombre << ": " << n / duracion.count() / 1e6 << " Mdirecciones/s (suma " << suma / n << ")" << endl;
+    };
+
+    medir("Esfera, acos + sin/cos", [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            float inclinacion = acos(2.0f * u1[i] - 1.0f), azimut = 2 * M_PI * u2[i];
+            x[i] = sin(inclinacion) * cos(azimut);
+            y[i] = sin(inclinacion) * sin(azimut);
+            z[i] = cos(inclinacion);
+        }
+    });
+    medir("Esfera, muestreo.h escalar", [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            Vec3 d = muestrearEsferaUniforme(u1[i], u2[i]);
+            x[i] = d.x;
+            y[i] = d.y;
+            z[i] = d.z;
+        }
+    });
+    medir("Esfera, muestreo.h por lotes", [&]() { muestrearEsferaUniformeLote(n, u1, u2, x, y, z); });
+
+    medir("Hemisferio coseno, acos + sin/cos + construirBaseOrtonormal", [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            float inclinacion = acos(sqrt(1 - u1[i])), azimut = 2 * M_PI * u2[i];
+            Direccion local = normalizar(Direccion(sin(inclinacion) * cos(azimut), sin(inclinacion) * sin(azimut),
+                                                   cos(inclinacion)));
+            Direccion tangente, bitangente;
+            construirBaseOrtonormal(normal, tangente, bitangente);
+            Direccion d = normalizar(tangente * local.coord[0] + bitangente * local.coord[1] + normal * local.coord[2]);
+            x[i] = d.coord[0];
+            y[i] = d.coord[1];
+            z[i] = d.coord[2];
+            prob[i] = cos(inclinacion) / M_PI;
+        }
+    });
+    medir("Hemisferio coseno, muestreo.h escalar", [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            float cosTheta;
+            Vec3 local = muestrearHemisferioCoseno(u1[i], u2[i], cosTheta);
+            Vec3 t, b;
+            baseOrtonormal(n3, t, b);
+            Vec3 d = aGlobal(local, t, b, n3);
+            x[i] = d.x;
+            y[i] = d.y;
+            z[i] = d.z;
+            prob[i] = cosTheta / M_PI;
+        }
+    });
+    medir("Hemisferio coseno, muestreo.h por lotes", [&]() {
+        muestrearHemisferioCosenoLote(n, n3, u1, u2, x, y, z, prob);
+    });
+}
+
+// Resultado de un benchmark de la suite de `make bench`: mediana y mejor valor de varias
+// repeticiones, en <unidad>
+struct ResultadoBenchmark {
+    string nombre;
+    string unidad;
+    bool mayorEsMejor;          // true para ritmos (caminos/s), false para tiempos
+    double mediana, mejor;
+    unsigned repeticiones;
+    double comprobacion = 0.0;  // Valor que depende del resultado calculado, p.ej. la media de la imagen
+};
+
+// Función que ejecuta <medir> una vez de calentamiento y <repeticiones> veces más, y devuelve
+// la mediana y el mejor de los valores que devuelve (en <unidad>)
+template <typename F>
+ResultadoBenchmark medirBenchmark(const string& nombre, const string& unidad, const bool mayorEsMejor,
+                                  const unsigned repeticiones, F&& medir){
+    medir();
+    vector<double> valores;
+    for (unsigned i = 0; i < repeticiones; ++i) valores.push_back(medir());
+    std::sort(valores.begin(), valores.end());
+    ResultadoBenchmark res{nombre, unidad, mayorEsMejor, valores[valores.size() / 2],
+                           mayorEsMejor ? valores.back() : valores.front(), repeticiones};
+    cout << "[bench] " << nombre << ": " << res.mediana << " " << unidad << " (mejor " << res.mejor << ")" << endl;
+    return res;
+}
+
+// Función auxiliar que devuelve los segundos transcurridos desde <inicio>
+double segundosDesde(const std::chrono::steady_clock::time_point& inicio){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+// Función auxiliar que genera <n> rayos desde una esfera de radio 3 * <radio> alrededor de
+// <centro> hacia puntos aleatorios a menos de <radio> / 2 de él
+vector<Rayo> generarRayosHacia(const Punto& centro, const float radio, const int n){
+    vector<Rayo> rayos;
+    for (int i = 0; i < n; ++i) {
+        Punto origen = centro + generarDireccionAleatoriaEsfera() * (3.0f * radio);
+        Punto objetivo = centro + generarDireccionAleatoriaEsfera() * (0.5f * radio * numeroAleatorio());
+        rayos.push_back(Rayo(normalizar(objetivo - origen), origen));
+    }
+    return rayos;
+}
+
+// Función auxiliar que escribe <resultados> como array JSON con la sangría <sangria>
+void escribirResultadosJSON(std::ofstream& fichero, const vector<ResultadoBenchmark>& resultados,
+                            const string& sangria){
+    fichero << "[\n";
+    for (size_t i = 0; i < resultados.size(); ++i) {
+        const ResultadoBenchmark& r = resultados[i];
+        fichero << sangria << "  {\"nombre\": \"" << r.nombre << "\", \"unidad\": \"" << r.unidad
+                << "\", \"mayor_es_mejor\": " << (r.mayorEsMejor ? "true" : "false") << ", \"mediana\": "
+                << r.mediana << ", \"mejor\": " << r.mejor << ", \"repeticiones\": " << r.repeticiones
+                << ", \"comprobacion\": " << r.comprobacion << "}" << (i + 1 < resultados.size() ? "," : "") << "\n";
+    }
+    fichero << sangria << "]";
+}
+
+// Suite de benchmarks reproducibles (`make bench`): micro-benchmarks de las partes críticas
+// (intersección con cada primitiva y con una malla, construcción del KD-tree y búsqueda de
+// vecinos a varios tamaños, estimación de densidad, trazado de fotones y escritura de PPM) y
+// macro-benchmarks de la caja de Cornell con semilla fija y varios números de fotones.
+// Escribe los resultados en JSON en <rutaSalida>, etiquetados con <etiqueta> (p.ej. el commit),
+// para poder comparar versiones. Las entradas se generan con la semilla SEMILLA_BENCHMARK; los
+// renders solo son idénticos entre ejecuciones con el mismo número de threads.
+void suiteBenchmarks(const string& rutaSalida, const string& etiqueta){
+    const unsigned REPETICIONES_MICRO = 5, REPETICIONES_MACRO = 3;
+    const unsigned numThreads = std::max(1u, thread::hardware_concurrency());
+    sembrarGeneradorThread(SEMILLA_BENCHMARK);
+    vector<ResultadoBenchmark> micro, macro;
+    volatile double sumidero = 0.0;     // Para que no se descarten los cálculos medidos
+
+    // Intersección rayo-primitiva por la interfaz virtual
+    const int numRayos = 100000;
+    vector<Rayo> rayos = generarRayosHacia(Punto(0.0f, 0.0f, 0.0f), 1.0f, numRayos);
+    Plano plano({0.0f, 0.0f, -1.0f}, 0.0f, RGB({1.0f, 1.0f, 1.0f}), "muy_difuso");
+    Esfera esfera({0.0f, 0.0f, 0.0f}, 0.5f, RGB({1.0f, 1.0f, 1.0f}), "muy_difuso");
+    Triangulo triangulo({-0.5f, -0.5f, 0.0f}, {0.5f, -0.5f, 0.0f}, {0.0f, 0.5f, 0.0f});
+    const std::pair<const Primitiva*, string> primitivas[] = {{&plano, "interseccion_plano"},
+                                                              {&esfera, "interseccion_esfera"},
+                                                              {&triangulo, "interseccion_triangulo"}};
+    for (const auto& [primitiva, nombre] : primitivas) {
+        micro.push_back(medirBenchmark(nombre, "ns/rayo", false, REPETICIONES_MICRO, [&]() {
+            vector<Punto> ptos;
+            BSDFs coefs;
+            auto inicio = std::chrono::steady_clock::now();
+            for (const Rayo& rayo : rayos) {
+                ptos.clear();
+                primitiva->interseccion(rayo, ptos, coefs);
+                sumidero = sumidero + ptos.size();
+            }
+            return segundosDesde(inicio) * 1e9 / numRayos;
+        }));
+    }
+
+    Mesh conejo("modelos/bun_zipper.ply", "", 1.0f);
+    const int numRayosMalla = 5000;
+    vector<Rayo> rayosMalla = generarRayosHacia(conejo.esferaLimite.centro, conejo.esferaLimite.radio, numRayosMalla);
+    micro.push_back(medirBenchmark("interseccion_malla_conejo", "ns/rayo", false, REPETICIONES_MICRO, [&]() {
+        vector<Punto> ptos;
+        BSDFs coefs;
+        auto inicio = std::chrono::steady_clock::now();
+        for (const Rayo& rayo : rayosMalla) {
+            ptos.clear();
+            conejo.interseccion(rayo, ptos, coefs);
+            sumidero = sumidero + ptos.size();
+        }
+        return segundosDesde(inicio) * 1e9 / numRayosMalla;
+    }));
+
+    // KD-tree: construcción y búsqueda de los 100 vecinos más cercanos a varios tamaños
+    for (int numFotones : {10000, 100000, 1000000}) {
+        vector<Photon> fotones;
+        fotones.reserve(numFotones);
+        for (int i = 0; i < numFotones; ++i) {
+            Punto p = Punto(0.0f, 0.0f, 0.0f) + generarDireccionAleatoriaEsfera() * numeroAleatorio();
+            fotones.push_back(Photon(p.coord, generarDireccionAleatoriaEsfera(),
+                                     RGB(numeroAleatorio(), numeroAleatorio(), numeroAleatorio())));
+        }
+        string sufijo = "_";
+        sufijo += std::to_string(numFotones);
+        PhotonMap mapa;
+        micro.push_back(medirBenchmark("construccion_kdtree" + sufijo, "ms", false, REPETICIONES_MICRO, [&]() {
+            vector<Photon> copia = fotones;
+            auto inicio = std::chrono::steady_clock::now();
+            mapa = generarPhotonMap(copia);
+            return segundosDesde(inicio) * 1e3;
+        }));
+
+        const int numConsultas = 2000;
+        vector<Punto> puntos;
+        for (int i = 0; i < numConsultas; ++i) {
+            puntos.push_back(Punto(0.0f, 0.0f, 0.0f) + generarDireccionAleatoriaEsfera() * (0.8f * numeroAleatorio()));
+        }
+        micro.push_back(medirBenchmark("knn_k100" + sufijo, "ns/consulta", false, REPETICIONES_MICRO, [&]() {
+            vector<const Photon*> vecinos;
+            auto inicio = std::chrono::steady_clock::now();
+            for (const Punto& p : puntos) {
+                fotonesCercanosPorNumFotones(mapa, p.coord, 100, vecinos);
+                sumidero = sumidero + vecinos.size();
+            }
+            return segundosDesde(inicio) * 1e9 / numConsultas;
+        }));
+
+        // Estimación de densidad sobre los vecinos ya encontrados (solo en el mapa mediano)
+        if (numFotones != 100000) continue;
+        for (unsigned long k : {100ul, 500ul}) {
+            vector<vector<const Photon*>> vecinos(numConsultas);
+            for (int i = 0; i < numConsultas; ++i) {
+                fotonesCercanosPorNumFotones(mapa, puntos[i].coord, k, vecinos[i]);
+            }
+            string nombre = "kernel_gaussiano_k";
+            nombre += std::to_string(k);
+            micro.push_back(medirBenchmark(nombre, "ns/punto", false, REPETICIONES_MICRO, [&]() {
+                RGB suma;
+                auto inicio = std::chrono::steady_clock::now();
+                for (int i = 0; i < numConsultas; ++i) {
+                    suma += radianciaKernel(vecinos[i], puntos[i], GAUSSIANO);
+                }
+                sumidero = sumidero + suma.rgb[0];
+                return segundosDesde(inicio) * 1e9 / numConsultas;
+            }));
+        }
+    }
+
+    // Trazado de fotones en un solo thread, camino a camino y wavefront
+    FixtureCornell fixture(128, 0);
+    const Escena& cornell = fixture.escena;
+    const EscenaSoA cornellSoA(cornell);
+    const int numCaminos = 20000;
+    for (bool wavefront : {false, true}) {
+        Parametros parametros(1, 1, 1, numCaminos, RADIONUMERO, 100, 0.05, RADIONUMERO, 100, 0.025,
+                              false, true, false, PROFUNDIDAD_MAXIMA_CAMINO, wavefront);
+        micro.push_back(medirBenchmark(wavefront ? "trazado_fotones_wavefront" : "trazado_fotones_camino",
+                                       "caminos/s", true, REPETICIONES_MICRO, [&]() {
+            vector<Photon> globales, causticos;
+            unsigned long rayosTrazados = 0;
+            auto inicio = std::chrono::steady_clock::now();
+            int caminos = wavefront
+                ? lanzarFotonesWavefront(globales, causticos, numCaminos, numCaminos, cornell, cornellSoA,
+                                         parametros, rayosTrazados)
+                : lanzarFotones(globales, causticos, numCaminos, numCaminos, cornell, parametros, rayosTrazados);
+            return caminos / segundosDesde(inicio);
+        }));
+    }
+
+    // Escritura de una imagen de 512x512
+    vector<vector<RGB>> imagen(512, vector<RGB>(512));
+    for (auto& fila : imagen) {
+        for (RGB& pixel : fila) pixel = RGB(numeroAleatorio(), numeroAleatorio(), numeroAleatorio());
+    }
+    micro.push_back(medirBenchmark("escritura_ppm_512", "ms", false, REPETICIONES_MICRO, [&]() {
+        auto inicio = std::chrono::steady_clock::now();
+        pintarEscenaEnPPM("./bench_escritura.ppm", imagen);
+        return segundosDesde(inicio) * 1e3;
+    }));
+    std::remove("./bench_escritura.ppm");
+
+    // Caja de Cornell completa con semilla fija; la comprobación es la media de la imagen HDR
+    fixture.parametros.rpp = 4;
+    for (int numFotones : {50000, 200000}) {
+        fixture.parametros.numRandomWalks = numFotones;
+        string nombre = "cornell_128x128_4rpp_";
+        nombre += std::to_string(numFotones);
+        ResultadoBenchmark res = medirBenchmark(nombre, "s", false, REPETICIONES_MACRO, [&]() {
+            auto inicio = std::chrono::steady_clock::now();
+            renderizarEscenaConThreads(fixture.cam, cornell, "bench_cornell", fixture.parametros, numThreads);
+            return segundosDesde(inicio);
+        });
+        vector<float> valores;
+        float maxColorRes, c;
+        size_t ancho, alto;
+        if (leerFicheroPPM("./bench_cornell.ppm", valores, maxColorRes, ancho, alto, c) && !valores.empty()) {
+            double suma = 0.0;
+            for (float v : valores) suma += v;
+            res.comprobacion = suma / valores.size();
+        }
+        macro.push_back(res);
+    }
+    std::remove("./bench_cornell.ppm");
+    std::remove("./bench_cornell_5_Gamma+Clamp.ppm");
+
+    std::ofstream fichero(rutaSalida);
+    if (!fichero) {
+        cerr << "Error al abrir el archivo " << rutaSalida << endl;
+        return;
+    }
+    fichero << "{\n  \"etiqueta\": \"" << etiqueta << "\",\n"
+            << "  \"compilador\": \"" << __VERSION__ << "\",\n"
+#ifdef __OPTIMIZE__
+            << "  \"optimizado\": true,\n"
+#else
+            << "  \"optimizado\": false,\n"
+#endif
+            << "  \"kernel_interseccion\": \"" << KERNEL_INTERSECCION_TRIANGULOS << "\",\n"
+            << "  \"threads\": " << numThreads << ",\n"
+            << "  \"semilla\": " << SEMILLA_BENCHMARK << ",\n"
+            << "  \"micro\": ";
+    escribirResultadosJSON(fichero, micro, "  ");
+    fichero << ",\n  \"macro\": ";
+    escribirResultadosJSON(fichero, macro, "  ");
+    fichero << "\n}\n";
+    cout << "Resultados guardados en " << rutaSalida << endl;
+}
+
+// Compara el recorrido de los píxeles por filas con el de teselas en orden Morton
+// (ordenPixelesMorton) sobre la caja de Cornell: tiempo y fallos de caché (contadores hardware,
+// si el sistema los da) de las búsquedas de vecinos en los puntos vistos por cada pixel y del
+// sombreado completo de cada pixel, en un solo thread
+void benchmarkOrdenMorton(){
+    FixtureCornell cornell(192, 500000);
+    cornell.generarMapas();
+    const Parametros& parametros = cornell.parametros;
+
+    ContadoresHardware contadores;
+    if (!contadores.disponibles()) {
+        cout << "Contadores hardware no disponibles en este sistema: solo se miden tiempos" << endl;
+    }
+    auto informe = [&](const string& nombre, const double segundos, const size_t n) {
+        cout << nombre << segundos * 1e6 / n << " us/pixel";
+        if (contadores.disponibles()) {
+            cout << ", " << static_cast<double>(contadores.fallosCache()) / n << " fallos de cache/pixel ("
+                 << 100.0 * contadores.fallosCache() / std::max<uint64_t>(1, contadores.accesosCache())
+                 << "% de los accesos), " << static_cast<double>(contadores.instrucciones()) / n << " instrucciones/pixel";
+        }
+        cout << endl;
+    };
+
+    for (const bool morton : {false, true}) {
+        cout << endl << (morton ? "--- Teselas en orden Morton ---" : "--- Por filas ---") << endl;
+        vector<array<unsigned, 2>> pixeles;
+        if (morton) {
+            vector<size_t> inicioTesela;
+            pixeles = ordenPixelesMorton(parametros.numPxlsAncho, parametros.numPxlsAlto, TAM_TESELA_MORTON,
+                                         inicioTesela);
+        } else {
+            pixeles = pixelesPorFilas(parametros.numPxlsAncho, parametros.numPxlsAlto);
+        }
+
+        // Búsquedas de vecinos en los puntos vistos, calculados antes para medir solo las búsquedas
+        const vector<PuntoVisto> puntos = cornell.puntosVistosDesde(pixeles, 0, pixeles.size());
+        vector<const Photon*> vecinos;
+        double sumaFotones = 0.0;
+        auto inicio = std::chrono::steady_clock::now();
+        contadores.iniciar();
+        for (const PuntoVisto& visto : puntos) {
+            fotonesCercanos(cornell.mapaGlobal, visto.punto.coord, parametros.vecinosGlobalesRadio,
+                            parametros.vecinosGlobalesNum, vecinos);
+            sumaFotones += vecinos.size();
+        }
+        contadores.parar();
+        informe("Busqueda de vecinos: ", segundosDesde(inicio), puntos.size());
+        cout << "  (" << sumaFotones / puntos.size() << " fotones por consulta)" << endl;
+
+        // Sombreado completo de cada pixel (NEE, rebotes especulares y estimación de densidad)
+        sembrarThread(parametros, 2, 0);
+        RGB suma;
+        inicio = std::chrono::steady_clock::now();
+        contadores.iniciar();
+        for (const array<unsigned, 2>& pixel : pixeles) {
+            suma = suma + obtenerColorPixel(cornell.cam, cornell.escena, pixel[0], pixel[1], cornell.tamanoPorPixel,
+                                            cornell.mapaGlobal, cornell.mapaCaustico, cornell.numGlobales,
+                                            cornell.numCausticos, parametros);
+        }
+        contadores.parar();
+        informe("Sombreado:           ", segundosDesde(inicio), pixeles.size());
+        cout << "  (radiancia media " << (suma.rgb[0] + suma.rgb[1] + suma.rgb[2]) / (3.0 * pixeles.size()) << ")" << endl;
+    }
+}
+
+// Compara las búsquedas de vecinos una a una con las búsquedas en lote (fotonesCercanosEnLote)
+// de los puntos vistos por cada tesela de píxeles, con teselas de varios tamaños recorridas en
+// orden Morton, sin y con el filtro por normal. Comprueba que ambas dan los mismos fotones.
+void benchmarkBusquedaEnLote(){
+    FixtureCornell cornell(256, 500000);
+    cornell.generarMapas();
+    const Parametros& parametros = cornell.parametros;
+    const PhotonMap& mapaGlobal = cornell.mapaGlobal;
+    const float radio = parametros.vecinosGlobalesRadio;
+    const unsigned long k = parametros.vecinosGlobalesNum;
+    const unsigned REPETICIONES = 3;
+
+    for (const unsigned lado : {8u, 16u, 32u}) {
+        // Puntos vistos (y su filtro) de cada tesela, en orden Morton
+        vector<size_t> inicioTesela;
+        const vector<array<unsigned, 2>> pixeles = ordenPixelesMorton(parametros.numPxlsAncho, parametros.numPxlsAlto,
+                                                                      lado, inicioTesela);
+        vector<vector<array<float, 3>>> puntos(inicioTesela.size() - 1);
+        vector<vector<FiltroFotones>> filtros(inicioTesela.size() - 1);
+        size_t numPuntos = 0;
+        for (size_t t = 0; t + 1 < inicioTesela.size(); ++t) {
+            for (const PuntoVisto& visto : cornell.puntosVistosDesde(pixeles, inicioTesela[t], inicioTesela[t + 1])) {
+                puntos[t].push_back(visto.punto.coord);
+                const Vec3 normal = normalizar(visto.normal.vec());
+                filtros[t].push_back({visto.punto.vec(), dot(normal, visto.direccion.vec()) > 0.0f ? -normal : normal,
+                                      0.0f});
+                ++numPuntos;
+            }
+        }
+
+        cout << endl << "--- Teselas de " << lado << "x" << lado << " ---" << endl;
+        for (const bool conFiltro : {false, true}) {
+            // Se queda el mejor tiempo de cada variante entre REPETICIONES repeticiones
+            vector<vector<const Photon*>> unoAUno, enLote;
+            double segundosUnoAUno = std::numeric_limits<double>::max();
+            double segundosEnLote = std::numeric_limits<double>::max();
+            for (unsigned r = 0; r < REPETICIONES; ++r) {
+                unoAUno.assign(numPuntos, {});
+                size_t j = 0;
+                auto inicio = std::chrono::steady_clock::now();
+                for (size_t t = 0; t < puntos.size(); ++t) {
+                    for (size_t i = 0; i < puntos[t].size(); ++i, ++j) {
+                        fotonesCercanos(mapaGlobal, puntos[t][i], radio, k, unoAUno[j], conFiltro ? &filtros[t][i] : nullptr);
+                    }
+                }
+                segundosUnoAUno = std::min(segundosUnoAUno, segundosDesde(inicio));
+
+                enLote.clear();
+                vector<vector<const Photon*>> lote;
+                inicio = std::chrono::steady_clock::now();
+                for (size_t t = 0; t < puntos.size(); ++t) {
+                    fotonesCercanosEnLote(mapaGlobal, puntos[t], radio, k, lote, conFiltro ? &filtros[t] : nullptr);
+                    for (vector<const Photon*>& vecinos : lote) enLote.push_back(std::move(vecinos));
+                }
+                segundosEnLote = std::min(segundosEnLote, segundosDesde(inicio));
+            }
+
+            size_t distintos = 0;
+            for (size_t i = 0; i < numPuntos; ++i) {
+                std::sort(unoAUno[i].begin(), unoAUno[i].end());
+                std::sort(enLote[i].begin(), enLote[i].end());
+                if (unoAUno[i] != enLote[i]) ++distintos;
+            }
+            cout << (conFiltro ? "Con filtro: " : "Sin filtro: ")
+                 << "uno a uno " << segundosUnoAUno * 1e6 / numPuntos << " us/punto, en lote "
+                 << segundosEnLote * 1e6 / numPuntos << " us/punto (x" << segundosUnoAUno / segundosEnLote << ")";
+            if (distintos > 0) {
+                cout << ", " << distintos << " busquedas con resultados distintos";
+            }
+            cout << endl;
+        }
+    }
+}
+
+// Compara el sombreado pixel a pixel (obtenerColorPixel) con el sombreado diferido sobre la caja
+// de Cornell, en un solo thread y con las teselas de ordenPixelesMorton: mide por separado la
+// generación de impactos y su sombreado (vecinos en lote y NEE), por teselas y con la imagen
+// entera como un único lote
+void benchmarkSombreadoDiferido(){
+    // El mapa de fotones no depende de los rpp, así que se traza una sola vez
+    FixtureCornell fixture(192, 500000);
+    fixture.parametros.nee = true;
+    fixture.generarMapas();
+    const Escena& cornell = fixture.escena;
+    const Camara& cam = fixture.cam;
+    const float tamanoPorPixel = fixture.tamanoPorPixel;
+    const Parametros& parametros = fixture.parametros;
+    vector<size_t> inicioTesela;
+    const vector<array<unsigned, 2>> pixeles = ordenPixelesMorton(parametros.numPxlsAncho, parametros.numPxlsAlto,
+                                                                  TAM_TESELA_MORTON, inicioTesela);
+    auto radianciaMedia = [&](const vector<RGB>& colores) {
+        double suma = 0.0;
+        for (const RGB& c : colores) suma += c.rgb[0] + c.rgb[1] + c.rgb[2];
+        return suma / (3.0 * colores.size());
+    };
+
+    for (const unsigned rpp : {1u, 4u}) {
+        fixture.parametros.rpp = rpp;
+        cout << endl << "--- " << rpp << " rpp ---" << endl;
+        vector<RGB> colores(pixeles.size());
+        auto inicio = std::chrono::steady_clock::now();
+        for (size_t t = 0; t + 1 < inicioTesela.size(); ++t) {
+            sembrarThread(parametros, 2, t);
+            for (size_t i = inicioTesela[t]; i < inicioTesela[t + 1]; ++i) {
+                colores[i] = obtenerColorPixel(cam, cornell, pixeles[i][0], pixeles[i][1], tamanoPorPixel,
+                                               fixture.mapaGlobal, fixture.mapaCaustico, fixture.numGlobales,
+                                               fixture.numCausticos, parametros);
+            }
+        }
+        cout << "Pixel a pixel:         " << segundosDesde(inicio) * 1e6 / pixeles.size()
+             << " us/pixel (radiancia media " << radianciaMedia(colores) << ")" << endl;
+
+        // Diferido con lotes de TAM_TESELA_MORTON x TAM_TESELA_MORTON píxeles o de la imagen entera
+        for (const bool imagenEntera : {false, true}) {
+            double segundosImpactos = 0.0, segundosSombreado = 0.0;
+            size_t numImpactos = 0;
+            vector<RGB> sumas(pixeles.size(), RGB(0.0f, 0.0f, 0.0f));
+            vector<ImpactoDifuso> impactos;
+            const size_t numLotes = imagenEntera ? 1 : inicioTesela.size() - 1;
+            for (size_t t = 0; t < numLotes; ++t) {
+                sembrarThread(parametros, 2, t);
+                const size_t primero = imagenEntera ? 0 : inicioTesela[t];
+                const size_t ultimo = imagenEntera ? pixeles.size() : inicioTesela[t + 1];
+                const vector<array<unsigned, 2>> lote(pixeles.begin() + primero, pixeles.begin() + ultimo);
+                vector<RGB> coloresLote(lote.size(), RGB(0.0f, 0.0f, 0.0f));
+
+                inicio = std::chrono::steady_clock::now();
+                generarImpactos(cam, cornell, lote, tamanoPorPixel, parametros, impactos);
+                segundosImpactos += segundosDesde(inicio);
+                numImpactos += impactos.size();
+
+                inicio = std::chrono::steady_clock::now();
+                sombrearImpactos(impactos, cornell, fixture.mapaGlobal, fixture.mapaCaustico, fixture.numGlobales,
+                                 fixture.numCausticos, parametros, coloresLote);
+                segundosSombreado += segundosDesde(inicio);
+                for (size_t i = 0; i < lote.size(); ++i) sumas[primero + i] = coloresLote[i] / rpp;
+            }
+            cout << (imagenEntera ? "Diferido (imagen):     " : "Diferido (teselas):    ")
+                 << (segundosImpactos + segundosSombreado) * 1e6 / pixeles.size() << " us/pixel = impactos "
+                 << segundosImpactos * 1e6 / pixeles.size() << " + sombreado "
+                 << segundosSombreado * 1e6 / pixeles.size() << " (" << numImpactos << " impactos, radiancia media "
+                 << radianciaMedia(sumas) << ")" << endl;
+        }
+    }
+}
+
+// Compara la estimación de densidad con búsqueda por RADIO recorriendo todos los fotones con la
+// que suma grupos de fotones como uno (PhotonMap::fotonesConAgregados) con varias tolerancias,
+// en los puntos vistos desde la cámara de la caja de Cornell: tiempo por punto y error relativo
+// (RMS) de la radiancia indirecta respecto a la exacta
+void benchmarkAgregadosFotones(){
+    FixtureCornell cornell(128, 500000);
+    Parametros& parametros = cornell.parametros;
+    parametros.tipoVecinosGlobales = RADIO;
+    cornell.generarMapas();
+    PhotonMap& mapaGlobal = cornell.mapaGlobal;
+    auto inicio = std::chrono::steady_clock::now();
+    mapaGlobal.construirAgregados();
+    cout << "Agregados construidos en " << segundosDesde(inicio) * 1e3 << " ms ("
+         << mapaGlobal.agregados.size() * sizeof(AgregadoFotones) / (1024.0 * 1024.0) << " MB)" << endl;
+
+    const vector<PuntoVisto>& puntos = cornell.puntosVistos;
+
+    const unsigned REPETICIONES = 3;
+    for (const float radio : {0.05f, 0.1f}) {
+        cout << endl << "--- Radio " << radio << " ---" << endl;
+        parametros.vecinosGlobalesRadio = radio;
+        vector<RGB> exacta;
+        for (const float tolerancia : {0.0f, 0.125f, 0.25f, 0.5f, 1.0f, 2.0f}) {
+            // Se queda el mejor tiempo entre REPETICIONES repeticiones
+            parametros.toleranciaLOD = tolerancia;
+            vector<RGB> radiancias;
+            double segundos = std::numeric_limits<double>::max();
+            for (unsigned r = 0; r < REPETICIONES; ++r) {
+                radiancias.clear();
+                inicio = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < puntos.size(); ++i) {
+                    radiancias.push_back(estimarEcuacionRender(cornell.escena, mapaGlobal, cornell.mapaCaustico,
+                                                               cornell.numGlobales, cornell.numCausticos,
+                                                               puntos[i].punto, puntos[i].direccion, puntos[i].normal,
+                                                               BSDFs(), parametros));
+                }
+                segundos = std::min(segundos, segundosDesde(inicio));
+            }
+            if (tolerancia == 0.0f) {
+                exacta = radiancias;
+            }
+
+            double error2 = 0.0, referencia2 = 0.0;
+            for (size_t i = 0; i < puntos.size(); ++i) {
+                for (int c = 0; c < 3; ++c) {
+                    const double d = radiancias[i].rgb[c] - exacta[i].rgb[c];
+                    error2 += d * d;
+                    referencia2 += static_cast<double>(exacta[i].rgb[c]) * exacta[i].rgb[c];
+                }
+            }
+            cout << "toleranciaLOD " << tolerancia << ": " << segundos * 1e6 / puntos.size() << " us/punto, error "
+                 << 100.0 * std::sqrt(error2 / std::max(referencia2, 1e-30)) << "%" << endl;
+        }
+    }
+}
+
+// Compara cómo escalan con el número de threads las búsquedas de vecinos en el mapa de fotones
+// en memoria y en el paginado (ver MapaFotonesPaginado), con una caché que cabe entera y con una
+// pequeña. Cada thread busca los vecinos de los puntos vistos de sus teselas (en orden Morton),
+// repartidas como en el render; se da el mejor tiempo de varias repeticiones y la aceleración
+// respecto a un thread.
+void benchmarkMapaPaginadoThreads(){
+    // Los mapas se construyen aquí con cada caché, así que los fotones se trazan a vectores
+    const FixtureCornell cornell(128, 500000);
+    const Parametros& parametros = cornell.parametros;
+    vector<Photon> globales, causticos;
+    trazarFotones(globales, causticos, cornell.escena, parametros);
+
+    vector<size_t> inicioTesela;
+    const vector<array<unsigned, 2>> pixeles = ordenPixelesMorton(parametros.numPxlsAncho, parametros.numPxlsAlto,
+                                                                  TAM_TESELA_MORTON, inicioTesela);
+    vector<vector<array<float, 3>>> puntos(inicioTesela.size() - 1);
+    for (size_t t = 0; t + 1 < inicioTesela.size(); ++t) {
+        for (const PuntoVisto& visto : cornell.puntosVistosDesde(pixeles, inicioTesela[t], inicioTesela[t + 1])) {
+            puntos[t].push_back(visto.punto.coord);
+        }
+    }
+
+    const unsigned REPETICIONES = 3;
+    const unsigned numPaginas = (globales.size() + FOTONES_POR_PAGINA - 1) / FOTONES_POR_PAGINA;
+    for (const unsigned paginasCache : {0u, numPaginas, 8u}) {
+        vector<Photon> copia = globales;
+        const PhotonMap mapa = generarPhotonMap(copia, paginasCache);
+        if (paginasCache == 0) {
+            cout << endl << "--- En memoria ---" << endl;
+        } else {
+            cout << endl << "--- Paginado, caché de " << paginasCache << " de " << numPaginas << " páginas ---" << endl;
+        }
+
+        double segundosUnThread = 0.0;
+        for (const unsigned numThreads : {1u, 2u, 4u, 8u}) {
+            double segundos = std::numeric_limits<double>::max();
+            for (unsigned r = 0; r < REPETICIONES; ++r) {
+                auto inicio = std::chrono::steady_clock::now();
+                vector<thread> threads;
+                for (unsigned h = 0; h < numThreads; ++h) {
+                    threads.emplace_back([&, h]() {
+                        vector<const Photon*> vecinos;
+                        for (size_t t = h; t < puntos.size(); t += numThreads) {
+                            for (const array<float, 3>& punto : puntos[t]) {
+                                fotonesCercanos(mapa, punto, parametros.vecinosGlobalesRadio,
+                                                parametros.vecinosGlobalesNum, vecinos);
+                            }
+                        }
+                    });
+                }
+                for (thread& th : threads) {
+                    th.join();
+                }
+                segundos = std::min(segundos, segundosDesde(inicio));
+            }
+            if (numThreads == 1) {
+                segundosUnThread = segundos;
+            }
+            cout << numThreads << " threads: " << segundos * 1e3 << " ms, aceleración "
+                 << segundosUnThread / segundos << endl;
+        }
+    }
+}
+
+// Renderiza cada fichero de escena de <rutas> (ver ficheroEscena.h), aplicando después a sus
+// parámetros las asignaciones campo=valor de <asignaciones>. Mide por separado la carga de la
+// escena (lectura del fichero y de las mallas, y construcción de la escena) y el render.
+// Si un fichero tiene errores se informa y se pasa al siguiente. Devuelve el código de salida
+// del programa: EXIT_FAILURE si algún fichero no se ha podido renderizar.
+int renderizarFicherosEscena(const vector<string>& rutas, const vector<string>& asignaciones){
+    int resultado = EXIT_SUCCESS;
+    for (const string& ruta : rutas) {
+        try {
+            auto inicio = std::chrono::steady_clock::now();
+            DescripcionRender descripcion;
+            leerFicheroEscena(ruta, descripcion);
+            aplicarAsignaciones(descripcion, asignaciones);
+            const Parametros& parametros = descripcion.parametros;
+            float ratioCamara = modulo(descripcion.camara.l) / modulo(descripcion.camara.u);
+            float ratioPantalla = static_cast<float>(parametros.numPxlsAncho) / parametros.numPxlsAlto;
+            if (abs(ratioCamara - ratioPantalla) > MARGEN_ERROR) {
+                throw runtime_error(ruta + ": no coincide el ratio entre la camara (" + std::to_string(ratioCamara)
+                                    + ") y la pantalla (" + std::to_string(ratioPantalla) + ")");
+            }
+            Escena escena(descripcion.objetos, descripcion.luces);
+            std::chrono::duration<double> carga = std::chrono::steady_clock::now() - inicio;
+            cout << "Escena " << ruta << " cargada en " << carga.count() << " s (" << descripcion.objetos.size()
+                 << " primitivas, " << descripcion.luces.size() << " luces puntuales)" << endl;
+
+            inicio = std::chrono::steady_clock::now();
+            renderizarEscenaConThreads(descripcion.camara, escena, descripcion.salida, parametros,
+                                       descripcion.numThreads, descripcion.fotones);
+            std::chrono::duration<double> render = std::chrono::steady_clock::now() - inicio;
+            cout << "Escena " << ruta << ": carga " << carga.count() << " s, render " << render.count()
+                 << " s, imagen ./" << descripcion.salida << ".ppm" << endl;
+        } catch (const std::exception& e) {
+            cerr << "ERROR: " << e.what() << endl;
+            resultado = EXIT_FAILURE;
+        }
+    }
+    return resultado;
+}
+
+// Función que traza el fragmento <fragmento> de <numFragmentos> de los fotones del fichero de
+// escena <rutaEscena> (ver trazarFragmentoFotones), con sus threads y sus parámetros cambiados
+// por <asignaciones>, y lo guarda en el fichero de fotones <salida>
+int trazarFragmentoEscena(const string& rutaEscena, const unsigned fragmento, const unsigned numFragmentos,
+                          const string& salida, const vector<string>& asignaciones){
+    try {
+        DescripcionRender descripcion;
+        leerFicheroEscena(rutaEscena, descripcion);
+        aplicarAsignaciones(descripcion, asignaciones);
+        Escena escena(descripcion.objetos, descripcion.luces);
+        vector<Photon> globales, causticos;
+        const int caminos = trazarFragmentoFotones(globales, causticos, escena, descripcion.parametros,
+                                                   fragmento, numFragmentos, descripcion.numThreads);
+        guardarFotones(salida, globales, causticos, caminos);
+        cout << "Fragmento " << fragmento << " de " << numFragmentos << ": " << caminos << " caminos, "
+             << globales.size() << " fotones globales y " << causticos.size() << " causticos en " << salida << endl;
+    } catch (const std::exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Función que junta los fragmentos de fotones de <rutas> (ver fusionarFotones) en el fichero de
+// fotones <salida>
+int fusionarFragmentos(const string& salida, const vector<string>& rutas){
+    try {
+        vector<Photon> globales, causticos;
+        const uint64_t caminos = fusionarFotones(rutas, globales, causticos);
+        guardarFotones(salida, globales, causticos, caminos);
+        cout << rutas.size() << " fragmentos fusionados: " << caminos << " caminos, " << globales.size()
+             << " fotones globales y " << causticos.size() << " causticos en " << salida << endl;
+    } catch (const std::exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Función que lee en <valor> el argumento <texto> de la línea de comandos, que debe ser un entero
+// entre <minimo> y <maximo> (ver aEntero). Si no lo es, informa del error con su <nombre> y
+// devuelve false.
+bool leerArgumentoEntero(const string& nombre, const string& texto, const unsigned long minimo,
+                         const unsigned long maximo, unsigned long& valor){
+    try {
+        valor = aEntero(nombre, texto, minimo, maximo);
+    } catch (const std::exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return false;
+    }
+    return true;
+}
+
+// Se puede elegir el test a ejecutar como primer argumento (por defecto, el 12). Si el primer
+// argumento no es un número, los argumentos son ficheros de escena que se renderizan en orden,
+// y los de la forma campo=valor cambian ese campo de los parámetros de todos ellos
+// (p.ej. ./main escenas/cornell.escena rpp=64 numRandomWalks=1000000).
+// Render distribuido (ver distribuido.h):
+//   ./main coordinador <puerto> <trabajadores locales> <fichero de escena> [campo=valor ...]
+//   ./main trabajador <host del coordinador> <puerto>
+// Trazado de fotones por fragmentos, en procesos independientes, y fusión para renderizar:
+//   ./main fragmento <fichero de escena> <fragmento> <num fragmentos> <salida.bin> [campo=valor ...]
+//   ./main fusionar <salida.bin> <fragmento.bin> ...
+//   ./main <fichero de escena> fotones=<salida.bin>
+int main(int argc, char* argv[]) {
+    const unsigned long MAX_PUERTO = std::numeric_limits<unsigned short>::max();
+    if (argc > 4 && string(argv[1]) == "coordinador") {
+        unsigned long puerto, numLocales;
+        if (!leerArgumentoEntero("puerto", argv[2], 1, MAX_PUERTO, puerto) ||
+            !leerArgumentoEntero("trabajadores locales", argv[3], 0, MAX_TRABAJADORES_LOCALES, numLocales)) {
+            return EXIT_FAILURE;
+        }
+        return coordinarRenderDistribuido(argv[4], vector<string>(argv + 5, argv + argc), puerto, numLocales,
+                                          "/proc/self/exe");
+    } else if (argc > 3 && string(argv[1]) == "trabajador") {
+        unsigned long puerto;
+        if (!leerArgumentoEntero("puerto", argv[3], 1, MAX_PUERTO, puerto)) return EXIT_FAILURE;
+        return ejecutarTrabajador(argv[2], puerto);
+    } else if (argc > 5 && string(argv[1]) == "fragmento") {
+        unsigned long fragmento, numFragmentos;
+        if (!leerArgumentoEntero("num fragmentos", argv[4], 1, MAX_FRAGMENTOS, numFragmentos) ||
+            !leerArgumentoEntero("fragmento", argv[3], 0, numFragmentos - 1, fragmento)) {
+            return EXIT_FAILURE;
+        }
+        return trazarFragmentoEscena(argv[2], fragmento, numFragmentos, argv[5],
+                                     vector<string>(argv + 6, argv + argc));
+    } else if (argc > 3 && string(argv[1]) == "fusionar") {
+        return fusionarFragmentos(argv[2], vector<string>(argv + 3, argv + argc));
+    } else if (argc > 1 && !std::isdigit(static_cast<unsigned char>(argv[1][0]))) {
+        vector<string> rutas, asignaciones;
+        for (int i = 1; i < argc; ++i) {
+            string argumento = argv[i];
+            (argumento.find('=') != string::npos ? asignaciones : rutas).push_back(argumento);
+        }
+        return renderizarFicherosEscena(rutas, asignaciones);
+    }
+    int test = (argc > 1) ? std::atoi(argv[1]) : 12;
     
     if (test == 1) {
         array<float, 3> arrCoord = {4.44,5.55,6.66};
@@ -595,6 +1913,70 @@ int main() {
 
         cajaDeCornell();
 
+    } else if (test == 13){
+
+        benchmarkTrazadoFotones();
+
+    } else if (test == 14){
+
+        benchmarkInterseccionMalla();
+
+    } else if (test == 15){
+
+        benchmarkCornell();
+
+    } else if (test == 16){
+
+        benchmarkEstimacionDensidad();
+
+    } else if (test == 17){
+
+        benchmarkBusquedaVecinos();
+
+    } else if (test == 18){
+
+        benchmarkLucesNEE();
+
+    } else if (test == 19){
+
+        benchmarkLucesArea();
+
+    } else if (test == 20){
+
+        benchmarkPanelLuces();
+
+    } else if (test == 21){
+
+        benchmarkMuestreadores();
+
+    } else if (test == 22){
+
+        benchmarkMuestreoDirecciones();
+
+    } else if (test == 23){
+
+        suiteBenchmarks(argc > 2 ? argv[2] : "bench.json", argc > 3 ? argv[3] : "");
+
+    } else if (test == 24){
+
+        benchmarkOrdenMorton();
+
+    } else if (test == 25){
+
+        benchmarkBusquedaEnLote();
+
+    } else if (test == 26){
+
+        benchmarkSombreadoDiferido();
+
+    } else if (test == 27){
+
+        benchmarkAgregadosFotones();
+
+    } else if (test == 28){
+
+        benchmarkMapaPaginadoThreads();
+
     } else {
         printf("ERROR: No se ha encontrado el numero de prueba.\n");
     }
@@ -0,0 +1,395 @@
+//*****************************************************************
+// File:   mapaPaginado.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "mapaPaginado.h"
+#include "photonMap.h"
+#include "instrumentacion.h"
+#include "vec3.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Función que devuelve el cuadrado de la distancia entre <coord> y el fotón <foton>
+static float distancia2(const array<float, 3>& coord, const Photon& foton) {
+    const float dx = coord[0] - foton.coord[0], dy = coord[1] - foton.coord[1], dz = coord[2] - foton.coord[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// Función que devuelve el cuadrado de la distancia entre <coord> y la caja [<minimo>, <maximo>]
+// (0 si está dentro)
+static float distancia2Caja(const array<float, 3>& coord, const array<float, 3>& minimo,
+                            const array<float, 3>& maximo) {
+    float total = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        const float d = std::max({minimo[i] - coord[i], 0.0f, coord[i] - maximo[i]});
+        total += d * d;
+    }
+    return total;
+}
+
+// Función que ordena los fotones [izq, der) de <fotones> como un KD-tree implícito, igual que
+// nn::KDTree: la mediana de cada rango es su nodo, que parte el rango por el eje de mayor
+// extensión, guardado en <ejes>
+static void construirKDTreePagina(Photon* fotones, uint8_t* ejes, const size_t izq, const size_t der) {
+    if (der - izq <= 1) return;
+    array<float, 3> minimo = fotones[izq].coord, maximo = fotones[izq].coord;
+    for (size_t i = izq + 1; i < der; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            minimo[k] = std::min(minimo[k], fotones[i].coord[k]);
+            maximo[k] = std::max(maximo[k], fotones[i].coord[k]);
+        }
+    }
+    uint8_t eje = 0;
+    for (uint8_t k = 1; k < 3; ++k) {
+        if (maximo[k] - minimo[k] > maximo[eje] - minimo[eje]) eje = k;
+    }
+
+    const size_t mediana = (izq + der) / 2;
+    std::nth_element(fotones + izq, fotones + mediana, fotones + der,
+                     [eje](const Photon& a, const Photon& b) { return a.coord[eje] < b.coord[eje]; });
+    ejes[mediana] = eje;
+    construirKDTreePagina(fotones, ejes, izq, mediana);
+    construirKDTreePagina(fotones, ejes, mediana + 1, der);
+}
+
+// Función que añade <foton> a <fotonesCercanos> como nn::KDTree: al llegar a <numFotones> los
+// convierte en un montículo por distancia a <coord> y, a partir de ahí, descarta el más lejano
+// y reduce <distancia2> a la suya
+static void anadirVecino(const Photon* foton, const array<float, 3>& coord, const unsigned long numFotones,
+                         float& distancia2Maxima, vector<const Photon*>& fotonesCercanos) {
+    auto masCercano = [&coord](const Photon* a, const Photon* b) {
+        return distancia2(coord, *a) < distancia2(coord, *b);
+    };
+    fotonesCercanos.push_back(foton);
+    if (fotonesCercanos.size() == numFotones) {
+        std::make_heap(fotonesCercanos.begin(), fotonesCercanos.end(), masCercano);
+    } else if (fotonesCercanos.size() > numFotones) {
+        std::push_heap(fotonesCercanos.begin(), fotonesCercanos.end(), masCercano);
+        std::pop_heap(fotonesCercanos.begin(), fotonesCercanos.end(), masCercano);
+        fotonesCercanos.pop_back();
+        distancia2Maxima = distancia2(coord, *fotonesCercanos.front());
+    }
+}
+
+// Función que busca en el KD-tree implícito [izq, der) de una página (ver construirKDTreePagina)
+static void buscarEnPagina(const Photon* fotones, const uint8_t* ejes, const size_t izq, const size_t der,
+                           const array<float, 3>& coord, const unsigned long numFotones, float& distancia2Maxima,
+                           vector<const Photon*>& fotonesCercanos, const FiltroFotones* filtro) {
+    if (der <= izq) return;
+    CONTAR(FOTONES_VISITADOS, 1);
+    const size_t mediana = (izq + der) / 2;
+    const Photon& foton = fotones[mediana];
+    if (distancia2(coord, foton) < distancia2Maxima && (!filtro || (*filtro)(foton))) {
+        anadirVecino(&foton, coord, numFotones, distancia2Maxima, fotonesCercanos);
+    }
+    if (der - izq > 1) {
+        const float diferencia = coord[ejes[mediana]] - foton.coord[ejes[mediana]];
+        if (diferencia < 0.0f) {
+            buscarEnPagina(fotones, ejes, izq, mediana, coord, numFotones, distancia2Maxima, fotonesCercanos, filtro);
+            if (diferencia * diferencia < distancia2Maxima) {
+                buscarEnPagina(fotones, ejes, mediana + 1, der, coord, numFotones, distancia2Maxima,
+                               fotonesCercanos, filtro);
+            }
+        } else {
+            buscarEnPagina(fotones, ejes, mediana + 1, der, coord, numFotones, distancia2Maxima,
+                           fotonesCercanos, filtro);
+            if (diferencia * diferencia < distancia2Maxima) {
+                buscarEnPagina(fotones, ejes, izq, mediana, coord, numFotones, distancia2Maxima,
+                               fotonesCercanos, filtro);
+            }
+        }
+    }
+}
+
+// Páginas de un mapa paginado que un thread ha usado hace poco, con las veces que habían salido
+// de la caché cuando las usó (ver MapaFotonesPaginado::usarPagina)
+struct PaginasRecientesThread {
+    uint64_t mapa = 0;          // Id del mapa (0: ninguno)
+    unsigned siguiente = 0;     // Posición que se sustituye en el próximo fallo
+    array<uint32_t, PAGINAS_RECIENTES_THREAD> pagina;
+    array<uint32_t, PAGINAS_RECIENTES_THREAD> desalojos;
+};
+
+// Función que devuelve un id distinto para cada mapa paginado que se construye
+static uint64_t nuevoIdMapa() {
+    static std::atomic<uint64_t> siguienteId(1);
+    return siguienteId.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Función que escribe los <tam> bytes de <datos> en el descriptor <fd>. Lanza runtime_error si no puede.
+static void escribirTodo(const int fd, const void* datos, size_t tam) {
+    const char* p = static_cast<const char*>(datos);
+    while (tam > 0) {
+        const ssize_t escritos = write(fd, p, tam);
+        if (escritos < 0 && errno == EINTR) continue;
+        if (escritos <= 0) {
+            throw runtime_error(string("No se pudo escribir el mapa de fotones paginado: ") + std::strerror(errno));
+        }
+        p += escritos;
+        tam -= escritos;
+    }
+}
+
+MapaFotonesPaginado::MapaFotonesPaginado(vector<Photon>& fotones, const unsigned paginasCache)
+    : numFotones(fotones.size()), datos(nullptr), tamDatos(0),
+      tamPaginaSistema(static_cast<size_t>(sysconf(_SC_PAGESIZE))), id(nuevoIdMapa()),
+      capacidadCache(std::max(1u, paginasCache)),
+      primera(SIN_PAGINA), ultima(SIN_PAGINA), numResidentes(0) {
+    if (fotones.empty()) return;
+
+    // Orden Morton: código de 30 bits de la celda del fotón en la parte alta de la clave y su
+    // índice en la baja
+    array<float, 3> minimo = fotones[0].coord, maximo = fotones[0].coord;
+    for (const Photon& foton : fotones) {
+        for (int k = 0; k < 3; ++k) {
+            minimo[k] = std::min(minimo[k], foton.coord[k]);
+            maximo[k] = std::max(maximo[k], foton.coord[k]);
+        }
+    }
+    array<float, 3> escala;
+    for (int k = 0; k < 3; ++k) {
+        const float ancho = maximo[k] - minimo[k];
+        escala[k] = (ancho > 0.0f) ? 1023.0f / ancho : 0.0f;
+    }
+    vector<uint64_t> claves(fotones.size());
+    for (size_t i = 0; i < fotones.size(); ++i) {
+        const array<float, 3>& c = fotones[i].coord;
+        const uint64_t morton = codigoMorton(static_cast<unsigned>((c[0] - minimo[0]) * escala[0]),
+                                             static_cast<unsigned>((c[1] - minimo[1]) * escala[1]),
+                                             static_cast<unsigned>((c[2] - minimo[2]) * escala[2]));
+        claves[i] = (morton << 32) | i;
+    }
+    std::sort(claves.begin(), claves.end());
+
+    // El fichero se borra del directorio nada más crearlo: desaparece al cerrarlo y desproyectarlo
+    const char* directorio = std::getenv("TMPDIR");
+    string plantilla = string(directorio && *directorio ? directorio : "/tmp") + "/fotones_XXXXXX";
+    const int fd = mkstemp(plantilla.data());
+    if (fd < 0) {
+        throw runtime_error("No se pudo crear el fichero del mapa de fotones paginado en " + plantilla + ": "
+                            + std::strerror(errno));
+    }
+    unlink(plantilla.c_str());
+
+    try {
+        const size_t numPags = (fotones.size() + FOTONES_POR_PAGINA - 1) / FOTONES_POR_PAGINA;
+        paginas.reserve(numPags);
+        vector<Photon> fotonesPagina;
+        vector<uint8_t> ejes;
+        const vector<char> relleno(tamPaginaSistema, 0);
+        for (size_t inicio = 0; inicio < fotones.size(); inicio += FOTONES_POR_PAGINA) {
+            const size_t cuantos = std::min<size_t>(FOTONES_POR_PAGINA, fotones.size() - inicio);
+            fotonesPagina.clear();
+            for (size_t j = 0; j < cuantos; ++j) {
+                fotonesPagina.push_back(fotones[claves[inicio + j] & UINT32_MAX]);
+            }
+            ejes.assign(cuantos, 0);
+            construirKDTreePagina(fotonesPagina.data(), ejes.data(), 0, cuantos);
+
+            Pagina pagina;
+            pagina.desplazamiento = tamDatos;
+            pagina.numFotones = static_cast<uint32_t>(cuantos);
+            const size_t bytes = cuantos * sizeof(Photon) + cuantos;
+            pagina.tamBytes = (bytes + tamPaginaSistema - 1) / tamPaginaSistema * tamPaginaSistema;
+            pagina.minimo = pagina.maximo = fotonesPagina[0].coord;
+            for (const Photon& foton : fotonesPagina) {
+                for (int k = 0; k < 3; ++k) {
+                    pagina.minimo[k] = std::min(pagina.minimo[k], foton.coord[k]);
+                    pagina.maximo[k] = std::max(pagina.maximo[k], foton.coord[k]);
+                }
+            }
+            escribirTodo(fd, fotonesPagina.data(), cuantos * sizeof(Photon));
+            escribirTodo(fd, ejes.data(), cuantos);
+            escribirTodo(fd, relleno.data(), pagina.tamBytes - bytes);
+            paginas.push_back(pagina);
+            tamDatos += pagina.tamBytes;
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+
+    vector<Photon>().swap(fotones);
+    vector<uint64_t>().swap(claves);
+
+    void* proyeccion = mmap(nullptr, tamDatos, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (proyeccion == MAP_FAILED) {
+        throw runtime_error(string("No se pudo proyectar el mapa de fotones paginado: ") + std::strerror(errno));
+    }
+    // Sin lectura anticipada: solo se cargan las páginas que se buscan
+    madvise(proyeccion, tamDatos, MADV_RANDOM);
+    datos = static_cast<const char*>(proyeccion);
+
+    nodos.reserve(2 * paginas.size());
+    nodos.resize(1);
+    construirNodo(0, 0, static_cast<uint32_t>(paginas.size()));
+
+    anterior.assign(paginas.size(), SIN_PAGINA);
+    siguiente.assign(paginas.size(), SIN_PAGINA);
+    residente.assign(paginas.size(), false);
+    desalojos.reset(new std::atomic<uint32_t>[paginas.size()]());
+}
+
+MapaFotonesPaginado::~MapaFotonesPaginado() {
+    if (datos) {
+        munmap(const_cast<char*>(datos), tamDatos);
+    }
+}
+
+size_t MapaFotonesPaginado::size() const {
+    return numFotones;
+}
+
+size_t MapaFotonesPaginado::numPaginas() const {
+    return paginas.size();
+}
+
+void MapaFotonesPaginado::construirNodo(const uint32_t nodo, const uint32_t inicio, const uint32_t fin) {
+    NodoPaginas n;
+    n.minimo = paginas[inicio].minimo;
+    n.maximo = paginas[inicio].maximo;
+    array<float, 3> minimoCentros, maximoCentros;
+    for (int k = 0; k < 3; ++k) {
+        minimoCentros[k] = maximoCentros[k] = paginas[inicio].minimo[k] + paginas[inicio].maximo[k];
+    }
+    for (uint32_t i = inicio; i < fin; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            n.minimo[k] = std::min(n.minimo[k], paginas[i].minimo[k]);
+            n.maximo[k] = std::max(n.maximo[k], paginas[i].maximo[k]);
+            const float centro = paginas[i].minimo[k] + paginas[i].maximo[k];
+            minimoCentros[k] = std::min(minimoCentros[k], centro);
+            maximoCentros[k] = std::max(maximoCentros[k], centro);
+        }
+    }
+    if (fin - inicio == 1) {
+        n.hijo = 0;
+        n.pagina = inicio;
+        nodos[nodo] = n;
+        return;
+    }
+
+    // Las páginas se parten por la mediana de sus centros en el eje en el que más se extienden
+    int eje = 0;
+    for (int k = 1; k < 3; ++k) {
+        if (maximoCentros[k] - minimoCentros[k] > maximoCentros[eje] - minimoCentros[eje]) eje = k;
+    }
+    const uint32_t mitad = (inicio + fin) / 2;
+    std::nth_element(paginas.begin() + inicio, paginas.begin() + mitad, paginas.begin() + fin,
+                     [eje](const Pagina& a, const Pagina& b) {
+                         return a.minimo[eje] + a.maximo[eje] < b.minimo[eje] + b.maximo[eje];
+                     });
+    n.hijo = static_cast<uint32_t>(nodos.size());
+    n.pagina = SIN_PAGINA;
+    nodos.resize(nodos.size() + 2);
+    nodos[nodo] = n;
+    construirNodo(n.hijo, inicio, mitad);
+    construirNodo(n.hijo + 1, mitad, fin);
+}
+
+void MapaFotonesPaginado::vecinos(const array<float, 3>& coord, const unsigned long numFotones, const float radio,
+                                  vector<const Photon*>& fotonesCercanos, const FiltroFotones* filtro) const {
+    CONTAR(CONSULTAS_KNN, 1);
+    fotonesCercanos.clear();
+    if (nodos.empty() || numFotones == 0) return;
+    float distancia2Maxima = radio * radio;
+    buscarEnNodo(0, coord, numFotones, distancia2Maxima, fotonesCercanos, filtro);
+}
+
+void MapaFotonesPaginado::buscarEnNodo(const uint32_t nodo, const array<float, 3>& coord,
+                                       const unsigned long numFotones, float& distancia2Maxima,
+                                       vector<const Photon*>& fotonesCercanos, const FiltroFotones* filtro) const {
+    const NodoPaginas& n = nodos[nodo];
+    if (distancia2Caja(coord, n.minimo, n.maximo) >= distancia2Maxima) return;
+
+    if (n.hijo == 0) {
+        usarPagina(n.pagina);
+        const Pagina& pagina = paginas[n.pagina];
+        const Photon* fotones = reinterpret_cast<const Photon*>(datos + pagina.desplazamiento);
+        const uint8_t* ejes = reinterpret_cast<const uint8_t*>(fotones + pagina.numFotones);
+        buscarEnPagina(fotones, ejes, 0, pagina.numFotones, coord, numFotones, distancia2Maxima,
+                       fotonesCercanos, filtro);
+        return;
+    }
+
+    // Primero el hijo más cercano, para que la distancia máxima baje antes de mirar el otro
+    uint32_t cercano = n.hijo, lejano = n.hijo + 1;
+    if (distancia2Caja(coord, nodos[lejano].minimo, nodos[lejano].maximo)
+        < distancia2Caja(coord, nodos[cercano].minimo, nodos[cercano].maximo)) {
+        std::swap(cercano, lejano);
+    }
+    buscarEnNodo(cercano, coord, numFotones, distancia2Maxima, fotonesCercanos, filtro);
+    buscarEnNodo(lejano, coord, numFotones, distancia2Maxima, fotonesCercanos, filtro);
+}
+
+void MapaFotonesPaginado::usarPagina(const uint32_t pagina) const {
+    // Una entrada por mapa, para que el global y el de cáusticas (ids consecutivos) no se pisen
+    thread_local array<PaginasRecientesThread, 2> recientesThread;
+    PaginasRecientesThread& recientes = recientesThread[id % recientesThread.size()];
+    if (recientes.mapa != id) {
+        recientes.mapa = id;
+        recientes.pagina.fill(SIN_PAGINA);
+        recientes.siguiente = 0;
+    }
+
+    unsigned posicion = recientes.siguiente;
+    for (unsigned i = 0; i < PAGINAS_RECIENTES_THREAD; ++i) {
+        if (recientes.pagina[i] == pagina) {
+            if (recientes.desalojos[i] == desalojos[pagina].load(std::memory_order_acquire)) return;
+            posicion = i;   // Ha salido de la caché: se vuelve a meter y se actualiza su entrada
+            break;
+        }
+    }
+    if (posicion == recientes.siguiente) {
+        recientes.siguiente = (recientes.siguiente + 1) % PAGINAS_RECIENTES_THREAD;
+    }
+    recientes.pagina[posicion] = pagina;
+    recientes.desalojos[posicion] = usarPaginaEnCache(pagina);
+}
+
+uint32_t MapaFotonesPaginado::usarPaginaEnCache(const uint32_t pagina) const {
+    std::lock_guard<std::mutex> bloqueo(mutexCache);
+    CONTAR(BLOQUEOS_CACHE_PAGINAS, 1);
+    if (primera == pagina) return desalojos[pagina].load(std::memory_order_relaxed);
+
+    if (residente[pagina]) {
+        // Se saca de su posición (no es la primera, así que tiene anterior)
+        siguiente[anterior[pagina]] = siguiente[pagina];
+        if (siguiente[pagina] != SIN_PAGINA) {
+            anterior[siguiente[pagina]] = anterior[pagina];
+        } else {
+            ultima = anterior[pagina];
+        }
+    } else {
+        residente[pagina] = true;
+        numResidentes++;
+        CONTAR(PAGINAS_CARGADAS, 1);
+    }
+
+    anterior[pagina] = SIN_PAGINA;
+    siguiente[pagina] = primera;
+    if (primera != SIN_PAGINA) anterior[primera] = pagina;
+    primera = pagina;
+    if (ultima == SIN_PAGINA) ultima = pagina;
+
+    if (numResidentes > capacidadCache) {
+        const uint32_t victima = ultima;
+        ultima = anterior[victima];
+        siguiente[ultima] = SIN_PAGINA;
+        residente[victima] = false;
+        numResidentes--;
+        desalojos[victima].fetch_add(1, std::memory_order_release);
+        // Quien aún tenga punteros a la página puede leerla: el sistema la vuelve a cargar
+        madvise(const_cast<char*>(datos) + paginas[victima].desplazamiento, paginas[victima].tamBytes,
+                MADV_DONTNEED);
+    }
+    return desalojos[pagina].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,109 @@
+//*****************************************************************
+// File:   mapaPaginado.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "photon.h"
+#include "utilidades.h"
+
+struct FiltroFotones;
+
+// Mapa de fotones fuera de memoria, para cuando los fotones (más las copias que hace el KD-tree)
+// no caben en la RAM. Los fotones se ordenan por código Morton y se reparten en páginas de
+// FOTONES_POR_PAGINA fotones consecutivos, que se escriben en un fichero temporal (ya borrado
+// del directorio) alineadas a páginas del sistema. Cada página guarda sus fotones como un KD-tree
+// implícito, igual que nn::KDTree, y sobre las cajas límite de las páginas se construye un KD-tree
+// de nivel superior que decide qué páginas hay que abrir en cada búsqueda.
+//
+// El fichero se proyecta entero con mmap, así que el sistema lee cada página la primera vez que
+// se toca. Una caché LRU de <paginasCache> páginas lleva la cuenta de las que se han usado y
+// libera (madvise) las que salen de ella, lo que acota la memoria residente. Los punteros a
+// fotones siguen siendo válidos después: si se vuelven a leer, el sistema recarga la página.
+// Para no tomar el mutex de la caché en cada página visitada, cada thread recuerda las últimas
+// PAGINAS_RECIENTES_THREAD páginas que ha usado y solo pasa por la caché compartida cuando la
+// página no está entre ellas o ha salido de la caché desde entonces.
+class MapaFotonesPaginado {
+public:
+    // Constructor que escribe los fotones de <fotones> en páginas y vacía <fotones>. Lanza
+    // runtime_error si no se puede crear o proyectar el fichero temporal.
+    MapaFotonesPaginado(vector<Photon>& fotones, const unsigned paginasCache);
+
+    MapaFotonesPaginado(const MapaFotonesPaginado&) = delete;
+    MapaFotonesPaginado& operator=(const MapaFotonesPaginado&) = delete;
+
+    ~MapaFotonesPaginado();
+
+    // Método que devuelve el número de fotones del mapa
+    size_t size() const;
+
+    // Método que devuelve el número de páginas del mapa
+    size_t numPaginas() const;
+
+    // Método que devuelve en <fotonesCercanos> como mucho <numFotones> fotones a distancia
+    // menor que <radio> de <coord>, los más cercanos, con el mismo criterio que
+    // nn::KDTree::nearest_neighbors. Si se da <filtro>, solo se devuelven los que lo cumplen.
+    void vecinos(const array<float, 3>& coord, const unsigned long numFotones, const float radio,
+                 vector<const Photon*>& fotonesCercanos, const FiltroFotones* filtro) const;
+
+private:
+    // Página del fichero: <numFotones> fotones en orden de KD-tree seguidos del eje de cada nodo,
+    // en <tamBytes> bytes (múltiplo del tamaño de página del sistema) a partir de <desplazamiento>
+    struct Pagina {
+        size_t desplazamiento, tamBytes;
+        uint32_t numFotones;
+        array<float, 3> minimo, maximo;
+    };
+
+    // Nodo del KD-tree de páginas. Los hijos de un nodo interno están en <hijo> y <hijo> + 1;
+    // las hojas (hijo == 0) contienen la página <pagina>.
+    struct NodoPaginas {
+        array<float, 3> minimo, maximo;
+        uint32_t hijo;
+        uint32_t pagina;
+    };
+
+    vector<Pagina> paginas;
+    vector<NodoPaginas> nodos;
+    size_t numFotones;
+    const char* datos;
+    size_t tamDatos;
+    size_t tamPaginaSistema;
+    uint64_t id;        // Distinto para cada mapa, identifica sus páginas recientes en cada thread
+
+    // Caché LRU: lista doblemente enlazada de las páginas residentes, de la más a la menos
+    // reciente, con los enlaces guardados por página (SIN_PAGINA: ninguno)
+    static constexpr uint32_t SIN_PAGINA = UINT32_MAX;
+    unsigned capacidadCache;
+    mutable std::mutex mutexCache;
+    mutable vector<uint32_t> anterior, siguiente;
+    mutable vector<bool> residente;
+    mutable uint32_t primera, ultima;
+    mutable unsigned numResidentes;
+    // Veces que ha salido de la caché cada página: si no ha cambiado desde que un thread la
+    // usó, la página sigue en la caché
+    std::unique_ptr<std::atomic<uint32_t>[]> desalojos;
+
+    // Método que construye el nodo <nodo> del KD-tree de páginas con las páginas [inicio, fin)
+    void construirNodo(const uint32_t nodo, const uint32_t inicio, const uint32_t fin);
+
+    // Método que busca en el subárbol de <nodo> (ver vecinos), con <distancia2> el cuadrado de
+    // la distancia máxima actual
+    void buscarEnNodo(const uint32_t nodo, const array<float, 3>& coord, const unsigned long numFotones,
+                      float& distancia2, vector<const Photon*>& fotonesCercanos,
+                      const FiltroFotones* filtro) const;
+
+    // Método que marca la página <pagina> como usada: si no está entre las recientes del thread,
+    // la pone como la más reciente de la caché, liberando la menos reciente si la caché está llena
+    void usarPagina(const uint32_t pagina) const;
+
+    // Método que hace lo anterior en la caché compartida (con su mutex) y devuelve las veces que
+    // ha salido de ella <pagina>
+    uint32_t usarPaginaEnCache(const uint32_t pagina) const;
+};
@@ -7,9 +7,10 @@
 
 #include "mesh.h"
 #include "gestorPLY.h"
-#include <random>
+#include <algorithm>
+#include <limits>
 
-Mesh::Mesh() : Primitiva(), triangulos(vector<Triangulo>()) {}
+Mesh::Mesh() : Primitiva(), triangulos(vector<Triangulo>()), areaTotal(0.0f) {}
 
 Mesh::Mesh(const string rutaModelo,   const string rutaTextura, const float escala, const Punto& centro, 
             const float rotacionX, const bool invertirX, 
@@ -22,6 +23,13 @@ Mesh::Mesh(const string rutaModelo,   const string rutaTextura, const float esca
 
     triangulos = generarModeloPLY(rutaModelo, rutaTextura, esferaLimite, escala, centro,
                                     rotacionX, invertirX, rotacionY, invertirY, rotacionZ, invertirZ);
+    bloques = construirBloquesTriangulos(triangulos);
+
+    areaTotal = 0.0f;
+    for (const Triangulo& t : triangulos) {
+        areaTotal += modulo(cross(t.p1 - t.p0, t.p2 - t.p0)) * 0.5f;
+        cdfAreas.push_back(areaTotal);
+    }
 }
 
 void Mesh::interseccion(const Rayo& rayo, vector<Punto>& ptos, BSDFs& coefs) const {
@@ -29,26 +37,18 @@ void Mesh::interseccion(const Rayo& rayo, vector<Punto>& ptos, BSDFs& coefs) con
         return;
     }
 
-    Punto puntoCercano;
-    bool intersec = false;
-    for(auto& t : triangulos){
-        BSDFs bsdfsAux;
-        vector<Punto> puntosAux;
-        t.interseccion(rayo, puntosAux, bsdfsAux);
-        if(puntosAux.size() > 0){
-            if(!intersec){ // primer triangulo intersecado
-                intersec = true;
-                puntoCercano = puntosAux[0];
-                coefs = bsdfsAux;
-            } else if(modulo(rayo.o - puntosAux[0]) < modulo(rayo.o - puntoCercano)){ // otra interseccion mas cercana
-                puntoCercano = puntosAux[0];
-                coefs = bsdfsAux;
-            }
+    float tMin = std::numeric_limits<float>::infinity();
+    int masCercano = -1;
+    for(size_t b = 0; b < bloques.size(); b++){
+        int k = interseccionBloque(bloques[b], rayo, tMin);
+        if(k >= 0){ // otra interseccion mas cercana
+            masCercano = b * TRIANGULOS_POR_BLOQUE + k;
         }
     }
 
-    if(intersec){
-        ptos.push_back(puntoCercano);
+    if(masCercano >= 0){
+        ptos.push_back(Punto(rayo.o + rayo.d * tMin));
+        coefs = triangulos[masCercano].coeficientes;
     }
     return;
 }
@@ -73,15 +73,45 @@ bool Mesh::puntoEsFuenteDeLuz(const Punto& punto) const {
     return triangulos[tMasCercano].soyFuenteDeLuz();
 }
 
-Punto Mesh::generarPuntoAleatorio(float& prob) const {
-    // Obtiene un triangulo aleatorio de la malla
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, triangulos.size() - 1);
-    int randomIndex = distrib(gen);
-    Triangulo t = triangulos[randomIndex];
+size_t Mesh::muestrearTriangulo(float& u1) const {
+    const float objetivo = u1 * areaTotal;
+    size_t i = std::upper_bound(cdfAreas.begin(), cdfAreas.end(), objetivo) - cdfAreas.begin();
+    i = std::min(i, cdfAreas.size() - 1);
+    const float inicio = (i > 0) ? cdfAreas[i - 1] : 0.0f;
+    const float area = cdfAreas[i] - inicio;
+    u1 = (area > 0.0f) ? std::min((objetivo - inicio) / area, 0.99999994f) : 0.0f;
+    return i;
+}
+
+Punto Mesh::muestrearPuntoArea(const float u1, const float u2, float& prob) const {
+    if (triangulos.empty() || areaTotal <= 0.0f) {
+        prob = 0.0f;
+        return Punto();
+    }
+
+    float u = u1;
+    const Triangulo& t = triangulos[muestrearTriangulo(u)];
+    float probTriangulo;
+    Punto p = t.muestrearPuntoArea(u, u2, probTriangulo);
+    prob = 1.0f / areaTotal;
+    return p;
+}
+
+Punto Mesh::muestrearLuz(const Punto& ref, const float u1, const float u2, float& prob) const {
+    if (triangulos.empty() || areaTotal <= 0.0f) {
+        prob = 0.0f;
+        return Punto();
+    }
 
-    return t.generarPuntoAleatorio(prob);
+    float u = u1;
+    const Triangulo& t = triangulos[muestrearTriangulo(u)];
+    float probTriangulo;
+    Punto p = t.muestrearPuntoArea(u, u2, probTriangulo);
+    Direccion d = p - ref;
+    float dist2 = dot(d, d);
+    float cosLuz = (dist2 > 0.0f) ? -dot(normalizar(t.getNormal()), d) / sqrt(dist2) : 0.0f;
+    prob = (cosLuz > MARGEN_ERROR) ? dist2 / (areaTotal * cosLuz) : 0.0f;
+    return p;
 }
 
 float Mesh::getEjeTexturaU(const Punto& pto) const {
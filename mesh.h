@@ -10,6 +10,7 @@
 #include "utilidades.h"
 #include "triangulo.h"
 #include "esfera.h"
+#include "bloqueTriangulos.h"
 
 // Clase que representa una malla de triángulos, con sus caras triangulares y sus vertices
 // Hereda de la clase Primitiva
@@ -26,6 +27,16 @@ public:
     // <esferaLimite>, no hace falta ver si interseca con cada uno de los triangulos)
     Esfera esferaLimite;
 
+    // Copia de <triangulos> agrupada en bloques SoA para el kernel SIMD de intersección.
+    // El triángulo i de la malla está en la posición i % TRIANGULOS_POR_BLOQUE del bloque
+    // i / TRIANGULOS_POR_BLOQUE. Se construye una sola vez, al cargar el modelo.
+    vector<BloqueTriangulos> bloques;
+
+    // Área acumulada de los triángulos (cdfAreas[i] = área de los triángulos 0..i) y área
+    // total, para muestrear triángulos proporcionalmente a su área
+    vector<float> cdfAreas;
+    float areaTotal;
+
     // Constructor base
     Mesh();
 
@@ -41,8 +52,8 @@ public:
         const string _material = "difuso", const RGB& _power = RGB());
 
 
-    // Método para calcular la intersección entre un rayo y el triángulo
-    // Algoritmo usado: Möller–Trumbore
+    // Método para calcular la intersección entre un rayo y la malla
+    // Algoritmo usado: Möller–Trumbore, sobre los bloques SoA de <bloques>
     //
     // Devuelve en <ptos> un vector con los puntos de intersección en UCS del rayo <rayo>
     // con el objeto. Si hay dos puntos de intersección, el primer elemento introducido
@@ -61,9 +72,14 @@ public:
     // y además, es un punto lumínico del triángulo.
     bool puntoEsFuenteDeLuz(const Punto& punto) const override;
     
-    // Funcion que devuelve un punto aleatorio del triángulo en UCS.
-    // También devuelve en <prob> la probabilidad de muestrear dicho punto.
-    Punto generarPuntoAleatorio(float& prob) const override;
+    // Funcion que devuelve el punto de la malla que corresponde a la muestra (<u1>, <u2>):
+    // elige un triángulo con probabilidad proporcional a su área (ver <cdfAreas>) y un punto
+    // uniforme dentro de él. Devuelve en <prob> la densidad respecto del área (1 / área total).
+    Punto muestrearPuntoArea(const float u1, const float u2, float& prob) const override;
+
+    // Igual que Primitiva::muestrearLuz, pero usando la normal del triángulo muestreado
+    // en vez de buscar el triángulo más cercano al punto
+    Punto muestrearLuz(const Punto& ref, const float u1, const float u2, float& prob) const override;
     
     // Funcion que obtiene la posición del punto <pto> del triángulo en el
     // eje U de la textura correspondiente.
@@ -78,6 +94,11 @@ public:
 
     int trianguloMasCercano(const Punto& p) const;
 
+private:
+    // Método que devuelve el índice del triángulo elegido con <u1> según <cdfAreas> y
+    // reescala <u1> a [0,1) dentro de ese triángulo, para poder reutilizarlo
+    size_t muestrearTriangulo(float& u1) const;
+
     // Debug
     void diHola() const override;
 };
@@ -0,0 +1,157 @@
+//*****************************************************************
+// File:   muestreador.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "muestreador.h"
+#include "aleatorio.h"
+
+// Números de dirección de Sobol (Joe y Kuo) de las dimensiones 2 a MAX_DIMENSIONES_SOBOL:
+// grado <s> del polinomio primitivo, sus coeficientes interiores <a> y los <m> iniciales
+struct PolinomioSobol {
+    unsigned s, a;
+    uint32_t m[6];
+};
+
+static const PolinomioSobol POLINOMIOS_SOBOL[MAX_DIMENSIONES_SOBOL - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}}
+};
+
+static const unsigned PRIMOS_HALTON[MAX_DIMENSIONES_HALTON] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+    59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131
+};
+
+// Matrices generadoras de Sobol: una columna de 32 bits por bit del índice
+struct MatricesSobol {
+    uint32_t v[MAX_DIMENSIONES_SOBOL][32];
+
+    MatricesSobol() {
+        for (unsigned i = 0; i < 32; ++i) {
+            v[0][i] = 1u << (31 - i);       // Primera dimensión: van der Corput
+        }
+        for (unsigned d = 1; d < MAX_DIMENSIONES_SOBOL; ++d) {
+            const PolinomioSobol& p = POLINOMIOS_SOBOL[d - 1];
+            for (unsigned i = 0; i < 32; ++i) {
+                if (i < p.s) {
+                    v[d][i] = p.m[i] << (31 - i);
+                } else {
+                    v[d][i] = v[d][i - p.s] ^ (v[d][i - p.s] >> p.s);
+                    for (unsigned k = 1; k < p.s; ++k) {
+                        if ((p.a >> (p.s - 1 - k)) & 1u) {
+                            v[d][i] ^= v[d][i - k];
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+static const MatricesSobol MATRICES_SOBOL;
+
+static uint32_t invertirBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Aleatorización de Owen aproximada con un hash (Laine-Karras, variante de Burley 2020): cada
+// bit de <x> se invierte según un hash de <semilla> y de los bits más significativos que él
+static uint32_t aleatorizarOwen(uint32_t x, const uint32_t semilla) {
+    x = invertirBits(x);
+    x ^= x * 0x3d20adeau;
+    x += semilla;
+    x *= (semilla >> 16) | 1u;
+    x ^= x * 0x05526c56u;
+    x ^= x * 0x53a22864u;
+    return invertirBits(x);
+}
+
+// Función que convierte los 24 bits altos de <x> en un float de [0, 1)
+static float aFlotante(const uint32_t x) {
+    return (x >> 8) * (1.0f / (1u << 24));
+}
+
+uint32_t mezclarSemilla(const uint32_t a, const uint32_t b) {
+    uint32_t x = a * 0x9e3779b9u ^ (b + 0x7f4a7c15u + (a << 6) + (a >> 2));
+    x ^= x >> 16;
+    x *= 0x21f0aaadu;
+    x ^= x >> 15;
+    x *= 0x735a2d97u;
+    x ^= x >> 15;
+    return x;
+}
+
+static float muestraSobol(const uint32_t indice, const unsigned dimension, const uint32_t semilla) {
+    // Se baraja también el índice, para que cada secuencia recorra los puntos en otro orden
+    const uint32_t i = aleatorizarOwen(indice, semilla);
+    uint32_t x = 0;
+    for (unsigned bit = 0; bit < 32 && (i >> bit) != 0; ++bit) {
+        if ((i >> bit) & 1u) {
+            x ^= MATRICES_SOBOL.v[dimension][bit];
+        }
+    }
+    return aFlotante(aleatorizarOwen(x, mezclarSemilla(semilla, dimension)));
+}
+
+// Inverso radical de <indice> en la base de la dimensión, sumando a cada dígito un
+// desplazamiento aleatorio (módulo la base) propio de su posición
+static float muestraHalton(uint32_t indice, const unsigned dimension, const uint32_t semilla) {
+    const unsigned base = PRIMOS_HALTON[dimension];
+    const uint32_t semillaDim = mezclarSemilla(semilla, dimension);
+    const double invBase = 1.0 / base;
+    double factor = invBase, resultado = 0.0;
+    for (unsigned posicion = 0; factor > 1e-8; ++posicion, factor *= invBase) {
+        const unsigned digito = indice % base;
+        indice /= base;
+        resultado += ((digito + mezclarSemilla(semillaDim, posicion)) % base) * factor;
+    }
+    return std::min(static_cast<float>(resultado), 0x1.fffffep-1f);
+}
+
+Muestreador::Muestreador(const TipoMuestreador _tipo, const uint32_t _semilla)
+    : tipo(_tipo), semilla(_semilla), indice(0), dimension(0) {}
+
+void Muestreador::comenzarMuestra(const uint32_t _indice) {
+    indice = _indice;
+    dimension = 0;
+}
+
+float Muestreador::siguiente() {
+    const unsigned d = dimension++;
+    if (tipo == SOBOL && d < MAX_DIMENSIONES_SOBOL) {
+        return muestraSobol(indice, d, semilla);
+    } else if (tipo == HALTON && d < MAX_DIMENSIONES_HALTON) {
+        return muestraHalton(indice, d, semilla);
+    }
+    return numeroAleatorio();
+}
+
+static thread_local Muestreador* muestreadorActivo = nullptr;
+
+void activarMuestreador(Muestreador* m) {
+    muestreadorActivo = m;
+}
+
+float muestra() {
+    return muestreadorActivo != nullptr ? muestreadorActivo->siguiente() : numeroAleatorio();
+}
@@ -0,0 +1,49 @@
+//*****************************************************************
+// File:   muestreador.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+
+#include <cstdint>
+#include "parametros.h"
+#include "utilidades.h"
+
+// Muestreador de secuencias de baja discrepancia. Cada muestra (un píxel con rpp > 1 o un
+// camino de fotón) es un punto de la secuencia del que se van pidiendo coordenadas, una por
+// cada decisión aleatoria del camino, en el mismo orden (jitter del píxel, emisión, ruleta
+// rusa, dirección de cada rebote...). Así, las muestras de un mismo píxel o de un mismo trozo
+// de fotones quedan estratificadas en cada una de esas decisiones.
+// La <semilla> aleatoriza la secuencia (Owen en Sobol, desplazamiento de dígitos en Halton),
+// por dimensión y por secuencia, de modo que píxeles o trozos distintos no se correlan. Las
+// dimensiones que no tienen tabla (a partir de MAX_DIMENSIONES_SOBOL / MAX_DIMENSIONES_HALTON)
+// y el tipo ALEATORIO devuelven numeroAleatorio().
+class Muestreador {
+public:
+    TipoMuestreador tipo;
+    uint32_t semilla;
+    uint32_t indice;        // Punto de la secuencia de la muestra actual
+    unsigned dimension;     // Siguiente coordenada que se devolverá
+
+    // Constructor dado el tipo de secuencia y la semilla que la aleatoriza
+    Muestreador(const TipoMuestreador _tipo = ALEATORIO, const uint32_t _semilla = 0);
+
+    // Método que pasa a la muestra <indice> de la secuencia, empezando por su primera coordenada
+    void comenzarMuestra(const uint32_t _indice);
+
+    // Método que devuelve la siguiente coordenada en [0, 1) de la muestra actual
+    float siguiente();
+};
+
+// Función que hace que muestra() use <m> en el thread que la llama (nullptr: ninguno). El
+// muestreador no se copia, así que debe seguir vivo mientras esté activo.
+void activarMuestreador(Muestreador* m);
+
+// Función que devuelve la siguiente coordenada del muestreador activo del thread, o un
+// número aleatorio independiente (numeroAleatorio()) si no hay ninguno activo
+float muestra();
+
+// Función que mezcla <a> y <b> en un entero de 32 bits bien distribuido, p.ej. para obtener
+// la semilla de un píxel a partir de sus coordenadas
+uint32_t mezclarSemilla(const uint32_t a, const uint32_t b);
@@ -0,0 +1,54 @@
+//*****************************************************************
+// File:   muestreo.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "muestreo.h"
+
+// Raíz cuadrada de cada componente (las extensiones vectoriales no la tienen; con -O3 y
+// un -march con AVX el compilador la convierte en una sola instrucción)
+static inline flotante8 raiz8(const flotante8& x) {
+    flotante8 res;
+    for (unsigned k = 0; k < ANCHO_PAQUETE; ++k) {
+        res[k] = __builtin_sqrtf(x[k]);
+    }
+    return res;
+}
+
+static inline flotante8 maximoCero(const flotante8& x) {
+    return x > 0.0f ? x : flotante8{};
+}
+
+void muestrearEsferaUniformeLote(const size_t n, const vector<float>& u1, const vector<float>& u2,
+                                 vector<float>& x, vector<float>& y, vector<float>& z) {
+    for (size_t i = 0; i < conRelleno(n); i += ANCHO_PAQUETE) {
+        const flotante8 zi = 2.0f * cargar(u1, i) - 1.0f;
+        const flotante8 r = raiz8(maximoCero(1.0f - zi * zi));
+        flotante8 s, c;
+        senoCosenoVuelta(cargar(u2, i), s, c);
+        guardar(x, i, r * c);
+        guardar(y, i, r * s);
+        guardar(z, i, zi);
+    }
+}
+
+void muestrearHemisferioCosenoLote(const size_t n, const Vec3& normal, const vector<float>& u1,
+                                   const vector<float>& u2, vector<float>& x, vector<float>& y,
+                                   vector<float>& z, vector<float>& prob) {
+    Vec3 t, b;
+    baseOrtonormal(normal, t, b);
+    for (size_t i = 0; i < conRelleno(n); i += ANCHO_PAQUETE) {
+        const flotante8 v1 = cargar(u1, i);
+        const flotante8 r = raiz8(v1);
+        const flotante8 cosTheta = raiz8(maximoCero(1.0f - v1));
+        flotante8 s, c;
+        senoCosenoVuelta(cargar(u2, i), s, c);
+        const flotante8 lx = r * c, ly = r * s;
+        guardar(x, i, t.x * lx + b.x * ly + normal.x * cosTheta);
+        guardar(y, i, t.y * lx + b.y * ly + normal.y * cosTheta);
+        guardar(z, i, t.z * lx + b.z * ly + normal.z * cosTheta);
+        guardar(prob, i, cosTheta * static_cast<float>(1.0 / M_PI));
+    }
+}
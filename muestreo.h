@@ -0,0 +1,89 @@
+//*****************************************************************
+// File:   muestreo.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   enero 2025
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include "vec3.h"
+#include "simd.h"
+#include "utilidades.h"
+
+// Transformaciones de números uniformes de [0, 1) en direcciones, sin acos ni sin/cos de la
+// librería: el ángulo azimutal se obtiene con un polinomio (senoCosenoVuelta) y el resto es
+// álgebra con raíces cuadradas. Las versiones "Lote" generan n direcciones a la vez en
+// estructura de arrays, de ANCHO_PAQUETE en ANCHO_PAQUETE (ver simd.h).
+
+// Función que devuelve en <s> y <c> el seno y el coseno de 2 PI <u>, con <u> en [0, 1).
+// Se reduce a un ángulo de [-PI/2, PI/2] por simetría y se evalúan los polinomios de Taylor
+// de grado 11 (seno) y 12 (coseno): error absoluto menor que 1e-6, sin ramas. <T> es float o
+// flotante8 (en este caso las comparaciones dan máscaras y los ?: seleccionan por componente).
+template <typename T>
+inline void senoCosenoVuelta(const T& u, T& s, T& c) {
+    // v en [-1/2, 1/2): sin(2 PI u) = -sin(2 PI v), cos(2 PI u) = -cos(2 PI v)
+    const T v = u - 0.5f;
+    const T absV = v < 0.0f ? -v : v;
+    const T mitad = v < 0.0f ? T{} - 0.5f : T{} + 0.5f;
+    // Si |v| > 1/4, sin(2 PI v) = sin(2 PI (±1/2 - v)) y cos(2 PI v) = -cos(2 PI (±1/2 - v))
+    const T w = absV > 0.25f ? mitad - v : v;
+    const T signoCos = absV > 0.25f ? T{} + 1.0f : T{} - 1.0f;
+
+    const T x = w * static_cast<float>(2 * M_PI);
+    const T x2 = x * x;
+    const T sinX = x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880
+                       + x2 * (-1.0f / 39916800))))));
+    const T cosX = 1.0f + x2 * (-1.0f / 2 + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320
+                       + x2 * (-1.0f / 3628800 + x2 * (1.0f / 479001600))))));
+    s = -sinX;
+    c = signoCos * cosX;
+}
+
+// Función que construye en <t> y <b> una base ortonormal junto con <n> (normalizada), sin
+// ramas ni normalizaciones (Duff et al., "Building an Orthonormal Basis, Revisited", 2017)
+inline void baseOrtonormal(const Vec3& n, Vec3& t, Vec3& b) {
+    const float signo = std::copysign(1.0f, n.z);
+    const float a = -1.0f / (signo + n.z);
+    const float xy = n.x * n.y * a;
+    t = {1.0f + signo * n.x * n.x * a, signo * xy, -signo * n.x};
+    b = {xy, signo + n.y * n.y * a, -n.y};
+}
+
+// Función que devuelve una dirección uniforme de la esfera a partir de (<u1>, <u2>)
+// (densidad 1 / (4 PI)). <u1> fija la altura z = 2 <u1> - 1 y <u2> el azimut.
+inline Vec3 muestrearEsferaUniforme(const float u1, const float u2) {
+    const float z = 2.0f * u1 - 1.0f;
+    const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+    float s, c;
+    senoCosenoVuelta(u2, s, c);
+    return {r * c, r * s, z};
+}
+
+// Función que devuelve una dirección del hemisferio z > 0 con densidad proporcional al
+// coseno (Malley: punto uniforme del disco proyectado), y en <cosTheta> su coordenada z,
+// de modo que su densidad es <cosTheta> / PI
+inline Vec3 muestrearHemisferioCoseno(const float u1, const float u2, float& cosTheta) {
+    const float r = std::sqrt(u1);
+    float s, c;
+    senoCosenoVuelta(u2, s, c);
+    cosTheta = std::sqrt(std::max(0.0f, 1.0f - u1));
+    return {r * c, r * s, cosTheta};
+}
+
+// Función que devuelve <local> (coordenadas en la base <t>, <b>, <n>) en coordenadas globales
+inline Vec3 aGlobal(const Vec3& local, const Vec3& t, const Vec3& b, const Vec3& n) {
+    return t * local.x + b * local.y + n * local.z;
+}
+
+// Versión por lotes de muestrearEsferaUniforme: escribe en <x>, <y>, <z> las <n> direcciones
+// correspondientes a <u1>[i], <u2>[i]. Los arrays deben tener relleno hasta conRelleno(n).
+void muestrearEsferaUniformeLote(const size_t n, const vector<float>& u1, const vector<float>& u2,
+                                 vector<float>& x, vector<float>& y, vector<float>& z);
+
+// Versión por lotes de muestrearHemisferioCoseno alrededor de la normal <normal>: escribe las
+// direcciones globales en <x>, <y>, <z> y sus densidades en <prob>. Los arrays deben tener
+// relleno hasta conRelleno(n).
+void muestrearHemisferioCosenoLote(const size_t n, const Vec3& normal, const vector<float>& u1,
+                                   const vector<float>& u2, vector<float>& x, vector<float>& y,
+                                   vector<float>& z, vector<float>& prob);
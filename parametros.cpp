@@ -12,7 +12,21 @@ Parametros::Parametros(const unsigned _numPxlsAncho,
                 float _vecinosCausticosRadio,
                 const bool _nee,
                 const bool _luzIndirecta,
-                const bool _printPixelesProcesados
+                const bool _printPixelesProcesados,
+                const unsigned _profundidadMaxima,
+                const bool _trazadoWavefront,
+                const unsigned _tamLoteWavefront,
+                const TipoKernel _kernel,
+                const bool _filtroNormal,
+                const float _grosorDisco,
+                const unsigned _numLucesNEE,
+                const unsigned _muestrasLuzArea,
+                const TipoMuestreador _muestreador,
+                const uint32_t _semilla,
+                const unsigned _paginasCacheFotones,
+                const bool _ordenMorton,
+                const bool _sombreadoDiferido,
+                const float _toleranciaLOD
                 )
 
                 : rpp(_rpp),
@@ -27,6 +41,20 @@ Parametros::Parametros(const unsigned _numPxlsAncho,
                 vecinosCausticosNum(_vecinosCausticosNum),
                 vecinosCausticosRadio(_vecinosCausticosRadio),
                 luzIndirecta(_luzIndirecta),
-                nee(_nee)
+                nee(_nee),
+                profundidadMaxima(_profundidadMaxima),
+                trazadoWavefront(_trazadoWavefront),
+                tamLoteWavefront(_tamLoteWavefront),
+                kernel(_kernel),
+                filtroNormal(_filtroNormal),
+                grosorDisco(_grosorDisco),
+                numLucesNEE(_numLucesNEE),
+                muestrasLuzArea(_muestrasLuzArea),
+                muestreador(_muestreador),
+                semilla(_semilla),
+                paginasCacheFotones(_paginasCacheFotones),
+                ordenMorton(_ordenMorton),
+                sombreadoDiferido(_sombreadoDiferido),
+                toleranciaLOD(_toleranciaLOD)
                 {}
 
@@ -6,11 +6,32 @@
 //*****************************************************************
 #pragma once
 
+#include <cstdint>
+#include "utilidades.h"
+
 enum TipoVecinos {
     RADIO = 0,
     PORCENTAJE = 1,
     NUMERO = 2,
-    RADIONUMERO = 3
+    RADIONUMERO = 3,
+    ADAPTATIVO = 4      // Como RADIONUMERO, pero el radio de partida se estima con la densidad local
+};
+
+// Kernel usado en la estimación de densidad (ver kernels.h)
+enum TipoKernel {
+    CONSTANTE = 0,
+    GAUSSIANO = 1,
+    CONICO = 2,
+    EPANECHNIKOV = 3,
+    BIPESO = 4,
+    LOGISTICO = 5
+};
+
+// Secuencia de la que salen los números de cada muestra (ver muestreador.h)
+enum TipoMuestreador {
+    ALEATORIO = 0,      // Números aleatorios independientes
+    HALTON = 1,         // Halton con desplazamiento aleatorio de dígitos
+    SOBOL = 2           // Sobol con aleatorización de Owen
 };
 
 // Clase auxiliar que permite pasar todos los parametros de una ejecución de
@@ -30,6 +51,20 @@ public:
     bool nee;
     bool luzIndirecta;
     bool printPixelesProcesados;
+    unsigned profundidadMaxima;
+    bool trazadoWavefront;
+    unsigned tamLoteWavefront;
+    TipoKernel kernel;
+    bool filtroNormal;          // Descartar fotones que llegan por detrás de la superficie (ver FiltroFotones)
+    float grosorDisco;          // Si > 0 y filtroNormal, grosor máximo de la búsqueda respecto al plano tangente
+    unsigned numLucesNEE;       // Luces muestreadas por punto en NEE (0: todas las luces)
+    unsigned muestrasLuzArea;   // Rayos de sombra por luz de área y punto en NEE
+    TipoMuestreador muestreador;    // Secuencia para píxeles, emisión y rebotes (ver muestreador.h)
+    uint32_t semilla;           // Semilla de los generadores de cada thread (0: aleatoria, ver sembrarThread)
+    unsigned paginasCacheFotones;   // Si > 0, mapas de fotones paginados en disco con esta caché (ver mapaPaginado.h)
+    bool ordenMorton;           // Recorrer los píxeles por teselas en orden Morton (consultas de vecinos coherentes)
+    bool sombreadoDiferido;     // Sombrear por teselas en dos etapas: impactos de cámara y luego vecinos y NEE en lote
+    float toleranciaLOD;        // Si > 0, tamaño máximo (relativo al radio) de los grupos de fotones globales que se suman como uno (ver PhotonMap::construirAgregados)
 
     Parametros(const unsigned _numPxlsAncho,
                 const unsigned _numPxlsAlto,
@@ -43,5 +78,19 @@ public:
                 float _vecinosCausticosRadio,
                 const bool _nee,
                 const bool _luzIndirecta,
-                const bool _printPixelesProcesados);
+                const bool _printPixelesProcesados,
+                const unsigned _profundidadMaxima = PROFUNDIDAD_MAXIMA_CAMINO,
+                const bool _trazadoWavefront = false,
+                const unsigned _tamLoteWavefront = TAM_LOTE_WAVEFRONT,
+                const TipoKernel _kernel = GAUSSIANO,
+                const bool _filtroNormal = false,
+                const float _grosorDisco = 0.0f,
+                const unsigned _numLucesNEE = 0,
+                const unsigned _muestrasLuzArea = MUESTRAS_LUZ_AREA,
+                const TipoMuestreador _muestreador = ALEATORIO,
+                const uint32_t _semilla = 0,
+                const unsigned _paginasCacheFotones = 0,
+                const bool _ordenMorton = false,
+                const bool _sombreadoDiferido = false,
+                const float _toleranciaLOD = 0.0f);
 };
\ No newline at end of file
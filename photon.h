@@ -29,3 +29,5 @@ public:
     // Función para mostrar por pantalla el rayo
     friend ostream& operator<<(ostream& os, const Photon& pd);
 };
+
+static_assert(std::is_trivially_copyable_v<Photon>, "Photon debe poder copiarse con memcpy");
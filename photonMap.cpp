@@ -6,33 +6,368 @@
 //*****************************************************************
 
 #include "photonMap.h"
+#include "instrumentacion.h"
+#include <cstdint>
+#include <fstream>
 
 float PhotonAxisPosition::operator()(const Photon& p, size_t i) const {
     return p.getCoord(i);
 }
 
+RejillaDensidad::RejillaDensidad() : minimo({0.0f, 0.0f, 0.0f}), ladoCelda(1.0f), numCeldas({0, 0, 0}) {}
+
+RejillaDensidad::RejillaDensidad(const vector<Photon>& fotones) : RejillaDensidad() {
+    if (fotones.empty()) {
+        return;
+    }
+
+    array<float, 3> maximo = fotones[0].coord;
+    minimo = fotones[0].coord;
+    for (const Photon& foton : fotones) {
+        for (int i = 0; i < 3; ++i) {
+            minimo[i] = std::min(minimo[i], foton.coord[i]);
+            maximo[i] = std::max(maximo[i], foton.coord[i]);
+        }
+    }
+
+    // Lado de celda tal que haya FOTONES_POR_CELDA_DENSIDAD fotones por celda de media
+    float volumen = 1.0f, ladoMaximo = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        float lado = std::max(maximo[i] - minimo[i], MARGEN_ERROR);
+        volumen *= lado;
+        ladoMaximo = std::max(ladoMaximo, lado);
+    }
+    ladoCelda = std::cbrt(volumen * FOTONES_POR_CELDA_DENSIDAD / fotones.size());
+    ladoCelda = std::max(ladoCelda, ladoMaximo / MAX_CELDAS_EJE_DENSIDAD);
+    for (int i = 0; i < 3; ++i) {
+        numCeldas[i] = static_cast<int>((maximo[i] - minimo[i]) / ladoCelda) + 1;
+    }
+
+    cuentas.assign(static_cast<size_t>(numCeldas[0]) * numCeldas[1] * numCeldas[2], 0);
+    for (const Photon& foton : fotones) {
+        int c[3];
+        for (int i = 0; i < 3; ++i) {
+            c[i] = std::min(static_cast<int>((foton.coord[i] - minimo[i]) / ladoCelda), numCeldas[i] - 1);
+        }
+        cuentas[(static_cast<size_t>(c[2]) * numCeldas[1] + c[1]) * numCeldas[0] + c[0]]++;
+    }
+}
+
+float RejillaDensidad::radioEstimado(const array<float, 3>& coord, const unsigned long numFotones) const {
+    if (cuentas.empty()) {
+        return 0.0f;
+    }
+
+    int c[3];
+    for (int i = 0; i < 3; ++i) {
+        c[i] = std::clamp(static_cast<int>(std::floor((coord[i] - minimo[i]) / ladoCelda)), 0, numCeldas[i] - 1);
+    }
+
+    // Se suman las 3x3x3 celdas alrededor de <coord>, que suavizan la estimación
+    unsigned long total = 0;
+    for (int z = std::max(c[2] - 1, 0); z <= std::min(c[2] + 1, numCeldas[2] - 1); ++z) {
+        for (int y = std::max(c[1] - 1, 0); y <= std::min(c[1] + 1, numCeldas[1] - 1); ++y) {
+            for (int x = std::max(c[0] - 1, 0); x <= std::min(c[0] + 1, numCeldas[0] - 1); ++x) {
+                total += cuentas[(static_cast<size_t>(z) * numCeldas[1] + y) * numCeldas[0] + x];
+            }
+        }
+    }
+    if (total == 0) {
+        return 0.0f;
+    }
+
+    // Una superficie que atraviesa un cubo de lado 3*ladoCelda tiene un área de unas
+    // (3*ladoCelda)^2, así que la densidad superficial es total / (9 ladoCelda^2) y el disco
+    // con <numFotones> fotones tiene radio sqrt(numFotones / (PI * densidad))
+    const float densidad = total / (9.0f * ladoCelda * ladoCelda);
+    return std::sqrt(numFotones / (M_PI * densidad));
+}
+
+PhotonMap::PhotonMap() {}
+
+PhotonMap::PhotonMap(const vector<Photon>& fotones)
+    : nn::KDTree<Photon,3,PhotonAxisPosition>(fotones, PhotonAxisPosition()), densidad(fotones) {}
+
+PhotonMap::PhotonMap(vector<Photon>& fotones, const unsigned paginasCache)
+    : densidad(fotones), paginado(std::make_shared<const MapaFotonesPaginado>(fotones, paginasCache)) {}
+
+void PhotonMap::construirAgregados() {
+    agregados.clear();
+    if (tree_elements().size() >= MIN_FOTONES_AGREGADO) {
+        construirAgregado(0, 0, tree_elements().size());
+    }
+}
+
+AgregadoFotones PhotonMap::construirAgregado(const size_t nodo, const size_t izq, const size_t der) {
+    const vector<Photon>& fotones = tree_elements();
+    AgregadoFotones agregado;
+    agregado.minimo = agregado.maximo = fotones[izq].coord;
+    agregado.flujo = RGB(0.0f, 0.0f, 0.0f);
+
+    // Los subárboles pequeños se resumen recorriéndolos, sin guardar su agregado
+    if (der - izq < MIN_FOTONES_AGREGADO) {
+        array<double, 3> suma = {0.0, 0.0, 0.0};
+        for (size_t i = izq; i < der; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                agregado.minimo[k] = std::min(agregado.minimo[k], fotones[i].coord[k]);
+                agregado.maximo[k] = std::max(agregado.maximo[k], fotones[i].coord[k]);
+                suma[k] += fotones[i].coord[k];
+            }
+            agregado.flujo += fotones[i].flujo;
+        }
+        for (int k = 0; k < 3; ++k) agregado.centro[k] = static_cast<float>(suma[k] / (der - izq));
+        return agregado;
+    }
+
+    const size_t mediana = (izq + der) / 2;
+    const AgregadoFotones izquierdo = construirAgregado(2 * nodo + 1, izq, mediana);
+    const AgregadoFotones derecho = construirAgregado(2 * nodo + 2, mediana + 1, der);
+    const Photon& foton = fotones[mediana];
+    const size_t numIzquierdo = mediana - izq, numDerecho = der - mediana - 1;
+    for (int k = 0; k < 3; ++k) {
+        agregado.minimo[k] = std::min({izquierdo.minimo[k], derecho.minimo[k], foton.coord[k]});
+        agregado.maximo[k] = std::max({izquierdo.maximo[k], derecho.maximo[k], foton.coord[k]});
+        agregado.centro[k] = static_cast<float>((static_cast<double>(izquierdo.centro[k]) * numIzquierdo
+                                                 + static_cast<double>(derecho.centro[k]) * numDerecho
+                                                 + foton.coord[k]) / (der - izq));
+    }
+    agregado.flujo = izquierdo.flujo + derecho.flujo + foton.flujo;
+    if (agregados.size() <= nodo) {
+        agregados.resize(nodo + 1);
+    }
+    agregados[nodo] = agregado;
+    return agregado;
+}
+
+void PhotonMap::fotonesConAgregados(const array<float, 3>& coord, const float radio, const float tolerancia,
+                                    vector<const Photon*>& sueltos, vector<Photon>& agrupados,
+                                    float& distanciaAgrupados2) const {
+    CONTAR(CONSULTAS_KNN, 1);
+    sueltos.clear();
+    agrupados.clear();
+    distanciaAgrupados2 = 0.0f;
+    buscarConAgregados(0, 0, tree_elements().size(), coord, radio * radio, tolerancia * tolerancia, sueltos,
+                       agrupados, distanciaAgrupados2);
+}
+
+void PhotonMap::buscarConAgregados(const size_t nodo, const size_t izq, const size_t der, const array<float, 3>& coord,
+                                   const float radio2, const float tolerancia2, vector<const Photon*>& sueltos,
+                                   vector<Photon>& agrupados, float& distanciaAgrupados2) const {
+    if (izq >= der) {
+        return;
+    }
+
+    if (der - izq >= MIN_FOTONES_AGREGADO && nodo < agregados.size()) {
+        // Distancias al cuadrado de <coord> al punto más cercano y al más lejano de la caja
+        const AgregadoFotones& agregado = agregados[nodo];
+        float cerca2 = 0.0f, lejos2 = 0.0f, diagonal2 = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            const float cerca = std::max({agregado.minimo[k] - coord[k], 0.0f, coord[k] - agregado.maximo[k]});
+            const float lejos = std::max(coord[k] - agregado.minimo[k], agregado.maximo[k] - coord[k]);
+            const float lado = agregado.maximo[k] - agregado.minimo[k];
+            cerca2 += cerca * cerca;
+            lejos2 += lejos * lejos;
+            diagonal2 += lado * lado;
+        }
+        if (cerca2 >= radio2) {     // La caja queda fuera de la esfera
+            return;
+        }
+        if (lejos2 < radio2 && diagonal2 <= tolerancia2 * radio2) {
+            agrupados.push_back(Photon(agregado.centro, Direccion(), agregado.flujo));
+            distanciaAgrupados2 = std::max(distanciaAgrupados2, lejos2);
+            return;
+        }
+    }
+
+    CONTAR(FOTONES_VISITADOS, 1);
+    const vector<Photon>& fotones = tree_elements();
+    const size_t mediana = (izq + der) / 2;
+    const Photon& foton = fotones[mediana];
+    float distancia2 = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        const float d = coord[k] - foton.coord[k];
+        distancia2 += d * d;
+    }
+    if (distancia2 < radio2) {
+        sueltos.push_back(&foton);
+    }
+    if (der - izq > 1) {
+        const size_t eje = tree_axis(mediana);
+        const float d = coord[eje] - foton.coord[eje];
+        if (d < 0.0f || d * d < radio2) {
+            buscarConAgregados(2 * nodo + 1, izq, mediana, coord, radio2, tolerancia2, sueltos, agrupados,
+                               distanciaAgrupados2);
+        }
+        if (d >= 0.0f || d * d < radio2) {
+            buscarConAgregados(2 * nodo + 2, mediana + 1, der, coord, radio2, tolerancia2, sueltos, agrupados,
+                               distanciaAgrupados2);
+        }
+    }
+}
+
 PhotonMap generarPhotonMap(vector<Photon>& vecFotones){
-    list<Photon> photons(vecFotones.begin(), vecFotones.end());
-    return PhotonMap(std::move(photons), PhotonAxisPosition());
+    return PhotonMap(vecFotones);
+}
+
+PhotonMap generarPhotonMap(vector<Photon>& vecFotones, const unsigned paginasCache){
+    if (paginasCache == 0) {
+        return PhotonMap(vecFotones);
+    }
+    return PhotonMap(vecFotones, paginasCache);
+}
+
+// Cabecera de los ficheros de fotones: identificador y versión del formato
+static const char CABECERA_FICHERO_FOTONES[8] = {'F', 'O', 'T', 'O', 'N', 'E', 'S', '2'};
+
+void guardarFotones(const string& ruta, const vector<Photon>& globales, const vector<Photon>& causticos,
+                    const uint64_t caminos) {
+    ofstream fichero(ruta, std::ios::binary);
+    const uint64_t numGlobales = globales.size(), numCausticos = causticos.size();
+    fichero.write(CABECERA_FICHERO_FOTONES, sizeof(CABECERA_FICHERO_FOTONES));
+    fichero.write(reinterpret_cast<const char*>(&caminos), sizeof(caminos));
+    fichero.write(reinterpret_cast<const char*>(&numGlobales), sizeof(numGlobales));
+    fichero.write(reinterpret_cast<const char*>(&numCausticos), sizeof(numCausticos));
+    fichero.write(reinterpret_cast<const char*>(globales.data()), numGlobales * sizeof(Photon));
+    fichero.write(reinterpret_cast<const char*>(causticos.data()), numCausticos * sizeof(Photon));
+    if (!fichero) {
+        throw runtime_error("No se pudo escribir el fichero de fotones: " + ruta);
+    }
+}
+
+uint64_t cargarFotones(const string& ruta, vector<Photon>& globales, vector<Photon>& causticos) {
+    ifstream fichero(ruta, std::ios::binary);
+    char cabecera[sizeof(CABECERA_FICHERO_FOTONES)];
+    uint64_t caminos = 0, numGlobales = 0, numCausticos = 0;
+    fichero.read(cabecera, sizeof(cabecera));
+    fichero.read(reinterpret_cast<char*>(&caminos), sizeof(caminos));
+    fichero.read(reinterpret_cast<char*>(&numGlobales), sizeof(numGlobales));
+    fichero.read(reinterpret_cast<char*>(&numCausticos), sizeof(numCausticos));
+    if (!fichero || !std::equal(cabecera, cabecera + sizeof(cabecera), CABECERA_FICHERO_FOTONES)) {
+        throw runtime_error("No es un fichero de fotones válido: " + ruta);
+    }
+
+    // Photon no tiene constructor por defecto: se llenan los vectores con fotones vacíos y se
+    // copian los bytes del fichero encima
+    const Photon vacio({0.0f, 0.0f, 0.0f}, Direccion(), RGB());
+    globales.assign(numGlobales, vacio);
+    causticos.assign(numCausticos, vacio);
+    fichero.read(reinterpret_cast<char*>(globales.data()), numGlobales * sizeof(Photon));
+    fichero.read(reinterpret_cast<char*>(causticos.data()), numCausticos * sizeof(Photon));
+    if (!fichero) {
+        throw runtime_error("Fichero de fotones incompleto: " + ruta);
+    }
+    return caminos;
 }
 
+uint64_t fusionarFotones(const vector<string>& rutas, vector<Photon>& globales, vector<Photon>& causticos) {
+    vector<vector<Photon>> globalesFragmento(rutas.size()), causticosFragmento(rutas.size());
+    vector<uint64_t> caminosFragmento(rutas.size());
+    uint64_t caminos = 0;
+    for (size_t i = 0; i < rutas.size(); ++i) {
+        caminosFragmento[i] = cargarFotones(rutas[i], globalesFragmento[i], causticosFragmento[i]);
+        caminos += caminosFragmento[i];
+    }
+    if (caminos == 0) {
+        throw runtime_error("Los fragmentos de fotones no tienen ningún camino");
+    }
+
+    // Cada fragmento repartió la potencia de las luces entre sus propios caminos: al juntarlos,
+    // su flujo pasa a valer la fracción de caminos que aporta
+    globales.clear();
+    causticos.clear();
+    for (size_t i = 0; i < rutas.size(); ++i) {
+        const float escala = static_cast<float>(static_cast<double>(caminosFragmento[i]) / caminos);
+        for (Photon& foton : globalesFragmento[i]) foton.flujo = foton.flujo * escala;
+        for (Photon& foton : causticosFragmento[i]) foton.flujo = foton.flujo * escala;
+        globales.insert(globales.end(), globalesFragmento[i].begin(), globalesFragmento[i].end());
+        causticos.insert(causticos.end(), causticosFragmento[i].begin(), causticosFragmento[i].end());
+        vector<Photon>().swap(globalesFragmento[i]);
+        vector<Photon>().swap(causticosFragmento[i]);
+    }
+    return caminos;
+}
+
+// Norma euclídea, la misma que usa PhotonMap por defecto
+static float normaEuclidea(const array<float, 3>& v) {
+    return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+// Cuenta los nodos que examina el KD-tree, que no conoce la instrumentación
+struct ContadorVisitas {
+    void operator()([[maybe_unused]] const size_t n) const { CONTAR(FOTONES_VISITADOS, n); }
+};
+
+static bool aceptarFoton(const Photon&) { return true; }
+
 void fotonesCercanos(const PhotonMap& photonMap, const array<float, 3>& coordBusqueda, float radio,
-                        unsigned long numFotones, vector<const Photon*>& fotonesCercanos){
-    fotonesCercanos = photonMap.nearest_neighbors(coordBusqueda,
-                                                    numFotones,
-                                                    radio);
+                        unsigned long numFotones, vector<const Photon*>& fotonesCercanos,
+                        const FiltroFotones* filtro){
+    if (photonMap.paginado) {
+        photonMap.paginado->vecinos(coordBusqueda, numFotones, radio, fotonesCercanos, filtro);
+    } else {
+        CONTAR(CONSULTAS_KNN, 1);
+        if (filtro) {
+            fotonesCercanos = photonMap.nearest_neighbors(coordBusqueda, numFotones, radio,
+                                                          normaEuclidea, *filtro, ContadorVisitas());
+        } else {
+            fotonesCercanos = photonMap.nearest_neighbors(coordBusqueda, numFotones, radio,
+                                                          normaEuclidea, aceptarFoton, ContadorVisitas());
+        }
+    }
+}
+
+void fotonesCercanosEnLote(const PhotonMap& photonMap, const vector<array<float, 3>>& coordsBusqueda,
+                           float radio, unsigned long numFotones, vector<vector<const Photon*>>& fotonesCercanos,
+                           const vector<FiltroFotones>* filtros){
+    if (photonMap.paginado) {
+        // El mapa paginado no tiene búsqueda en lote: cada posición por separado
+        fotonesCercanos.resize(coordsBusqueda.size());
+        for (size_t i = 0; i < coordsBusqueda.size(); ++i) {
+            photonMap.paginado->vecinos(coordsBusqueda[i], numFotones, radio, fotonesCercanos[i],
+                                        filtros ? &(*filtros)[i] : nullptr);
+        }
+    } else {
+        CONTAR(CONSULTAS_KNN, coordsBusqueda.size());
+        const vector<float> radios(coordsBusqueda.size(), radio);
+        if (filtros) {
+            fotonesCercanos = photonMap.nearest_neighbors_batch(coordsBusqueda, numFotones, radios, normaEuclidea,
+                                                                [filtros](const size_t i, const Photon& p) { return (*filtros)[i](p); },
+                                                                ContadorVisitas());
+        } else {
+            fotonesCercanos = photonMap.nearest_neighbors_batch(coordsBusqueda, numFotones, radios, normaEuclidea,
+                                                                [](const size_t, const Photon& p) { return aceptarFoton(p); },
+                                                                ContadorVisitas());
+        }
+    }
 }
 
 void fotonesCercanosPorNumFotones(const PhotonMap& photonMap, const array<float, 3>& coordBusqueda,
-                        unsigned long numFotones, vector<const Photon*>& fotonesCercanos){
-    fotonesCercanos = photonMap.nearest_neighbors(coordBusqueda,
-                                                    numFotones,
-                                                    std::numeric_limits<float>::max());
+                        unsigned long numFotones, vector<const Photon*>& fotonesCercanos,
+                        const FiltroFotones* filtro){
+    ::fotonesCercanos(photonMap, coordBusqueda, std::numeric_limits<float>::max(), numFotones,
+                      fotonesCercanos, filtro);
 }
 
 void fotonesCercanosPorRadio(const PhotonMap& photonMap, const array<float, 3>& coordBusqueda,
-                                float radio, vector<const Photon*>& fotonesCercanos){
-    fotonesCercanos = photonMap.nearest_neighbors(coordBusqueda,
-                                                std::numeric_limits<unsigned long>::max(),
-                                                radio);
+                                float radio, vector<const Photon*>& fotonesCercanos,
+                                const FiltroFotones* filtro){
+    ::fotonesCercanos(photonMap, coordBusqueda, radio, std::numeric_limits<unsigned long>::max(),
+                      fotonesCercanos, filtro);
+}
+
+void fotonesCercanosAdaptativo(const PhotonMap& photonMap, const array<float, 3>& coordBusqueda,
+                                float radioMaximo, unsigned long numFotones, vector<const Photon*>& fotonesCercanos,
+                                const FiltroFotones* filtro){
+    float radio = photonMap.densidad.radioEstimado(coordBusqueda, numFotones) * MARGEN_RADIO_ADAPTATIVO;
+    if (radio <= 0.0f || radio > radioMaximo) {
+        radio = radioMaximo;
+    }
+
+    while (true) {
+        ::fotonesCercanos(photonMap, coordBusqueda, radio, numFotones, fotonesCercanos, filtro);
+        if (fotonesCercanos.size() * 2 >= numFotones || radio >= radioMaximo) {
+            break;
+        }
+        radio = std::min(2.0f * radio, radioMaximo);
+    }
 }
@@ -6,32 +6,168 @@
 //*****************************************************************
 #pragma once
 
+#include <cstdint>
 #include "kdtree.h"
+#include "mapaPaginado.h"
 #include "photon.h"
+#include "vec3.h"
 
 // Estructura auxiliar que permite al KDTree acceder a la posicion del Photon
 struct PhotonAxisPosition {
     float operator()(const Photon& p, size_t i) const;
 };
 
-// Un KDTree de fotones en 3 dimensiones
-using PhotonMap = nn::KDTree<Photon,3,PhotonAxisPosition>;
+// Rejilla uniforme sobre la caja límite de los fotones que guarda cuántos caen en cada
+// celda, para estimar la densidad local de fotones sin recorrer el KDTree
+class RejillaDensidad {
+public:
+    // Constructor base (rejilla vacía)
+    RejillaDensidad();
+
+    // Constructor que cuenta los fotones de <fotones> en cada celda
+    RejillaDensidad(const vector<Photon>& fotones);
+
+    // Método que devuelve el radio de un disco centrado en <coord> que contendría
+    // aproximadamente <numFotones> fotones, suponiendo que estos están sobre una superficie
+    // que atraviesa las celdas vecinas. Devuelve 0 si no hay fotones alrededor.
+    float radioEstimado(const array<float, 3>& coord, const unsigned long numFotones) const;
+
+private:
+    array<float, 3> minimo;
+    float ladoCelda;
+    array<int, 3> numCeldas;
+    vector<unsigned> cuentas;
+};
+
+// Resumen de los fotones de un subárbol del KDTree: su caja límite, su centro (media de las
+// posiciones) y la suma de sus flujos
+struct AgregadoFotones {
+    array<float, 3> minimo, maximo, centro;
+    RGB flujo;
+};
+
+// Un KDTree de fotones en 3 dimensiones, junto con la rejilla de densidad de esos mismos fotones.
+// Si <paginado> no es nulo, el KDTree está vacío y las búsquedas van a ese mapa paginado.
+class PhotonMap : public nn::KDTree<Photon,3,PhotonAxisPosition> {
+public:
+    RejillaDensidad densidad;
+    sh_ptr<const MapaFotonesPaginado> paginado;
+
+    // Agregados de los subárboles con al menos MIN_FOTONES_AGREGADO fotones, numerados como un
+    // montículo: el del nodo raíz en la posición 0 y los hijos del de la posición i en 2i+1 y 2i+2.
+    // Vacío hasta llamar a construirAgregados.
+    vector<AgregadoFotones> agregados;
+
+    // Constructor base (mapa vacío)
+    PhotonMap();
+
+    // Constructor que construye el KDTree y la rejilla a partir de <fotones>
+    PhotonMap(const vector<Photon>& fotones);
+
+    // Constructor que construye la rejilla a partir de <fotones> y los pasa a un mapa paginado
+    // en disco con una caché de <paginasCache> páginas, vaciando <fotones>
+    PhotonMap(vector<Photon>& fotones, const unsigned paginasCache);
+
+    // Método que calcula los agregados de los subárboles del KDTree (no hace nada si el mapa
+    // está paginado)
+    void construirAgregados();
+
+    // Método que devuelve en <sueltos> los fotones a distancia menor que <radio> de <coord> y
+    // en <agrupados>, como un fotón en su centro con la suma de sus flujos, los subárboles cuya
+    // caja límite cabe entera en esa esfera y cuya diagonal no pasa de <tolerancia> * <radio>,
+    // sin recorrerlos. Devuelve en <distanciaAgrupados2> el cuadrado de la mayor distancia de
+    // <coord> a la caja de uno de esos subárboles (0 si no hay ninguno). Requiere construirAgregados.
+    void fotonesConAgregados(const array<float, 3>& coord, const float radio, const float tolerancia,
+                             vector<const Photon*>& sueltos, vector<Photon>& agrupados,
+                             float& distanciaAgrupados2) const;
+
+private:
+    // Métodos recursivos de construirAgregados y fotonesConAgregados para el nodo <nodo>, que
+    // tiene los fotones [izq, der) del KDTree
+    AgregadoFotones construirAgregado(const size_t nodo, const size_t izq, const size_t der);
+    void buscarConAgregados(const size_t nodo, const size_t izq, const size_t der, const array<float, 3>& coord,
+                            const float radio2, const float tolerancia2, vector<const Photon*>& sueltos,
+                            vector<Photon>& agrupados, float& distanciaAgrupados2) const;
+};
+
+// Criterio para descartar fotones en la búsqueda de vecinos de un punto <centro> con normal
+// <normal> (unitaria y orientada hacia el lado desde el que se observa la superficie):
+// se rechazan los fotones que llegan por detrás de la superficie y, si <grosor> > 0, los que
+// están a más de <grosor> del plano tangente (la esfera de búsqueda queda aplanada en un disco)
+struct FiltroFotones {
+    Vec3 centro;
+    Vec3 normal;
+    float grosor;
+
+    bool operator()(const Photon& p) const {
+        if (dot(p.wi.vec(), normal) >= 0.0f) {
+            return false;
+        }
+        return grosor <= 0.0f || std::abs(dot(vec3(p.coord) - centro, normal)) <= grosor;
+    }
+};
+
+// Función que escribe en el fichero binario <ruta> los fotones <globales> y <causticos>, junto
+// con el número de <caminos> de fotones que los dejaron, para que otros procesos (ver
+// distribuido.h) usen el mismo mapa sin volver a trazarlo. Los fotones se copian tal cual están
+// en memoria, así que el fichero solo vale para máquinas con el mismo orden de bytes.
+// Lanza runtime_error si no se puede escribir.
+void guardarFotones(const string& ruta, const vector<Photon>& globales, const vector<Photon>& causticos,
+                    const uint64_t caminos);
+
+// Función que lee en <globales> y <causticos> los fotones escritos con guardarFotones en <ruta>
+// y devuelve su número de caminos. Lanza runtime_error si no se puede leer o no tiene ese formato.
+uint64_t cargarFotones(const string& ruta, vector<Photon>& globales, vector<Photon>& causticos);
+
+// Función que junta en <globales> y <causticos> los fragmentos de fotones de los ficheros
+// <rutas> (ver trazarFragmentoFotones), trazados por separado y con el flujo repartido cada uno
+// entre sus propios caminos. Reescala el flujo de cada fragmento por su fracción del total de
+// caminos, de modo que el resultado equivale a haberlos trazado todos juntos, y devuelve ese
+// total. Lanza runtime_error si algún fichero no es válido o no hay ningún camino.
+uint64_t fusionarFotones(const vector<string>& rutas, vector<Photon>& globales, vector<Photon>& causticos);
 
 // Función que devuelve un PhotonMap dada una lista de fotones
 PhotonMap generarPhotonMap(vector<Photon>& vecFotones);
 
+// Función que devuelve un PhotonMap con los fotones de <vecFotones> en memoria si
+// <paginasCache> es 0, o paginados en disco con esa caché (ver MapaFotonesPaginado), vaciando
+// entonces <vecFotones>
+PhotonMap generarPhotonMap(vector<Photon>& vecFotones, const unsigned paginasCache);
+
 // Método que devuelve por referencia en <fotonesCercanos> los fotos más cercanos
 // a la posición <coordBusqueda>, dado un radio de busqueda maximo <radio> y un
-// numero maximo de fotones a encontrar <numFotones>
+// numero maximo de fotones a encontrar <numFotones>. Si se da <filtro>, solo se devuelven
+// los fotones que lo cumplen (en todas las variantes)
 void fotonesCercanos(const PhotonMap& photonMap, const array<float, 3>& coordBusqueda, float radio,
-                        unsigned long numFotones, vector<const Photon*>& fotonesCercanos);
+                        unsigned long numFotones, vector<const Photon*>& fotonesCercanos,
+                        const FiltroFotones* filtro = nullptr);
+
+// Método que devuelve por referencia en <fotonesCercanos>, para cada posición de <coordsBusqueda>,
+// los mismos fotones que fotonesCercanos con <radio> y <numFotones> (y el filtro de la misma
+// posición de <filtros>, si se da). Las búsquedas recorren el KDTree juntas (ver
+// nn::KDTree::nearest_neighbors_batch), lo que compensa para posiciones cercanas entre sí,
+// como las vistas por una tesela de píxeles
+void fotonesCercanosEnLote(const PhotonMap& photonMap, const vector<array<float, 3>>& coordsBusqueda,
+                           float radio, unsigned long numFotones, vector<vector<const Photon*>>& fotonesCercanos,
+                           const vector<FiltroFotones>* filtros = nullptr);
 
 // Método que devuelve por referencia en <fotonesCercanos> los fotos más cercanos
 // a la posición <coordBusqueda>, dado un numero maximo de fotones a encontrar <numFotones>
 void fotonesCercanosPorNumFotones(const PhotonMap& photonMap, const array<float, 3>& coordBusqueda,
-                        unsigned long numFotones, vector<const Photon*>& fotonesCercanos);
+                        unsigned long numFotones, vector<const Photon*>& fotonesCercanos,
+                        const FiltroFotones* filtro = nullptr);
 
 // Método que devuelve por referencia en <fotonesCercanos> los fotos más cercanos
 // a la posición <coordBusqueda>, dado un radio de busqueda maximo <radio>
 void fotonesCercanosPorRadio(const PhotonMap& photonMap, const array<float, 3>& coordBusqueda,
-                                float radio, vector<const Photon*>& fotonesCercanos);
\ No newline at end of file
+                                float radio, vector<const Photon*>& fotonesCercanos,
+                                const FiltroFotones* filtro = nullptr);
+
+// Método que devuelve por referencia en <fotonesCercanos> como mucho <numFotones> fotones
+// cercanos a <coordBusqueda>, empezando con un radio estimado con la densidad local del mapa
+// (ver RejillaDensidad). Si se encuentran menos de la mitad, duplica el radio hasta llegar a
+// <radioMaximo>, de modo que las zonas densas usan radios pequeños sin que el ruido se dispare
+// en las zonas poco densas
+void fotonesCercanosAdaptativo(const PhotonMap& photonMap, const array<float, 3>& coordBusqueda,
+                                float radioMaximo, unsigned long numFotones, vector<const Photon*>& fotonesCercanos,
+                                const FiltroFotones* filtro = nullptr);
\ No newline at end of file
@@ -8,7 +8,15 @@
 #include "photonMapping.h"
 #include "base.h"
 #include "gestorPPM.h"
+#include "aleatorio.h"
+#include "muestreador.h"
+#include "muestreo.h"
+#include "instrumentacion.h"
+#include "wavefront.h"
+#include "kernels.h"
+#include "vec3.h"
 #include <random>
+#include <chrono>
 #include <thread>
 #include <atomic>
 
@@ -24,63 +32,24 @@ void printTiempo(auto inicio, auto fin) {
     cout << "=========================================" << endl << endl;
 }
 
-void getCoordenadasCartesianas(const float azimut, const float inclinacion,
-                                float& x, float& y, float& z) {
-    float sinAzim = static_cast<float>(sin(float(azimut)));
-    float sinIncl = static_cast<float>(sin(float(inclinacion)));
-    float cosAzim = static_cast<float>(cos(float(azimut)));
-    float cosIncl = static_cast<float>(cos(float(inclinacion)));
-    x = sinIncl * cosAzim;
-    y = sinIncl * sinAzim;
-    z = cosIncl;
-}
-
-void generarAzimutInclinacionHemiesfera(float& azimut, float& inclinacion) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
-    inclinacion = acos(sqrt(1-dis(gen)));
-    azimut = 2 * M_PI * dis(gen);
-}
-
 Direccion generarDireccionAleatoriaHemiesfera(const Direccion& normal, float& prob) {
-    float inclinacion, azimut;
-    float x, y, z;
-
-    generarAzimutInclinacionHemiesfera(azimut, inclinacion);
-    getCoordenadasCartesianas(azimut, inclinacion, x, y, z);
-    Direccion wi_local = normalizar(Direccion(x, y, z));   // Inclinacion positiva, hemisferio norte asegurado
-    Direccion tangente;
-    Direccion bitangente;
-    construirBaseOrtonormal(normal, tangente, bitangente);
-    
-    // Cambio de base manual de <wi_local> de coord. locales a coord. globales
-    Direccion nuevaDir = normalizar(tangente * wi_local.coord[0] +
-                                    bitangente * wi_local.coord[1] +
-                                    normal * wi_local.coord[2]);
+    const float u1 = muestra();
+    const float u2 = muestra();
+    float cosTheta;
+    const Vec3 local = muestrearHemisferioCoseno(u1, u2, cosTheta);
+    const Vec3 n = normalizar(normal.vec());
+    Vec3 tangente, bitangente;
+    baseOrtonormal(n, tangente, bitangente);
     
     // Probabilidad de un rayo es proporcional al coseno del ángulo de inclinación
-    prob = cos(inclinacion) / M_PI;
-    return nuevaDir;
-}
-
-void generarAzimutInclinacionEsfera(float& azimut, float& inclinacion) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
-    inclinacion = acos((2.0f * dis(gen)) - 1.0f);
-    azimut = 2 * M_PI * dis(gen);
+    prob = cosTheta / M_PI;
+    return Direccion(aGlobal(local, tangente, bitangente, n));
 }
 
 Direccion generarDireccionAleatoriaEsfera() {
-    float inclinacion, azimut;
-    generarAzimutInclinacionEsfera(azimut, inclinacion);
-
-    float x, y, z;
-    getCoordenadasCartesianas(azimut, inclinacion, x, y, z);
-   
-    // Se devuelve en base global
-    return normalizar(Direccion(x, y, z));
+    const float u1 = muestra();
+    const float u2 = muestra();
+    return Direccion(muestrearEsferaUniforme(u1, u2));
 }
 
 Direccion calcDirEspecular(const Direccion& wo, const Direccion& n) {
@@ -146,10 +115,7 @@ TipoRayo dispararRuletaRusa(const BSDFs& coefs, float& probRuleta, const bool ha
     float probEspecular = maxKS / total;
     float probRefractante = maxKT / total;
     
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-    float bala = dist(gen);     // Random float entre (0,1)
+    float bala = muestra();     // Random float entre (0,1)
 
     if (bala <= probDifuso) {
         probRuleta = probDifuso;
@@ -176,270 +142,353 @@ RGB calcBrdfDifusa(const RGB& kd){
     return kd; // El M_PI que divide se anula con el de ProbDirRayo
 }
 
-void recursividadRandomWalk(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
-                            bool& fotonCaustico, const Escena& escena, const RGB& radianciaInicial,
-                            RGB& radianciaActual, const Punto& origen, const Direccion &wo_d,
-                            const BSDFs &coefsOrigen, const Direccion& normal, bool& primerFoton, const bool luzIndirecta) {
-    if (vecFotonesGlobales.size() >= vecFotonesGlobales.max_size() ||
-        vecFotonesCausticos.size() >= vecFotonesCausticos.max_size()) { // TERMINAL: no se pueden almacenar mas fotones
-        cout << endl << "-- LIMITE DE FOTONES ALCANZADO --" << endl << endl;
-        return;
-    }
-
-    if (modulo(radianciaActual) <= MARGEN_ERROR_FOTON) {    // TERMINAL: fotón ha perdido casi toda la energía
-        return;
-    }
-
-    /*
-    if(modulo(radianciaActual) > modulo(radianciaInicial)){
-        // Paramos la recursividad cuando el foton se ilumina mas que la luz (PRUEBA)
-        return;
+bool interaccionCaminoFoton(EstadoCamino& estado, vector<Photon>& vecFotonesGlobales,
+                            vector<Photon>& vecFotonesCausticos, const Parametros& parametros,
+                            Rayo& siguiente) {
+    if (modulo(estado.flujo) <= MARGEN_ERROR_FOTON) {    // TERMINAL: fotón ha perdido casi toda la energía
+        return false;
     }
-    */
 
     float probTipoRayo;
-    TipoRayo tipoRayo = dispararRuletaRusa(coefsOrigen, probTipoRayo);
+    TipoRayo tipoRayo = dispararRuletaRusa(*estado.coefs, probTipoRayo);
     if (tipoRayo == ABSORBENTE) {       // TERMINAL: rayo absorbente
-        //cout << " -- Acaba recurisividad: Rayo absorbente" << endl;
-        return;
+        return false;
     } else if (tipoRayo == DIFUSO) {
-        if(!primerFoton){
-            radianciaActual = radianciaActual * calcBrdfDifusa(coefsOrigen.kd);
-            radianciaActual = radianciaActual / probTipoRayo;
-            Photon foton = Photon(origen.coord, wo_d, radianciaActual);
-            //cout << "Rayo difuso, metemos foton " << foton << endl;
-
-            if(fotonCaustico){
+        estado.flujo = estado.flujo * calcBrdfDifusa(estado.coefs->kd) / probTipoRayo;
+        if (!estado.primerFoton) {
+            Photon foton = Photon(estado.origen.coord, estado.wo, estado.flujo);
+            if (estado.caustico) {
                 vecFotonesCausticos.push_back(foton);
             } else {
                 vecFotonesGlobales.push_back(foton);
             }
         } else {
             // Si se ha activado "nee", el primer foton no se almacena
-            primerFoton = false;
+            estado.primerFoton = false;
         }
-        
 
-        if(!luzIndirecta) return;
+        if (!parametros.luzIndirecta) return false;
 
     } else { // ESPECULAR o REFRACTANTE
-        if(!fotonCaustico) fotonCaustico = true;
+        const RGB& coef = (tipoRayo == ESPECULAR) ? estado.coefs->ks : estado.coefs->kt;
+        estado.flujo = estado.flujo * coef / probTipoRayo;
+        estado.caustico = true;
     }
 
-    float probDirRayo;
-    Rayo wi = obtenerRayoRuletaRusa(tipoRayo, origen, wo_d, normal, probDirRayo);
-    Primitiva* objIntersecado = nullptr;
-    Punto ptoIntersec;
-    Direccion nuevaNormal;
-    bool hayIntersec = escena.interseccion(wi, ptoIntersec, nuevaNormal, &objIntersecado);
-    if (!hayIntersec) {     // TERMINAL: el siguiente rayo (wi) no interseca con nada
-        //cout << " -- Acaba recurisividad: Rayo no interseca con nada" << endl;
-        return;
+    if (++estado.profundidad >= parametros.profundidadMaxima) {     // TERMINAL: profundidad máxima
+        return false;
     }
-    
-    recursividadRandomWalk(vecFotonesGlobales, vecFotonesCausticos, fotonCaustico, 
-                            escena, radianciaInicial, radianciaActual,
-                            ptoIntersec, wi.d, objIntersecado->coeficientes, nuevaNormal, primerFoton, luzIndirecta);
+
+    // Ruleta rusa por flujo: a partir de unos rebotes, el camino sobrevive con probabilidad
+    // proporcional a la energía que conserva respecto a la inicial (sin sesgo, se compensa el flujo)
+    if (estado.profundidad >= PROFUNDIDAD_MINIMA_RULETA) {
+        float probSupervivencia = std::min(1.0f, max(estado.flujo) / max(estado.flujoInicial));
+        if (muestra() >= probSupervivencia) {
+            return false;
+        }
+        estado.flujo = estado.flujo / probSupervivencia;
+    }
+
+    float probDirRayo;
+    siguiente = obtenerRayoRuletaRusa(tipoRayo, estado.origen, estado.wo, estado.normal, probDirRayo);
+    return true;
 }
 
-void comenzarRandomWalk(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
-                        const Escena& escena, const Rayo& wi, const RGB& flujoInicial, RGB& flujoRestante,
-                        const bool nee, const bool luzIndirecta){
-    Punto ptoIntersec;
-    Direccion normal;
+unsigned comenzarRandomWalk(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                            const Escena& escena, const Rayo& wi, const RGB& flujoInicial,
+                            const Parametros& parametros){
+    unsigned rayosTrazados = 1;
+    EstadoCamino estado;
+    estado.flujo = flujoInicial;
+    estado.flujoInicial = flujoInicial;
+    estado.profundidad = 0;
+    estado.caustico = false;
+    estado.primerFoton = parametros.nee;
+
+    Rayo rayo = wi;
     Primitiva* objIntersecado = nullptr;
-
-    if(escena.interseccion(wi, ptoIntersec, normal, &objIntersecado)){
-        // CUIDADO: si interseca con una fuente de luz !
-        //RGB powerLuz;
-        //if (escena.puntoPerteneceALuz(ptoIntersec, powerLuz)) {     // Para luces área
-        //    cout << endl << "Choca contra luz de área, muestreamos otro camino." << endl;
-        //    return;
-        //}
-
-        //cout << endl << "Comienza recursividad..." << endl;
-        //cout << "Interseca en punto " << ptoIntersec << ", coefs " << coefsPtoInterseccion;
-        //cout << " y normal " <<  normal << endl;
-        bool fotonCaustico = false;
-        bool primerFoton = nee;
-        recursividadRandomWalk(vecFotonesGlobales, vecFotonesCausticos, fotonCaustico, escena,
-                                flujoInicial, flujoRestante, ptoIntersec,
-                                wi.d, objIntersecado->coeficientes, normal, primerFoton, luzIndirecta);
-    } else {
-        //cout << endl << "Rayo no interseca con nada, muestreamos otro camino." << endl;
+    // TERMINAL: el siguiente rayo no interseca con nada o el camino termina en la interacción
+    while (escena.interseccion(rayo, estado.origen, estado.normal, &objIntersecado)) {
+        estado.wo = rayo.d;
+        estado.coefs = &objIntersecado->coeficientes;
+        if (!interaccionCaminoFoton(estado, vecFotonesGlobales, vecFotonesCausticos, parametros, rayo)) {
+            break;
+        }
+        rayosTrazados++;
     }
+    return rayosTrazados;
 }
 
 // Optamos por almacenar todos los rebotes difusos (incluido el primero)
 // y saltarnos el NextEventEstimation posteriormente
-int lanzarFotonesDeUnaLuz(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
-                          const int numFotonesALanzar, const RGB& flujoPorFoton, const LuzPuntual& luz,
-                          const Escena& escena, const bool nee, const bool luzIndirecta){
-    int numRandomWalksRestantes = numFotonesALanzar;
+Rayo emitirFoton(const Escena& escena, const int numFotonesTotales, RGB& flujo) {
+    float prob;
+    const unsigned emisor = escena.tablaEmisores.muestrear(muestra(), prob);
+    if (emisor < escena.luces.size()) {
+        const LuzPuntual& luz = escena.luces[emisor];
+        flujo = (4 * M_PI * luz.p) / (numFotonesTotales * prob);
+        return Rayo(generarDireccionAleatoriaEsfera(), luz.c);
+    }
+
+    // Luz de área: L * cos / (p(A) * p(w)) con p(w) = cos / PI
+    const Primitiva* luz = escena.lucesArea[emisor - escena.luces.size()];
+    float probArea, probDir;
+    Punto origen = luz->generarPuntoAleatorio(probArea);
+    Direccion dir = generarDireccionAleatoriaHemiesfera(normalizar(luz->getNormal(origen)), probDir);
+    flujo = (M_PI * luz->power) / (probArea * numFotonesTotales * prob);
+    return Rayo(dir, origen);
+}
+
+void sembrarThread(const Parametros& parametros, const unsigned paso, const unsigned idThread) {
+    if (parametros.semilla != 0) {
+        sembrarGeneradorThread(mezclarSemilla(mezclarSemilla(parametros.semilla, paso), idThread));
+    }
+}
+
+int lanzarFotones(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos, const int numFotonesALanzar,
+                  const int numFotonesTotales, const Escena& escena, const Parametros& parametros,
+                  unsigned long& rayosTrazados){
     int numFotonesLanzados = 0;
+    Muestreador muestreador(parametros.muestreador, generadorThread()());
+    activarMuestreador(&muestreador);
     
-    while(numRandomWalksRestantes > 0 
-            && vecFotonesGlobales.size() < vecFotonesGlobales.max_size()
-            && vecFotonesGlobales.size() < vecFotonesGlobales.max_size()){
-        if(numRandomWalksRestantes % 100000 == 0){ cout << "Fotones restantes: " << numRandomWalksRestantes << endl;}
-        //cout << "Nuevo random path, numRandomWalksRestantes = " << numRandomWalksRestantes;
-        //cout << ", numFotonesLanzados = " << numFotonesLanzados  << endl;
-        numRandomWalksRestantes--;
+    for (int numRandomWalksRestantes = numFotonesALanzar; numRandomWalksRestantes > 0; --numRandomWalksRestantes) {
+        muestreador.comenzarMuestra(numFotonesLanzados);
         numFotonesLanzados++;
 
-        Rayo wi(generarDireccionAleatoriaEsfera(), luz.c);
-        //cout << "Rayo aleatorio generado desde luz para randomWalk = " << wi << endl;
-        RGB flujoRestante = flujoPorFoton;
-        comenzarRandomWalk(vecFotonesGlobales, vecFotonesCausticos, escena, wi, flujoPorFoton, flujoRestante, nee, luzIndirecta);
+        RGB flujoFoton;
+        Rayo wi = emitirFoton(escena, numFotonesTotales, flujoFoton);
+        rayosTrazados += comenzarRandomWalk(vecFotonesGlobales, vecFotonesCausticos, escena, wi,
+                                            flujoFoton, parametros);
     }
+    activarMuestreador(nullptr);
 
     return numFotonesLanzados;
 }
 
-float calcularPotenciaTotal(const vector<LuzPuntual>& luces){
-    float total;
-    for(auto& luz : luces){
-        total += modulo(luz.p);
+int trazarFotones(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                  const Escena& escena, const Parametros& parametros){
+    return trazarFotones(vecFotonesGlobales, vecFotonesCausticos, escena, parametros, parametros.numRandomWalks,
+                         thread::hardware_concurrency(), 0);
+}
+
+int trazarFotones(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                  const Escena& escena, const Parametros& parametros, const int totalFotonesALanzar,
+                  const unsigned maxTrozos, const unsigned primerTrozo){
+    auto inicio = std::chrono::steady_clock::now();
+    int caminosLanzados = 0;
+    unsigned long rayosTrazados = 0;
+    const EscenaSoA escenaSoA = parametros.trazadoWavefront ? EscenaSoA(escena) : EscenaSoA();
+
+    // Cada fotón elige su luz con la tabla de alias de la escena, así que los fotones se
+    // pueden repartir en trozos arbitrarios: uno por thread, cada uno con sus propios vectores
+    if (escena.tablaEmisores.size() == 0 || totalFotonesALanzar <= 0) {
+        cerr << "AVISO: no hay luces o fotones que lanzar" << endl;
+    } else {
+        MEDIR_FASE(FASE_TRAZADO_FOTONES);
+        const unsigned numTrozos = std::max(1u, std::min(maxTrozos, static_cast<unsigned>(totalFotonesALanzar)));
+        vector<vector<Photon>> globalesTrozo(numTrozos), causticosTrozo(numTrozos);
+        vector<unsigned long> rayosTrozo(numTrozos, 0);
+        vector<int> caminosTrozo(numTrozos, 0);
+        vector<thread> threads;
+        for (unsigned t = 0; t < numTrozos; ++t) {
+            const int numFotonesTrozo = totalFotonesALanzar / numTrozos + (t < totalFotonesALanzar % numTrozos ? 1 : 0);
+            threads.emplace_back([&, t, numFotonesTrozo]() {
+                sembrarThread(parametros, 1, primerTrozo + t);
+                if (parametros.trazadoWavefront) {
+                    caminosTrozo[t] = lanzarFotonesWavefront(globalesTrozo[t], causticosTrozo[t], numFotonesTrozo,
+                                                             totalFotonesALanzar, escena, escenaSoA, parametros,
+                                                             rayosTrozo[t]);
+                } else {
+                    caminosTrozo[t] = lanzarFotones(globalesTrozo[t], causticosTrozo[t], numFotonesTrozo,
+                                                    totalFotonesALanzar, escena, parametros, rayosTrozo[t]);
+                }
+            });
+        }
+        for (thread& th : threads) {
+            th.join();
+        }
+
+        // Cada trozo se libera al juntarlo, para no tener todos los fotones dos veces en memoria
+        auto juntar = [](vector<Photon>& destino, vector<Photon>& trozo) {
+            if (destino.empty()) {
+                destino.swap(trozo);
+            } else {
+                destino.insert(destino.end(), trozo.begin(), trozo.end());
+            }
+            vector<Photon>().swap(trozo);
+        };
+        for (unsigned t = 0; t < numTrozos; ++t) {
+            juntar(vecFotonesGlobales, globalesTrozo[t]);
+            juntar(vecFotonesCausticos, causticosTrozo[t]);
+            caminosLanzados += caminosTrozo[t];
+            rayosTrazados += rayosTrozo[t];
+        }
     }
 
-    return total;
+    std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - inicio;
+    cout << "Caminos de fotones trazados: " << caminosLanzados << " en " << duracion.count() << " s ("
+         << caminosLanzados / duracion.count() << " caminos/s, "
+         << rayosTrazados / duracion.count() / 1e6 << " Mrayos/s"
+         << (parametros.trazadoWavefront ? ", wavefront" : "") << ")" << endl;
+    return caminosLanzados;
+}
+
+int trazarFragmentoFotones(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                           const Escena& escena, const Parametros& parametros, const unsigned fragmento,
+                           const unsigned numFragmentos, const unsigned numThreads){
+    if (numFragmentos == 0 || fragmento >= numFragmentos) {
+        throw invalid_argument("fragmento " + std::to_string(fragmento) + " fuera de rango (hay "
+                               + std::to_string(numFragmentos) + ")");
+    }
+    if (numFragmentos > MAX_FRAGMENTOS) {
+        throw invalid_argument("no puede haber más de " + std::to_string(MAX_FRAGMENTOS) + " fragmentos");
+    }
+    if (numThreads == 0 || numThreads > MAX_TROZOS_FRAGMENTO) {
+        throw invalid_argument("el número de threads de un fragmento debe estar entre 1 y "
+                               + std::to_string(MAX_TROZOS_FRAGMENTO));
+    }
+    // Con la semilla 0 cada thread tomaría una aleatoria y los fragmentos no serían reproducibles
+    Parametros parametrosFragmento = parametros;
+    if (parametrosFragmento.semilla == 0) {
+        cerr << "AVISO: los fragmentos necesitan una semilla fija, se usa " << SEMILLA_FRAGMENTOS << endl;
+        parametrosFragmento.semilla = SEMILLA_FRAGMENTOS;
+    }
+    const int total = parametros.numRandomWalks;
+    const int numCaminos = total / numFragmentos + (fragmento < total % numFragmentos ? 1 : 0);
+    return trazarFotones(vecFotonesGlobales, vecFotonesCausticos, escena, parametrosFragmento, numCaminos,
+                         numThreads, fragmento * MAX_TROZOS_FRAGMENTO);
 }
 
 void paso1GenerarPhotonMap(PhotonMap& mapaFotonesGlobales, PhotonMap& mapaFotonesCausticos,
                             size_t& numFotonesGlobales, size_t& numFotonesCausticos, 
-                            const int totalFotonesALanzar, const Escena& escena, const bool nee, const bool luzIndirecta){
+                            const Escena& escena, const Parametros& parametros){
+    MEDIR_FASE(FASE_PASO1);
     vector<Photon> vecFotonesGlobales;
     vector<Photon> vecFotonesCausticos;
-    //cout << vecFotones.max_size() << endl;
-    //cout << "Generando " << totalFotonesALanzar << " fotones en total..." << endl;
-    float potenciaTotal = calcularPotenciaTotal(escena.luces);
-    //cout << "Potencia total: " << potenciaTotal << endl;
-
-
-    for(auto& luz : escena.luces) {  // Cada luz lanza num fotones proporcional a su potencia
-        int numFotonesALanzar = totalFotonesALanzar * (modulo(luz.p) / potenciaTotal);
-        RGB flujoFoton = (4 * M_PI * luz.p)/numFotonesALanzar;
-
-        //cout << endl << "Generando " << numFotonesALanzar << " fotones para luz..." << endl;
-        //cout << "Flujo inicial de cada foton: " << flujoFoton << endl;
-        //cout << flujoFoton << endl;
-        
-        // No se ajusta la S posteriormente ya que ralentiza mucho la ejecución
-        // y  realmente solo se pasa del límite del vector con totalFotonesALanzar
-        // ridículamente altos
-        lanzarFotonesDeUnaLuz(vecFotonesGlobales, vecFotonesCausticos, numFotonesALanzar,  
-                                                        flujoFoton, luz, escena, nee, luzIndirecta);
-    }
+    trazarFotones(vecFotonesGlobales, vecFotonesCausticos, escena, parametros);
 
     //printVectorFotones(vecFotones);
-    mapaFotonesGlobales = std::move(generarPhotonMap(vecFotonesGlobales));
-    mapaFotonesCausticos = std::move(generarPhotonMap(vecFotonesCausticos));
-    
     numFotonesGlobales = vecFotonesGlobales.size();
     numFotonesCausticos = vecFotonesCausticos.size();
+    {
+        MEDIR_FASE(FASE_CONSTRUCCION_KDTREE);
+        mapaFotonesGlobales = std::move(generarPhotonMap(vecFotonesGlobales, parametros.paginasCacheFotones));
+        mapaFotonesCausticos = std::move(generarPhotonMap(vecFotonesCausticos, parametros.paginasCacheFotones));
+        if (parametros.toleranciaLOD > 0.0f) {
+            mapaFotonesGlobales.construirAgregados();
+        }
+    }
+    
+    CONTAR(FOTONES_GLOBALES, numFotonesGlobales);
+    CONTAR(FOTONES_CAUSTICOS, numFotonesCausticos);
 
     cout << "Numero total de fotones DIFUSOS guardados: " << numFotonesGlobales << endl;
     cout << "Numero total de fotones CAUSTICOS guardados: " << numFotonesCausticos << endl;
 }
 
-void printVectorFotones(const vector<Photon>& vecFotones){
-    for (auto& foton : vecFotones){
-        cout << foton << endl;
+void paso1CargarPhotonMap(PhotonMap& mapaFotonesGlobales, PhotonMap& mapaFotonesCausticos,
+                          size_t& numFotonesGlobales, size_t& numFotonesCausticos, const string& rutaFotones,
+                          const Parametros& parametros){
+    MEDIR_FASE(FASE_PASO1);
+    vector<Photon> vecFotonesGlobales;
+    vector<Photon> vecFotonesCausticos;
+    const uint64_t caminos = cargarFotones(rutaFotones, vecFotonesGlobales, vecFotonesCausticos);
+    cout << "Fotones de " << caminos << " caminos leidos de " << rutaFotones << endl;
+    numFotonesGlobales = vecFotonesGlobales.size();
+    numFotonesCausticos = vecFotonesCausticos.size();
+    {
+        MEDIR_FASE(FASE_CONSTRUCCION_KDTREE);
+        mapaFotonesGlobales = std::move(generarPhotonMap(vecFotonesGlobales, parametros.paginasCacheFotones));
+        mapaFotonesCausticos = std::move(generarPhotonMap(vecFotonesCausticos, parametros.paginasCacheFotones));
+        if (parametros.toleranciaLOD > 0.0f) {
+            mapaFotonesGlobales.construirAgregados();
+        }
     }
-}
 
-RGB radianciaKernelConstante(const Photon* photon, const float radio){
-    return photon->flujo/(M_PI * pow(radio, 2.0f));
+    CONTAR(FOTONES_GLOBALES, numFotonesGlobales);
+    CONTAR(FOTONES_CAUSTICOS, numFotonesCausticos);
 }
 
-float distanciaEntreFotonYPunto(const Photon* photon, const Punto& centro){
-    Punto puntoFoton = Punto(photon->coord);
-    return modulo(puntoFoton - centro);
-}
-
-RGB radianciaKernelGaussiano(const Photon* photon, const float radioMaximo, 
-                                const Punto& centro){
-    float radioAFoton = distanciaEntreFotonYPunto(photon, centro);
-    float raizDosPi = sqrt(2*M_PI);
-    float cteNormalizacion = 1/(radioMaximo*raizDosPi);
-    float numeradorExp = pow(radioAFoton, 2);
-    float denominadorExp = 2*pow(radioMaximo, 2);
-    float exponente = -numeradorExp/denominadorExp;
-    float kernel = cteNormalizacion*pow(M_E, exponente);
-    return photon->flujo*kernel;
-}
-
-RGB radianciaKernelConico(const Photon* photon, const float radioMaximo, const Punto& centro){
-    float radioAFoton = distanciaEntreFotonYPunto(photon, centro);
-    float kernel = 1 - (radioAFoton/radioMaximo);
-    return photon->flujo*kernel;
-}
-
-RGB radianciaKernelEpanechnikov(const Photon* photon, const float radioMaximo, const Punto& centro){
-    float radioAFoton = distanciaEntreFotonYPunto(photon, centro);
-    float divisionAlCuadrado = pow((radioAFoton/radioMaximo), 2);
-    float kernel = (3.0f/4.0f) * (1 - divisionAlCuadrado);
-    return photon->flujo*kernel;
+void printVectorFotones(const vector<Photon>& vecFotones){
+    for (auto& foton : vecFotones){
+        cout << foton << endl;
+    }
 }
 
-RGB radianciaKernelBipeso(const Photon* photon, const float radioMaximo, const Punto& centro){
-    float radioAFoton = distanciaEntreFotonYPunto(photon, centro);
-    float divisionAlCuadrado = pow((radioAFoton/radioMaximo), 2);
-    float kernel = (15.0f/16.0f) * pow((1 - divisionAlCuadrado), 2);
-    return photon->flujo*kernel;
+// Función que devuelve el filtro de fotones del punto <ptoIntersec> con normal <normal> al que
+// llega un rayo de cámara por <dirIncidente>, con la normal orientada hacia el lado del rayo
+static FiltroFotones filtroPunto(const Punto& ptoIntersec, const Direccion& dirIncidente, const Direccion& normal,
+                                 const Parametros& parametros) {
+    const Vec3 n = normalizar(normal.vec());
+    return {ptoIntersec.vec(), dot(n, dirIncidente.vec()) > 0.0f ? -n : n, parametros.grosorDisco};
 }
 
-RGB radianciaKernelLogistico(const Photon* photon, const float radioMaximo, const Punto& centro){
-    float radioAFoton = distanciaEntreFotonYPunto(photon, centro);
-    float division = radioAFoton/radioMaximo;
-    float denominador = pow(M_E, division) + 2 + pow(M_E, -division);
-    float kernel = 1/denominador;
-    return photon->flujo*kernel;
+// Función que indica si la radiancia de los fotones globales de <mapa> se estima con sus
+// agregados (ver PhotonMap::fotonesConAgregados): con <parametros.toleranciaLOD> > 0, búsqueda
+// por RADIO (la esfera no depende de los fotones que se encuentran) y sin filtroNormal (un
+// agregado no sabe desde dónde llegan sus fotones)
+static bool usarAgregados(const PhotonMap& mapa, const Parametros& parametros) {
+    return parametros.toleranciaLOD > 0.0f && parametros.tipoVecinosGlobales == RADIO &&
+           !parametros.filtroNormal && !mapa.agregados.empty();
 }
 
-float maximoRadio(const Punto& ptoIntersec, const vector<const Photon*> fotonesCercanos){
-    float maximoRadio = 0.0f;
-    for(auto& foton : fotonesCercanos){
-        float distanciaFoton = distanciaEntreFotonYPunto(foton, ptoIntersec);
-        if(distanciaFoton > maximoRadio){
-            maximoRadio = distanciaFoton;
-        }
-    }
-    return maximoRadio;
+// Función que devuelve la radiancia de los fotones de <mapa> a menos de
+// <parametros.vecinosGlobalesRadio> de <centro>, sumando como uno los grupos que permite
+// <parametros.toleranciaLOD>. El radio del kernel llega al menos hasta esos grupos.
+static RGB radianciaConAgregados(const PhotonMap& mapa, const Punto& centro, const Parametros& parametros) {
+    thread_local vector<const Photon*> fotones;
+    thread_local vector<Photon> agrupados;
+    float distanciaAgrupados2;
+    mapa.fotonesConAgregados(centro.coord, parametros.vecinosGlobalesRadio, parametros.toleranciaLOD, fotones,
+                             agrupados, distanciaAgrupados2);
+    for (const Photon& foton : agrupados) fotones.push_back(&foton);
+    return radianciaKernel(fotones, centro, parametros.kernel, distanciaAgrupados2);
 }
 
-
 RGB estimarEcuacionRender(const Escena& escena, const PhotonMap& mapaFotonesGlobales, const PhotonMap& mapaFotonesCausticos,
                             const size_t numFotonesGlobales, const size_t numFotonesCausticos, const Punto& ptoIntersec, const Direccion& dirIncidente,
                             const Direccion& normal, const BSDFs& coefsPtoInterseccion, const Parametros& parametros){
+    const FiltroFotones filtro = filtroPunto(ptoIntersec, dirIncidente, normal, parametros);
+    const FiltroFotones* pFiltro = parametros.filtroNormal ? &filtro : nullptr;
+
     vector<const Photon*> fotonesCercanosGlobales;
-    if(parametros.tipoVecinosGlobales == RADIO) {
+    const bool conAgregados = usarAgregados(mapaFotonesGlobales, parametros);
+    if (conAgregados) {
+        // Los fotones globales se buscan al estimar su radiancia, con radianciaConAgregados
+    } else if(parametros.tipoVecinosGlobales == RADIO) {
         fotonesCercanosPorRadio(mapaFotonesGlobales, ptoIntersec.coord, 
-                                    static_cast<float>(parametros.vecinosGlobalesRadio), fotonesCercanosGlobales);
+                                    static_cast<float>(parametros.vecinosGlobalesRadio), fotonesCercanosGlobales, pFiltro);
     } else if (parametros.tipoVecinosGlobales == PORCENTAJE){
         fotonesCercanosPorNumFotones(mapaFotonesGlobales, ptoIntersec.coord, 
-                                    static_cast<unsigned long>(numFotonesGlobales * parametros.vecinosGlobalesNum), fotonesCercanosGlobales);
+                                    static_cast<unsigned long>(numFotonesGlobales * parametros.vecinosGlobalesNum), fotonesCercanosGlobales, pFiltro);
     } else if (parametros.tipoVecinosGlobales == NUMERO){
         fotonesCercanosPorNumFotones(mapaFotonesGlobales, ptoIntersec.coord, 
-                                    static_cast<unsigned long>(parametros.vecinosGlobalesNum), fotonesCercanosGlobales);
+                                    static_cast<unsigned long>(parametros.vecinosGlobalesNum), fotonesCercanosGlobales, pFiltro);
+    } else if (parametros.tipoVecinosGlobales == ADAPTATIVO){
+        fotonesCercanosAdaptativo(mapaFotonesGlobales, ptoIntersec.coord, static_cast<float>(parametros.vecinosGlobalesRadio),
+                                  parametros.vecinosGlobalesNum, fotonesCercanosGlobales, pFiltro);
     } else { // RADIONUMERO
         fotonesCercanos(mapaFotonesGlobales, ptoIntersec.coord, static_cast<float>(parametros.vecinosGlobalesRadio),
-                        parametros.vecinosGlobalesNum, fotonesCercanosGlobales);
+                        parametros.vecinosGlobalesNum, fotonesCercanosGlobales, pFiltro);
     }
 
     vector<const Photon*> fotonesCercanosCausticos;
     if(parametros.tipoVecinosCausticos == RADIO) {
         fotonesCercanosPorRadio(mapaFotonesCausticos, ptoIntersec.coord, 
-                                    static_cast<float>(parametros.vecinosCausticosRadio), fotonesCercanosCausticos);
+                                    static_cast<float>(parametros.vecinosCausticosRadio), fotonesCercanosCausticos, pFiltro);
     } else if (parametros.tipoVecinosCausticos == PORCENTAJE){
         fotonesCercanosPorNumFotones(mapaFotonesCausticos, ptoIntersec.coord, 
-                                    static_cast<unsigned long>(numFotonesCausticos * parametros.vecinosCausticosNum), fotonesCercanosCausticos);
+                                    static_cast<unsigned long>(numFotonesCausticos * parametros.vecinosCausticosNum), fotonesCercanosCausticos, pFiltro);
     } else if (parametros.tipoVecinosCausticos == NUMERO){
         fotonesCercanosPorNumFotones(mapaFotonesCausticos, ptoIntersec.coord, 
-                                    static_cast<unsigned long>(parametros.vecinosCausticosNum), fotonesCercanosCausticos);
+                                    static_cast<unsigned long>(parametros.vecinosCausticosNum), fotonesCercanosCausticos, pFiltro);
+    } else if (parametros.tipoVecinosCausticos == ADAPTATIVO){
+        fotonesCercanosAdaptativo(mapaFotonesCausticos, ptoIntersec.coord, static_cast<float>(parametros.vecinosCausticosRadio),
+                                  parametros.vecinosCausticosNum, fotonesCercanosCausticos, pFiltro);
     } else { // RADIONUMERO
         fotonesCercanos(mapaFotonesCausticos, ptoIntersec.coord, static_cast<float>(parametros.vecinosCausticosRadio),
-                        parametros.vecinosCausticosNum, fotonesCercanosCausticos);
+                        parametros.vecinosCausticosNum, fotonesCercanosCausticos, pFiltro);
     }
 
     /*
@@ -451,58 +500,102 @@ RGB estimarEcuacionRender(const Escena& escena, const PhotonMap& mapaFotonesGlob
 
     */
 
-    RGB radiancia(0.0f, 0.0f, 0.0f);
-    float radioMaximoCausticos = maximoRadio(ptoIntersec, fotonesCercanosCausticos);
-    float radioMaximoGlobales = maximoRadio(ptoIntersec, fotonesCercanosGlobales);
+    RGB radiancia = radianciaKernel(fotonesCercanosCausticos, ptoIntersec, parametros.kernel)
+                   + (conAgregados ? radianciaConAgregados(mapaFotonesGlobales, ptoIntersec, parametros)
+                                   : radianciaKernel(fotonesCercanosGlobales, ptoIntersec, parametros.kernel));
 
-    for (const Photon* photon : fotonesCercanosCausticos) {
-        if (photon) {
-            //radiancia += radianciaKernelConstante(photon, parametros.vecinosGlobalesRadio);
-            radiancia += radianciaKernelGaussiano(photon, radioMaximoCausticos, ptoIntersec);
-            //radiancia += radianciaKernelEpanechnikov(photon, radioMaximoCausticos, ptoIntersec);
-            //radiancia += radianciaKernelBipeso(photon, radioMaximoCausticos, ptoIntersec);
-            //radiancia += radianciaKernelLogistico(photon, radioMaximoCausticos, ptoIntersec);
-            //radiancia += radianciaKernelConico(photon, radioMaximoCausticos, ptoIntersec);
-        }
-    }
+    return radiancia;
+}
 
-    for (const Photon* photon : fotonesCercanosGlobales) {
-        if (photon) {
-            //radiancia += radianciaKernelConstante(photon, parametros.vecinosGlobalesRadio);
-            radiancia += radianciaKernelGaussiano(photon, radioMaximoGlobales, ptoIntersec);
-            //radiancia += radianciaKernelEpanechnikov(photon, radioMaximoGlobales, ptoIntersec);
-            //radiancia += radianciaKernelBipeso(photon, radioMaximoGlobales, ptoIntersec);
-            //radiancia += radianciaKernelLogistico(photon, radioMaximoGlobales, ptoIntersec);
-            //radiancia += radianciaKernelConico(photon, radioMaximoGlobales, ptoIntersec);
-        }
+
+
+// Función que devuelve la radiancia que refleja <p0> debida a la luz puntual <luz>
+static RGB radianciaDirectaLuz(const Punto& p0, const Direccion& normal, const Escena& escena,
+                               const Primitiva* objOrigen, const LuzPuntual& luz) {
+    if (!escena.luzIluminaPunto(p0, luz)) {
+        return RGB(0.0f, 0.0f, 0.0f);
     }
 
-    return radiancia;
+    Direccion dirIncidente = luz.c - p0;
+    float cosAnguloIncidencia = calcCosenoAnguloIncidencia(normalizar(dirIncidente), normal);
+    RGB reflectanciaBrdfDifusa = calcBrdfDifusa(objOrigen->kd(p0));
+    RGB radianciaIncidente = luz.p / (modulo(dirIncidente) * modulo(dirIncidente));
+    return radianciaIncidente * (reflectanciaBrdfDifusa * cosAnguloIncidencia);
 }
 
+// Función que devuelve la radiancia que refleja <p0> debida a la luz de área <luz>, estimada
+// con <numMuestras> puntos de la luz. Las muestras se estratifican por hipercubo latino:
+// cada coordenada cae en un estrato distinto de [0,1), emparejados al azar.
+static RGB radianciaDirectaLuzArea(const Punto& p0, const Direccion& normal, const Escena& escena,
+                                   const Primitiva* objOrigen, const Primitiva* luz, const unsigned numMuestras) {
+    thread_local vector<unsigned> estratos;
+    estratos.resize(numMuestras);
+    for (unsigned i = 0; i < numMuestras; ++i) estratos[i] = i;
+    std::shuffle(estratos.begin(), estratos.end(), generadorThread());
+
+    RGB radianciaSaliente(0.0f, 0.0f, 0.0f);
+    const RGB reflectanciaBrdfDifusa = calcBrdfDifusa(objOrigen->kd(p0));
+    for (unsigned i = 0; i < numMuestras; ++i) {
+        const float u1 = (i + numeroAleatorio()) / numMuestras;
+        const float u2 = (estratos[i] + numeroAleatorio()) / numMuestras;
+        Punto origenLuz;
+        float prob;
+        if (!escena.luzIluminaPunto(p0, luz, u1, u2, origenLuz, prob)) {
+            continue;
+        }
 
+        float cosAnguloIncidencia = calcCosenoAnguloIncidencia(origenLuz - p0, normal);
+        radianciaSaliente += luz->power * reflectanciaBrdfDifusa * (cosAnguloIncidencia / prob);
+    }
+    return radianciaSaliente / numMuestras;
+}
 
 RGB nextEventEstimation(const Punto& p0, const Direccion& normal, const Escena& escena,
-                        const Primitiva* objOrigen) {
+                        const Primitiva* objOrigen, const unsigned numLucesNEE,
+                        const unsigned muestrasLuzArea) {
     RGB radianciaSaliente(0.0f, 0.0f, 0.0f);
-    for (LuzPuntual luz : escena.luces) {
-        if (!escena.luzIluminaPunto(p0, luz)) {
-            continue;     // Si el punto no está iluminado, nos saltamos la iteración
+    if (numLucesNEE == 0 || numLucesNEE >= escena.luces.size() || escena.tablaLuces.size() != escena.luces.size()) {
+        for (const LuzPuntual& luz : escena.luces) {
+            radianciaSaliente += radianciaDirectaLuz(p0, normal, escena, objOrigen, luz);
+        }
+    } else {
+        RGB radianciaPuntuales(0.0f, 0.0f, 0.0f);
+        for (unsigned i = 0; i < numLucesNEE; ++i) {
+            float prob;
+            const LuzPuntual& luz = escena.luces[escena.tablaLuces.muestrear(numeroAleatorio(), prob)];
+            radianciaPuntuales += radianciaDirectaLuz(p0, normal, escena, objOrigen, luz) / prob;
         }
+        radianciaSaliente += radianciaPuntuales / numLucesNEE;
+    }
 
-        Direccion dirIncidente = luz.c - p0;
-        float cosAnguloIncidencia = calcCosenoAnguloIncidencia(normalizar(dirIncidente), normal);
-        RGB reflectanciaBrdfDifusa = calcBrdfDifusa(objOrigen->kd(p0));
-        RGB radianciaIncidente = luz.p / (modulo(dirIncidente) * modulo(dirIncidente));
-        radianciaIncidente = radianciaIncidente * (reflectanciaBrdfDifusa * cosAnguloIncidencia);
-        
-        radianciaSaliente += radianciaIncidente;
+    if (muestrasLuzArea > 0) {
+        for (const Primitiva* luz : escena.lucesArea) {
+            if (luz == objOrigen) continue;     // Una superficie plana o convexa no se ilumina a sí misma
+            radianciaSaliente += radianciaDirectaLuzArea(p0, normal, escena, objOrigen, luz, muestrasLuzArea);
+        }
     }
-    
-    int num_luces = 0;
-    
-    num_luces = max(num_luces, 1);
-    return radianciaSaliente / num_luces;
+    return radianciaSaliente;
+}
+
+// Función que sigue el rayo <wi> a través de las superficies especulares y refractantes, eligiendo
+// en cada choque el tipo de rebote por ruleta rusa, hasta que choca con una superficie difusa.
+// Devuelve false si el rayo sale de la escena; si no, deja en <wi> el último rayo, en <ptoIntersec>,
+// <normal> y <objIntersecado> el choque difuso y en <probTipoRayo> la probabilidad de la ruleta en él
+static bool trazarHastaDifuso(Rayo& wi, const Escena& escena, Punto& ptoIntersec, Direccion& normal,
+                              Primitiva*& objIntersecado, float& probTipoRayo) {
+    while (escena.interseccion(wi, ptoIntersec, normal, &objIntersecado)) {
+        TipoRayo tipoRayo = dispararRuletaRusa(objIntersecado->coeficientes, probTipoRayo, false);
+        if (tipoRayo == DIFUSO) {
+            return true;
+        } else if (tipoRayo == ESPECULAR || tipoRayo == REFRACTANTE) {
+            float probDirRayo;
+            wi = obtenerRayoRuletaRusa(tipoRayo, ptoIntersec, wi.d, normal, probDirRayo);
+        } else {    // No debería pasar nunca
+            cerr << "ERROR: rayo absorbente en paso 2" << endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    return false;
 }
 
 RGB obtenerRadianciaPixel(const Rayo& rayoIncidente, const Escena& escena, 
@@ -515,34 +608,13 @@ RGB obtenerRadianciaPixel(const Rayo& rayoIncidente, const Escena& escena,
     RGB radianciaIndirecta(0.0f, 0.0f, 0.0f);
     BSDFs coefsPtoInterseccion;
     Rayo wi = rayoIncidente;
-    bool choqueContraDifuso = false;
-    bool hayInterseccion = false;
     Primitiva* objIntersecado = nullptr;
     float probTipoRayo;
     
-    while (!choqueContraDifuso) {
-        hayInterseccion = escena.interseccion(wi, ptoIntersec, normal, &objIntersecado);
-        if (!hayInterseccion) {
-            break;
-        } else {
-            TipoRayo tipoRayo = dispararRuletaRusa(objIntersecado->coeficientes, probTipoRayo, false);
-            if (tipoRayo == DIFUSO) {
-                choqueContraDifuso = true;
-            } else if (tipoRayo == ESPECULAR || tipoRayo == REFRACTANTE) {
-                float probDirRayo;
-                wi = obtenerRayoRuletaRusa(tipoRayo, ptoIntersec, wi.d, normal, probDirRayo);
-            } else {    // No debería pasar nunca
-                cerr << "ERROR: rayo absorbente en paso 2" << endl;
-                std::exit(EXIT_FAILURE);
-            }
-            
-            
-        }
-    }
-    
-    if (choqueContraDifuso && hayInterseccion){
+    if (trazarHastaDifuso(wi, escena, ptoIntersec, normal, objIntersecado, probTipoRayo)){
         if(parametros.nee){
-            radianciaDirecta = nextEventEstimation(ptoIntersec, normal, escena, objIntersecado);
+            radianciaDirecta = nextEventEstimation(ptoIntersec, normal, escena, objIntersecado,
+                                                   parametros.numLucesNEE, parametros.muestrasLuzArea);
         }
         
         radianciaIndirecta = estimarEcuacionRender(escena, mapaFotonesGlobales, mapaFotonesCausticos,
@@ -554,6 +626,212 @@ RGB obtenerRadianciaPixel(const Rayo& rayoIncidente, const Escena& escena,
     }
 }
 
+RGB obtenerRadianciaPixelAntialiasing(const Camara& camara, const Escena& escena, const unsigned ancho,
+                                      const float anchoPorPixel, const unsigned alto, const float altoPorPixel,
+                                      const PhotonMap& mapaFotonesGlobales, const PhotonMap& mapaFotonesCausticos,
+                                      const size_t numFotonesGlobales, const size_t numFotonesCausticos,
+                                      const Parametros& parametros) {
+    Muestreador muestreador(parametros.muestreador, generadorThread()());
+    activarMuestreador(&muestreador);
+    RGB radianciaTotal;
+    for (unsigned i = 0; i < parametros.rpp; ++i) {
+        muestreador.comenzarMuestra(i);
+        Rayo rayo = camara.obtenerRayoAleatorioPixel(ancho, anchoPorPixel, alto, altoPorPixel);
+        globalizarYNormalizarRayo(rayo, camara.o, camara.f, camara.u, camara.l);
+        radianciaTotal += obtenerRadianciaPixel(rayo, escena, mapaFotonesGlobales, mapaFotonesCausticos,
+                                                numFotonesGlobales, numFotonesCausticos, parametros);
+    }
+    activarMuestreador(nullptr);
+
+    return radianciaTotal / parametros.rpp;
+}
+
+RGB obtenerColorPixel(const Camara& camara, const Escena& escena, const unsigned ancho, const unsigned alto,
+                      const float tamanoPorPixel, const PhotonMap& mapaFotonesGlobales,
+                      const PhotonMap& mapaFotonesCausticos, const size_t numFotonesGlobales,
+                      const size_t numFotonesCausticos, const Parametros& parametros) {
+    if (parametros.rpp == 1) {
+        Rayo rayo = camara.obtenerRayoCentroPixel(ancho, tamanoPorPixel, alto, tamanoPorPixel);
+        globalizarYNormalizarRayo(rayo, camara.o, camara.f, camara.u, camara.l);
+        return obtenerRadianciaPixel(rayo, escena, mapaFotonesGlobales, mapaFotonesCausticos,
+                                     numFotonesGlobales, numFotonesCausticos, parametros);
+    }
+    return obtenerRadianciaPixelAntialiasing(camara, escena, ancho, tamanoPorPixel, alto, tamanoPorPixel,
+                                             mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales,
+                                             numFotonesCausticos, parametros);
+}
+
+void generarImpactos(const Camara& camara, const Escena& escena, const vector<array<unsigned, 2>>& pixeles,
+                     const float tamanoPorPixel, const Parametros& parametros, vector<ImpactoDifuso>& impactos) {
+    MEDIR_FASE(FASE_IMPACTOS);
+    impactos.clear();
+    impactos.reserve(pixeles.size() * parametros.rpp);
+    auto anadirImpacto = [&](Rayo rayo, const uint32_t pixel) {
+        globalizarYNormalizarRayo(rayo, camara.o, camara.f, camara.u, camara.l);
+        ImpactoDifuso impacto;
+        Primitiva* objeto = nullptr;
+        if (trazarHastaDifuso(rayo, escena, impacto.punto, impacto.normal, objeto, impacto.probabilidad)) {
+            impacto.dirIncidente = rayo.d;
+            impacto.objeto = objeto;
+            impacto.pixel = pixel;
+            impactos.push_back(impacto);
+        }
+    };
+
+    // Mismas muestras que obtenerColorPixel: el rayo central con 1 rpp y, si no, las de un
+    // Muestreador propio de cada pixel
+    for (uint32_t i = 0; i < pixeles.size(); ++i) {
+        const unsigned ancho = pixeles[i][0], alto = pixeles[i][1];
+        if (parametros.rpp == 1) {
+            anadirImpacto(camara.obtenerRayoCentroPixel(ancho, tamanoPorPixel, alto, tamanoPorPixel), i);
+            continue;
+        }
+        Muestreador muestreador(parametros.muestreador, generadorThread()());
+        activarMuestreador(&muestreador);
+        for (unsigned j = 0; j < parametros.rpp; ++j) {
+            muestreador.comenzarMuestra(j);
+            anadirImpacto(camara.obtenerRayoAleatorioPixel(ancho, tamanoPorPixel, alto, tamanoPorPixel), i);
+        }
+        activarMuestreador(nullptr);
+    }
+}
+
+// Función que devuelve en <vecinos> los fotones de <mapa> (con <numFotonesMapa> fotones) cercanos
+// a cada posición de <coords>, con el criterio <tipo>, <num> y <radio> de estimarEcuacionRender.
+// Las búsquedas van en lote salvo con ADAPTATIVO, cuyo radio depende de cada posición.
+static void buscarVecinosEnLote(const PhotonMap& mapa, const size_t numFotonesMapa, const TipoVecinos tipo,
+                                const unsigned long num, const float radio, const vector<array<float, 3>>& coords,
+                                const vector<FiltroFotones>* filtros, vector<vector<const Photon*>>& vecinos) {
+    if (tipo == ADAPTATIVO) {
+        vecinos.resize(coords.size());
+        for (size_t i = 0; i < coords.size(); ++i) {
+            fotonesCercanosAdaptativo(mapa, coords[i], radio, num, vecinos[i], filtros ? &(*filtros)[i] : nullptr);
+        }
+    } else if (tipo == RADIO) {
+        fotonesCercanosEnLote(mapa, coords, radio, std::numeric_limits<unsigned long>::max(), vecinos, filtros);
+    } else if (tipo == PORCENTAJE) {
+        fotonesCercanosEnLote(mapa, coords, std::numeric_limits<float>::max(),
+                              static_cast<unsigned long>(numFotonesMapa * num), vecinos, filtros);
+    } else if (tipo == NUMERO) {
+        fotonesCercanosEnLote(mapa, coords, std::numeric_limits<float>::max(), num, vecinos, filtros);
+    } else { // RADIONUMERO
+        fotonesCercanosEnLote(mapa, coords, radio, num, vecinos, filtros);
+    }
+}
+
+void sombrearImpactos(vector<ImpactoDifuso>& impactos, const Escena& escena, const PhotonMap& mapaFotonesGlobales,
+                      const PhotonMap& mapaFotonesCausticos, const size_t numFotonesGlobales,
+                      const size_t numFotonesCausticos, const Parametros& parametros, vector<RGB>& colores) {
+    MEDIR_FASE(FASE_SOMBREADO);
+    if (impactos.empty()) {
+        return;
+    }
+
+    // Orden Morton de las posiciones, cuantizadas a 10 bits por eje en la caja límite de los impactos
+    array<float, 3> minimo = impactos[0].punto.coord, maximo = minimo;
+    for (const ImpactoDifuso& impacto : impactos) {
+        for (int k = 0; k < 3; ++k) {
+            minimo[k] = std::min(minimo[k], impacto.punto.coord[k]);
+            maximo[k] = std::max(maximo[k], impacto.punto.coord[k]);
+        }
+    }
+    array<float, 3> escala;
+    for (int k = 0; k < 3; ++k) {
+        float ancho = maximo[k] - minimo[k];
+        escala[k] = (ancho > 0.0f) ? 1023.0f / ancho : 0.0f;
+    }
+    vector<std::pair<unsigned, uint32_t>> claves(impactos.size());
+    for (uint32_t i = 0; i < impactos.size(); ++i) {
+        const array<float, 3>& c = impactos[i].punto.coord;
+        claves[i] = {codigoMorton(static_cast<unsigned>((c[0] - minimo[0]) * escala[0]),
+                                  static_cast<unsigned>((c[1] - minimo[1]) * escala[1]),
+                                  static_cast<unsigned>((c[2] - minimo[2]) * escala[2])), i};
+    }
+    std::sort(claves.begin(), claves.end());
+    vector<ImpactoDifuso> ordenados(impactos.size());
+    for (size_t i = 0; i < claves.size(); ++i) ordenados[i] = impactos[claves[i].second];
+    impactos.swap(ordenados);
+
+    // Búsquedas de vecinos de todos los impactos, en lote
+    vector<array<float, 3>> coords(impactos.size());
+    vector<FiltroFotones> filtros;
+    for (size_t i = 0; i < impactos.size(); ++i) coords[i] = impactos[i].punto.coord;
+    if (parametros.filtroNormal) {
+        filtros.reserve(impactos.size());
+        for (const ImpactoDifuso& impacto : impactos) {
+            filtros.push_back(filtroPunto(impacto.punto, impacto.dirIncidente, impacto.normal, parametros));
+        }
+    }
+    const vector<FiltroFotones>* pFiltros = parametros.filtroNormal ? &filtros : nullptr;
+    vector<vector<const Photon*>> vecinosGlobales, vecinosCausticos;
+    const bool conAgregados = usarAgregados(mapaFotonesGlobales, parametros);
+    if (!conAgregados) {
+        buscarVecinosEnLote(mapaFotonesGlobales, numFotonesGlobales, parametros.tipoVecinosGlobales,
+                            parametros.vecinosGlobalesNum, parametros.vecinosGlobalesRadio, coords, pFiltros,
+                            vecinosGlobales);
+    }
+    buscarVecinosEnLote(mapaFotonesCausticos, numFotonesCausticos, parametros.tipoVecinosCausticos,
+                        parametros.vecinosCausticosNum, parametros.vecinosCausticosRadio, coords, pFiltros, vecinosCausticos);
+
+    // NEE y estimación de densidad de cada impacto, como en obtenerRadianciaPixel
+    for (size_t i = 0; i < impactos.size(); ++i) {
+        const ImpactoDifuso& impacto = impactos[i];
+        RGB radianciaDirecta(0.0f, 0.0f, 0.0f);
+        if (parametros.nee) {
+            radianciaDirecta = nextEventEstimation(impacto.punto, impacto.normal, escena, impacto.objeto,
+                                                   parametros.numLucesNEE, parametros.muestrasLuzArea);
+        }
+        RGB radianciaIndirecta = radianciaKernel(vecinosCausticos[i], impacto.punto, parametros.kernel)
+                               + (conAgregados ? radianciaConAgregados(mapaFotonesGlobales, impacto.punto, parametros)
+                                               : radianciaKernel(vecinosGlobales[i], impacto.punto, parametros.kernel));
+        colores[impacto.pixel] += (radianciaDirecta + radianciaIndirecta) / impacto.probabilidad;
+    }
+}
+
+void sombrearPixelesDiferido(const Camara& camara, const Escena& escena, const vector<array<unsigned, 2>>& pixeles,
+                             const float tamanoPorPixel, const PhotonMap& mapaFotonesGlobales,
+                             const PhotonMap& mapaFotonesCausticos, const size_t numFotonesGlobales,
+                             const size_t numFotonesCausticos, const Parametros& parametros, vector<RGB>& colores) {
+    vector<ImpactoDifuso> impactos;
+    generarImpactos(camara, escena, pixeles, tamanoPorPixel, parametros, impactos);
+    colores.assign(pixeles.size(), RGB(0.0f, 0.0f, 0.0f));
+    sombrearImpactos(impactos, escena, mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales,
+                     numFotonesCausticos, parametros, colores);
+    if (parametros.rpp > 1) {
+        for (RGB& color : colores) color = color / parametros.rpp;
+    }
+}
+
+vector<array<unsigned, 2>> ordenPixelesMorton(const unsigned ancho, const unsigned alto, const unsigned lado,
+                                              vector<size_t>& inicioTesela) {
+    // Teselas y píxeles dentro de una tesela, ordenados por su código Morton en 2D (z = 0)
+    auto ordenMorton = [](const unsigned nx, const unsigned ny) {
+        vector<array<unsigned, 2>> celdas;
+        for (unsigned y = 0; y < ny; ++y) {
+            for (unsigned x = 0; x < nx; ++x) celdas.push_back({x, y});
+        }
+        std::sort(celdas.begin(), celdas.end(), [](const array<unsigned, 2>& a, const array<unsigned, 2>& b) {
+            return codigoMorton(a[0], a[1], 0) < codigoMorton(b[0], b[1], 0);
+        });
+        return celdas;
+    };
+    const vector<array<unsigned, 2>> teselas = ordenMorton((ancho + lado - 1) / lado, (alto + lado - 1) / lado);
+    const vector<array<unsigned, 2>> dentro = ordenMorton(lado, lado);
+
+    vector<array<unsigned, 2>> pixeles;
+    pixeles.reserve(static_cast<size_t>(ancho) * alto);
+    inicioTesela.clear();
+    for (const array<unsigned, 2>& tesela : teselas) {
+        inicioTesela.push_back(pixeles.size());
+        for (const array<unsigned, 2>& d : dentro) {
+            const unsigned x = tesela[0] * lado + d[0], y = tesela[1] * lado + d[1];
+            if (x < ancho && y < alto) pixeles.push_back({x, y});
+        }
+    }
+    inicioTesela.push_back(pixeles.size());
+    return pixeles;
+}
+
 void printPixelActual(unsigned totalPixeles, unsigned numPxlsAncho, unsigned ancho, unsigned alto){
     unsigned pixelActual = numPxlsAncho * ancho + alto + 1;
     if (pixelActual % 100 == 0 || pixelActual == totalPixeles) {
@@ -589,48 +867,53 @@ void paso2LeerPhotonMapAntialiasing(const Camara& camara, const Escena& escena,
         for (unsigned alto = 0; alto < parametros.numPxlsAlto; ++alto) {
             if (parametros.printPixelesProcesados) printPixelActual(totalPixeles, parametros.numPxlsAncho, ancho, alto);
 
-            Rayo rayo(Direccion(0.0f, 0.0f, 0.0f), Punto());
-            RGB radianciaTotal;
-            for (unsigned i = 0; i < parametros.rpp; i++){
-                rayo = camara.obtenerRayoAleatorioPixel(ancho, anchoPorPixel, alto, altoPorPixel);
-                globalizarYNormalizarRayo(rayo, camara.o, camara.f, camara.u, camara.l);
-                radianciaTotal += obtenerRadianciaPixel(rayo, escena, mapaFotonesGlobales, mapaFotonesCausticos,
-                                                        numFotonesGlobales, numFotonesCausticos, parametros);
-            }
-
-            colorPixeles[alto][ancho] = radianciaTotal / parametros.rpp;
+            colorPixeles[alto][ancho] = obtenerRadianciaPixelAntialiasing(camara, escena, ancho, anchoPorPixel, alto,
+                                                                          altoPorPixel, mapaFotonesGlobales,
+                                                                          mapaFotonesCausticos, numFotonesGlobales,
+                                                                          numFotonesCausticos, parametros);
         }
     }
 }
                       
 void renderizarEscena(const Camara& camara, const Escena& escena,
                     const string& nombreEscena, const Parametros& parametros) {
-    pixelesProcesados = 0;
-    float tamanoPorPixel = std::min(camara.calcularAnchoPixel(parametros.numPxlsAncho), camara.calcularAltoPixel(parametros.numPxlsAlto));
-    unsigned totalPixeles = parametros.numPxlsAlto * parametros.numPxlsAncho;
+    reiniciarInstrumentacion();
+    {
+        MEDIR_FASE(FASE_RENDER);
+        sembrarThread(parametros, 2, 0);
+        pixelesProcesados = 0;
+        float tamanoPorPixel = std::min(camara.calcularAnchoPixel(parametros.numPxlsAncho), camara.calcularAltoPixel(parametros.numPxlsAlto));
+        unsigned totalPixeles = parametros.numPxlsAlto * parametros.numPxlsAncho;
        
-    PhotonMap mapaFotonesGlobales;    
-    PhotonMap mapaFotonesCausticos;
-    size_t numFotonesGlobales;
-    size_t numFotonesCausticos;
+        PhotonMap mapaFotonesGlobales;    
+        PhotonMap mapaFotonesCausticos;
+        size_t numFotonesGlobales;
+        size_t numFotonesCausticos;
     
-    paso1GenerarPhotonMap(mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales, 
-                            numFotonesCausticos, parametros.numRandomWalks, escena, parametros.nee, parametros.luzIndirecta);
+        paso1GenerarPhotonMap(mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales, 
+                                numFotonesCausticos, escena, parametros);
     
-    // Inicializado todo a color negro
-    vector<vector<RGB>> colorPixeles(parametros.numPxlsAlto, vector<RGB>(parametros.numPxlsAncho, {0.0f, 0.0f, 0.0f}));
-
-    if(parametros.rpp == 1){
-        paso2LeerPhotonMap1RPP(camara, escena, tamanoPorPixel, tamanoPorPixel, colorPixeles,
-                            mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales, 
-                            numFotonesCausticos, totalPixeles, parametros);
-    } else {
-        paso2LeerPhotonMapAntialiasing(camara, escena, tamanoPorPixel, tamanoPorPixel, colorPixeles,
-                            mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales, 
-                            numFotonesCausticos, totalPixeles, parametros);
-    }
+        // Inicializado todo a color negro
+        vector<vector<RGB>> colorPixeles(parametros.numPxlsAlto, vector<RGB>(parametros.numPxlsAncho, {0.0f, 0.0f, 0.0f}));
+
+        {
+            MEDIR_FASE(FASE_PASO2);
+            if(parametros.rpp == 1){
+                paso2LeerPhotonMap1RPP(camara, escena, tamanoPorPixel, tamanoPorPixel, colorPixeles,
+                                    mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales, 
+                                    numFotonesCausticos, totalPixeles, parametros);
+            } else {
+                paso2LeerPhotonMapAntialiasing(camara, escena, tamanoPorPixel, tamanoPorPixel, colorPixeles,
+                                    mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales, 
+                                    numFotonesCausticos, totalPixeles, parametros);
+            }
+        }
     
-    pintarEscenaEnPPM(nombreEscena, colorPixeles);
+        pintarEscenaEnPPM(nombreEscena, colorPixeles);
+    }
+#ifdef INSTRUMENTACION
+    escribirInformeInstrumentacion(nombreEscena + "_instrumentacion.json");
+#endif
 }
 
 
@@ -667,16 +950,10 @@ void renderizarRangoFilasPhotonMapAntialiasing(const Camara& camara, unsigned in
         for (unsigned ancho = 0; ancho < parametros.numPxlsAncho; ++ancho) {
             //if (printPixelesProcesados) printPixelActual(totalPixeles, numPxlsAncho, ancho, alto);
 
-            Rayo rayo(Direccion(0.0f, 0.0f, 0.0f), Punto());
-            RGB radianciaTotal;
-            for (unsigned i = 0; i < parametros.rpp; ++i) {
-                rayo = camara.obtenerRayoAleatorioPixel(ancho, anchoPorPixel, alto, altoPorPixel);
-                globalizarYNormalizarRayo(rayo, camara.o, camara.f, camara.u, camara.l);
-                radianciaTotal += obtenerRadianciaPixel(rayo, escena, mapaFotonesGlobales, mapaFotonesCausticos, 
-                                                                numFotonesGlobales, numFotonesCausticos, parametros);
-            }
-
-            colorPixeles[alto][ancho] = radianciaTotal / parametros.rpp;
+            colorPixeles[alto][ancho] = obtenerRadianciaPixelAntialiasing(camara, escena, ancho, anchoPorPixel, alto,
+                                                                          altoPorPixel, mapaFotonesGlobales,
+                                                                          mapaFotonesCausticos, numFotonesGlobales,
+                                                                          numFotonesCausticos, parametros);
         }
         
         pixelesProcesados += parametros.numPxlsAncho;
@@ -687,57 +964,147 @@ void renderizarRangoFilasPhotonMapAntialiasing(const Camara& camara, unsigned in
 
 
 void renderizarEscenaConThreads(const Camara& camara, const Escena& escena, const string& nombreEscena, 
-                                const Parametros& parametros, unsigned numThreads) {
+                                const Parametros& parametros, unsigned numThreads, const string& rutaFotones) {
     pixelesProcesados = 0;
     auto inicio = std::chrono::high_resolution_clock::now();
-
-    float tamanoPorPixel = std::min(camara.calcularAnchoPixel(parametros.numPxlsAncho), camara.calcularAltoPixel(parametros.numPxlsAlto));
-    unsigned totalPixeles = parametros.numPxlsAncho * parametros.numPxlsAlto;
-
-    PhotonMap mapaFotonesGlobales;
-    PhotonMap mapaFotonesCausticos;
-    size_t numFotonesGlobales;
-    size_t numFotonesCausticos;
-    paso1GenerarPhotonMap(mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales,
-                            numFotonesCausticos, parametros.numRandomWalks, escena, parametros.nee, parametros.luzIndirecta);
-
-    vector<vector<RGB>> colorPixeles(parametros.numPxlsAlto, vector<RGB>(parametros.numPxlsAncho, {0.0f, 0.0f, 0.0f}));
-
-    unsigned filasPorThread = parametros.numPxlsAlto / numThreads;
-    unsigned filasRestantes = parametros.numPxlsAlto % numThreads;
-
-    vector<thread> threads;
-    unsigned inicioFila = 0;
-
-    if(parametros.printPixelesProcesados) cout << "Progreso: 0 / " << totalPixeles << " pixeles procesados." << endl;
-    for (unsigned t = 0; t < numThreads; ++t) {
-        unsigned finFila = inicioFila + filasPorThread + (t < filasRestantes ? 1 : 0);
-
-        if (parametros.rpp == 1) {
-            threads.emplace_back([&](unsigned inicio, unsigned fin) {
-                renderizarRangoFilasPhotonMap1RPP(camara, inicio, fin, escena, tamanoPorPixel, 
-                                                    tamanoPorPixel, colorPixeles, mapaFotonesGlobales, mapaFotonesCausticos, 
-                                                    numFotonesGlobales, numFotonesCausticos, totalPixeles, parametros);
-            }, inicioFila, finFila);
+    reiniciarInstrumentacion();
+    {
+        MEDIR_FASE(FASE_RENDER);
+        float tamanoPorPixel = std::min(camara.calcularAnchoPixel(parametros.numPxlsAncho), camara.calcularAltoPixel(parametros.numPxlsAlto));
+        unsigned totalPixeles = parametros.numPxlsAncho * parametros.numPxlsAlto;
+
+        PhotonMap mapaFotonesGlobales;
+        PhotonMap mapaFotonesCausticos;
+        size_t numFotonesGlobales;
+        size_t numFotonesCausticos;
+        if (rutaFotones.empty()) {
+            paso1GenerarPhotonMap(mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales,
+                                    numFotonesCausticos, escena, parametros);
         } else {
-            threads.emplace_back([&](unsigned inicio, unsigned fin) {
-                renderizarRangoFilasPhotonMapAntialiasing(camara, inicio, fin, escena, tamanoPorPixel, 
-                                                            tamanoPorPixel, colorPixeles, mapaFotonesGlobales, mapaFotonesCausticos, 
-                                                    numFotonesGlobales, numFotonesCausticos, totalPixeles, parametros);
-            }, inicioFila, finFila);
+            paso1CargarPhotonMap(mapaFotonesGlobales, mapaFotonesCausticos, numFotonesGlobales,
+                                 numFotonesCausticos, rutaFotones, parametros);
         }
 
-        inicioFila = finFila;
-    }
+        vector<vector<RGB>> colorPixeles(parametros.numPxlsAlto, vector<RGB>(parametros.numPxlsAncho, {0.0f, 0.0f, 0.0f}));
+
+        unsigned filasPorThread = parametros.numPxlsAlto / numThreads;
+        unsigned filasRestantes = parametros.numPxlsAlto % numThreads;
+
+        {
+            MEDIR_FASE(FASE_PASO2);
+            vector<thread> threads;
+            unsigned inicioFila = 0;
+
+            if(parametros.printPixelesProcesados) cout << "Progreso: 0 / " << totalPixeles << " pixeles procesados." << endl;
+            // Con ordenMorton o sombreadoDiferido, los threads se reparten las teselas según van
+            // acabando; cada tesela tiene su semilla, así que el resultado no depende de qué thread
+            // la calcule
+            vector<size_t> inicioTesela;
+            vector<array<unsigned, 2>> pixeles;
+            std::atomic<unsigned> siguienteTesela{0};
+            if (parametros.ordenMorton || parametros.sombreadoDiferido) {
+                pixeles = ordenPixelesMorton(parametros.numPxlsAncho, parametros.numPxlsAlto, TAM_TESELA_MORTON,
+                                             inicioTesela);
+                for (unsigned t = 0; t < numThreads; ++t) {
+                    threads.emplace_back([&]() {
+                        vector<array<unsigned, 2>> pixelesTesela;
+                        vector<RGB> colores;
+                        for (unsigned i = siguienteTesela++; i + 1 < inicioTesela.size(); i = siguienteTesela++) {
+                            sembrarThread(parametros, 2, i);
+                            if (parametros.sombreadoDiferido) {
+                                pixelesTesela.assign(pixeles.begin() + inicioTesela[i], pixeles.begin() + inicioTesela[i + 1]);
+                                sombrearPixelesDiferido(camara, escena, pixelesTesela, tamanoPorPixel, mapaFotonesGlobales,
+                                                        mapaFotonesCausticos, numFotonesGlobales, numFotonesCausticos,
+                                                        parametros, colores);
+                                for (size_t j = 0; j < pixelesTesela.size(); ++j) {
+                                    colorPixeles[pixelesTesela[j][1]][pixelesTesela[j][0]] = colores[j];
+                                }
+                            } else {
+                                for (size_t j = inicioTesela[i]; j < inicioTesela[i + 1]; ++j) {
+                                    const unsigned ancho = pixeles[j][0], alto = pixeles[j][1];
+                                    colorPixeles[alto][ancho] = obtenerColorPixel(camara, escena, ancho, alto, tamanoPorPixel,
+                                                                    mapaFotonesGlobales, mapaFotonesCausticos,
+                                                                    numFotonesGlobales, numFotonesCausticos, parametros);
+                                }
+                            }
+                            pixelesProcesados += inicioTesela[i + 1] - inicioTesela[i];
+                            if(parametros.printPixelesProcesados) cout << "Progreso: " << pixelesProcesados
+                                                << " / " << totalPixeles << " pixeles procesados." << endl;
+                        }
+                    });
+                }
+            } else {
+                for (unsigned t = 0; t < numThreads; ++t) {
+                    unsigned finFila = inicioFila + filasPorThread + (t < filasRestantes ? 1 : 0);
+
+                    if (parametros.rpp == 1) {
+                        threads.emplace_back([&](unsigned inicio, unsigned fin) {
+                            sembrarThread(parametros, 2, inicio);
+                            renderizarRangoFilasPhotonMap1RPP(camara, inicio, fin, escena, tamanoPorPixel, 
+                                                                tamanoPorPixel, colorPixeles, mapaFotonesGlobales, mapaFotonesCausticos, 
+                                                                numFotonesGlobales, numFotonesCausticos, totalPixeles, parametros);
+                        }, inicioFila, finFila);
+                    } else {
+                        threads.emplace_back([&](unsigned inicio, unsigned fin) {
+                            sembrarThread(parametros, 2, inicio);
+                            renderizarRangoFilasPhotonMapAntialiasing(camara, inicio, fin, escena, tamanoPorPixel, 
+                                                                        tamanoPorPixel, colorPixeles, mapaFotonesGlobales, mapaFotonesCausticos, 
+                                                                numFotonesGlobales, numFotonesCausticos, totalPixeles, parametros);
+                        }, inicioFila, finFila);
+                    }
+
+                    inicioFila = finFila;
+                }
+            }
 
-    for (auto& thread : threads) {
-        thread.join();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+
+        string nombreArchivo = "./" + nombreEscena + ".ppm";
+        pintarEscenaEnPPM(nombreArchivo, colorPixeles);
+        transformarFicheroPPM(nombreArchivo, 5);
     }
 
-    string nombreArchivo = "./" + nombreEscena + ".ppm";
-    pintarEscenaEnPPM(nombreArchivo, colorPixeles);
-    transformarFicheroPPM(nombreArchivo, 5);
-          
     auto fin = std::chrono::high_resolution_clock::now();
     printTiempo(inicio, fin);
+#ifdef INSTRUMENTACION
+    escribirInformeInstrumentacion("./" + nombreEscena + "_instrumentacion.json");
+    cout << informeInstrumentacionJSON();
+#endif
+}
+
+void renderizarTesela(const Camara& camara, const Escena& escena, const unsigned x0, const unsigned y0,
+                      const unsigned x1, const unsigned y1, const PhotonMap& mapaFotonesGlobales,
+                      const PhotonMap& mapaFotonesCausticos, const size_t numFotonesGlobales,
+                      const size_t numFotonesCausticos, const Parametros& parametros, vector<RGB>& colores) {
+    float tamanoPorPixel = std::min(camara.calcularAnchoPixel(parametros.numPxlsAncho), camara.calcularAltoPixel(parametros.numPxlsAlto));
+    colores.assign(static_cast<size_t>(x1 - x0) * (y1 - y0), RGB());
+    vector<array<unsigned, 2>> pixeles;
+    if (parametros.ordenMorton) {
+        vector<size_t> inicioTesela;
+        pixeles = ordenPixelesMorton(x1 - x0, y1 - y0, TAM_TESELA_MORTON, inicioTesela);
+    } else {
+        for (unsigned y = 0; y < y1 - y0; ++y) {
+            for (unsigned x = 0; x < x1 - x0; ++x) pixeles.push_back({x, y});
+        }
+    }
+    if (parametros.sombreadoDiferido) {
+        vector<array<unsigned, 2>> pixelesImagen;
+        for (const array<unsigned, 2>& pixel : pixeles) pixelesImagen.push_back({x0 + pixel[0], y0 + pixel[1]});
+        vector<RGB> coloresPixeles;
+        sombrearPixelesDiferido(camara, escena, pixelesImagen, tamanoPorPixel, mapaFotonesGlobales,
+                                mapaFotonesCausticos, numFotonesGlobales, numFotonesCausticos, parametros,
+                                coloresPixeles);
+        for (size_t i = 0; i < pixeles.size(); ++i) {
+            colores[static_cast<size_t>(pixeles[i][1]) * (x1 - x0) + pixeles[i][0]] = coloresPixeles[i];
+        }
+        return;
+    }
+    for (const array<unsigned, 2>& pixel : pixeles) {
+        colores[static_cast<size_t>(pixel[1]) * (x1 - x0) + pixel[0]] =
+            obtenerColorPixel(camara, escena, x0 + pixel[0], y0 + pixel[1], tamanoPorPixel, mapaFotonesGlobales,
+                              mapaFotonesCausticos, numFotonesGlobales, numFotonesCausticos, parametros);
+    }
 }
@@ -15,6 +15,7 @@
 #include <random>
 #include <optional>
 #include "parametros.h"
+#include "muestreador.h"
 
 enum TipoRayo {
     ABSORBENTE = -1,
@@ -23,27 +24,16 @@ enum TipoRayo {
     REFRACTANTE = 2
 };
 
-// Método que devuelve las coordenadas cartesianas correspondientes de (azimut, inclinacion)
-void getCoordenadasCartesianas(const float azimut, const float inclinacion,
-                                float& x, float& y, float& z);
-
-// Método que devuelve un valor aleatorio para azimut y otro para inclinación
-// para muestreo uniforme de ángulo sólido sobre la hemiesfera norte
-void generarAzimutInclinacionHemiesfera(float& azimut, float& inclinacion);
-
 // Función que devuelve una dirección generada aleatoriamente empleando muestreo por importancia
 // basado en el coseno. La dirección es aleatoria pero está contenida en el hipotético hemisferio
 // superior que tiene como centro al punto por el que sale la normal <normal> y como altura a la
 // dirección <normal> (|normal| == radio hemisferio). Devuelve en <prob> la probabilidad de que
-// salga el rayo generado.
+// salga el rayo generado. Usa muestrearHemisferioCoseno y baseOrtonormal (ver muestreo.h).
 // Disclaimer: solo debería usarse para rayos difusos.
 Direccion generarDireccionAleatoriaHemiesfera(const Direccion& normal, float& prob);
 
-// Método que devuelve un valor aleatorio para azimut y otro para inclinación
-// para muestreo uniforme de ángulo sólido sobre la esfera
-void generarAzimutInclinacionEsfera(float& azimut, float& inclinacion);
-
 // Función que devuelve una dirección generada aleatoriamente contenida en la hipotética esfera (1,1,1)
+// (ver muestrearEsferaUniforme en muestreo.h).
 // Disclaimer: usada en luces puntuales.
 Direccion generarDireccionAleatoriaEsfera();
 
@@ -83,71 +73,113 @@ float calcCosenoAnguloIncidencia(const Direccion& d, const Direccion& n);
 // Función que calcula la reflectancia difusa de Lambert.
 RGB calcBrdfDifusa(const RGB& kd);
 
-// Método que, si caben más fotones en <vecFotones>, dado un punto <origen>, 
-// una direccion de incidencia <wo_d>, un flujo, unos coeficientes del punto
-// origen y una normal, guarda el fotón correspondiente en <vecFotones> si la
-// superficie es difusa. Luego vuelve a llamarse recursivamente con los parámetros
-// de la siguiente intersección, según el rayo devuelto tras la ruleta rusa.
-void recursividadRandomWalk(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos, bool& fotonCaustico, 
-                            const Escena& escena, const RGB& radianciaInicial, RGB& radianciaActual, const Punto& origen,
-                            const Direccion &wo_d, const BSDFs &coefsOrigen, const Direccion& normal, bool& primerFoton, const bool luzIndirecta);
-
-// Método que, dada una luz, lanza un foton desde esa luz guarda los fotones que rebotan 
-// en las superficies difusas en <vecFotones> (hasta que el randomWalk termine por absorción, 
-// por no-intersección o por llegar al límite de vecFotones)
-void comenzarRandomWalk(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
-                        const Escena& escena, const Rayo& wi, const RGB& flujoInicial, RGB& flujoRestante, const bool nee, const bool luzIndirecta);
-
-// Optamos por almacenar todos los rebotes difusos (incluido el primero)
-// y saltarnos el NextEventEstimation posteriormente
-int lanzarFotonesDeUnaLuz(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos, const int numFotonesALanzar,
-                         const RGB& flujoPorFoton, const LuzPuntual& luz, const Escena& escena, const bool nee, const bool luzIndirecta);
+// Estructura que guarda el estado de un camino de fotón mientras se traza: el vértice
+// en el que se encuentra, la dirección con la que ha llegado a él y el flujo que transporta.
+struct EstadoCamino {
+    Punto origen;               // Vértice actual del camino
+    Direccion wo;               // Dirección con la que el fotón llega a <origen>
+    Direccion normal;           // Normal de la superficie en <origen>
+    const BSDFs* coefs;         // Coeficientes de la superficie en <origen>
+    RGB flujo;                  // Flujo que transporta el fotón
+    RGB flujoInicial;           // Flujo con el que el fotón salió de la luz (para la ruleta rusa)
+    unsigned profundidad;       // Número de rebotes realizados
+    bool caustico;              // "True" si ha habido algún rebote especular o refractante
+    bool primerFoton;           // "True" si el siguiente rebote difuso no debe almacenarse (NEE)
+    Muestreador muestreador;    // Muestra del camino (el trazado wavefront intercala caminos)
+};
 
-// Función que devuelve la suma de los componentes maximos de las potencias de las <luces>
-float calcularPotenciaTotal(const vector<LuzPuntual>& luces);
+// Función que procesa la interacción del camino <estado> en su vértice actual: decide con la
+// ruleta rusa el tipo de rebote, guarda el fotón en <vecFotonesGlobales> o <vecFotonesCausticos>
+// si la superficie es difusa y actualiza el flujo del camino. Devuelve "True" si y solo si el
+// camino continúa, en cuyo caso devuelve en <siguiente> el rayo que hay que trazar.
+bool interaccionCaminoFoton(EstadoCamino& estado, vector<Photon>& vecFotonesGlobales,
+                            vector<Photon>& vecFotonesCausticos, const Parametros& parametros,
+                            Rayo& siguiente);
+
+// Método que, dado un rayo <wi> que sale de una luz con flujo <flujoInicial>, traza
+// iterativamente el camino del fotón por la escena y guarda los fotones que rebotan en las
+// superficies difusas (hasta que termine por absorción, por no-intersección o por llegar a
+// la profundidad máxima de <parametros>). Devuelve el número de rayos trazados.
+unsigned comenzarRandomWalk(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                        const Escena& escena, const Rayo& wi, const RGB& flujoInicial,
+                        const Parametros& parametros);
+
+// Función que elige una luz de <escena> con Escena::tablaEmisores (probabilidad proporcional a
+// su potencia) y devuelve el rayo inicial de un fotón emitido por ella: en una dirección
+// uniforme de la esfera si es puntual, o desde un punto uniforme de su superficie en una
+// dirección muestreada por coseno alrededor de su normal si es de área. Devuelve en <flujo>
+// el flujo del fotón para que el total de <numFotonesTotales> fotones, eligiendo cada uno su
+// luz, sea un estimador sin sesgo de la potencia emitida por todas las luces.
+Rayo emitirFoton(const Escena& escena, const int numFotonesTotales, RGB& flujo);
+
+// Función que, si <parametros.semilla> no es 0, siembra el generador del thread que la llama
+// con esa semilla mezclada con el número de <paso> (1 o 2) y con <idThread>, de modo que el
+// render sea reproducible y cada thread de cada paso tenga su propia secuencia
+void sembrarThread(const Parametros& parametros, const unsigned paso, const unsigned idThread);
 
-// Función que genera el mapa de fotones globales y cáusticos.
+// Optamos por almacenar todos los rebotes difusos (incluido el primero)
+// y saltarnos el NextEventEstimation posteriormente. Lanza <numFotonesALanzar> de los
+// <numFotonesTotales> fotones de la escena (ver emitirFoton), de modo que el trazado se puede
+// repartir en trozos independientes. Devuelve el número de caminos lanzados y acumula en
+// <rayosTrazados> el número de rayos intersecados con la escena.
+int lanzarFotones(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos, const int numFotonesALanzar,
+                  const int numFotonesTotales, const Escena& escena, const Parametros& parametros,
+                  unsigned long& rayosTrazados);
+
+// Función que traza los <parametros.numRandomWalks> caminos de fotones de <escena> y guarda
+// en <vecFotonesGlobales> y <vecFotonesCausticos> los fotones que dejan. El trazado se reparte
+// en un trozo por thread disponible. Devuelve el número de caminos lanzados.
+int trazarFotones(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                  const Escena& escena, const Parametros& parametros);
+
+// Versión de trazarFotones que traza <totalFotonesALanzar> caminos, con el flujo repartido entre
+// ellos, en a lo sumo <maxTrozos> trozos (uno por thread). El trozo t se siembra como el thread
+// <primerTrozo> + t del paso 1 (ver sembrarThread).
+int trazarFotones(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                  const Escena& escena, const Parametros& parametros, const int totalFotonesALanzar,
+                  const unsigned maxTrozos, const unsigned primerTrozo);
+
+// Función que traza el fragmento <fragmento> (de 0 a <numFragmentos> - 1) de los
+// <parametros.numRandomWalks> caminos de fotones de <escena>, en <numThreads> threads, para
+// repartir el trazado entre procesos o máquinas. Cada fragmento lanza su parte de los caminos
+// con sus propias semillas y reparte el flujo solo entre ellos; fusionarFotones los junta después.
+// El resultado depende solo de la semilla (SEMILLA_FRAGMENTOS si <parametros.semilla> es 0), del
+// fragmento, de <numFragmentos> y de <numThreads>, no de la máquina. Devuelve el número de caminos
+// lanzados. Lanza invalid_argument si el fragmento, <numFragmentos> (como mucho MAX_FRAGMENTOS) o
+// el número de threads no son válidos.
+int trazarFragmentoFotones(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                           const Escena& escena, const Parametros& parametros, const unsigned fragmento,
+                           const unsigned numFragmentos, const unsigned numThreads);
+
+// Función que genera el mapa de fotones globales y cáusticos (ver trazarFotones), en memoria o
+// paginado en disco según <parametros.paginasCacheFotones>
 void paso1GenerarPhotonMap(PhotonMap& mapaFotonesGlobales, PhotonMap& mapaFotonesCausticos, 
                             size_t& numFotonesGlobales, size_t& numFotonesCausticos,
-                            const int totalFotonesALanzar, const Escena& escena, const bool nee, const bool luzIndirecta);
+                            const Escena& escena, const Parametros& parametros);
 
+// Función que genera el mapa de fotones globales y cáusticos con los fotones del fichero
+// <rutaFotones> (ver guardarFotones y fusionarFotones) en lugar de trazarlos
+void paso1CargarPhotonMap(PhotonMap& mapaFotonesGlobales, PhotonMap& mapaFotonesCausticos,
+                          size_t& numFotonesGlobales, size_t& numFotonesCausticos, const string& rutaFotones,
+                          const Parametros& parametros);
 
 // Método que imprime por pantalla un vector de fotones
 void printVectorFotones(const vector<Photon>& vecFotones);
 
-// Función que devuelve la distancia entre la ubicación del fotón y el punto <centro>
-float distanciaEntreFotonYPunto(const Photon* photon, const Punto& centro);
-
-// Función que calcula el valor del kernel Constante, lo multiplica por el flujo del fotón y lo devuelve.
-RGB radianciaKernelConstante(const Photon* photon, const float radio);
-
-// Función que calcula el valor del kernel Cónico, lo multiplica por el flujo del fotón y lo devuelve.
-RGB radianciaKernelConico(const Photon* photon, const float radioMaximo, const Punto& centro);
-
-// Función que calcula el valor del kernel Epanechnikov, lo multiplica por el flujo del fotón y lo devuelve.
-RGB radianciaKernelEpanechnikov(const Photon* photon, const float radioMaximo, const Punto& centro);
-
-// Función que calcula el valor del kernel Bipeso, lo multiplica por el flujo del fotón y lo devuelve.
-RGB radianciaKernelBipeso(const Photon* photon, const float radioMaximo, const Punto& centro);
-
-// Función que calcula el valor del kernel Gaussiano, lo multiplica por el flujo del fotón y lo devuelve.
-RGB radianciaKernelGaussiano(const Photon* photon, const float radioMaximo, const Punto& centro);
-
-// Función que calcula el valor del kernel Logístico, lo multiplica por el flujo del fotón y lo devuelve.
-RGB radianciaKernelLogistico(const Photon* photon, const float radioMaximo, const Punto& centro);
-                                
-// Función que devuelve el máximo radio del vector de fotones.
-float maximoRadio(const Punto& ptoIntersec, const vector<const Photon*> fotonesCercanos);
-
 // Función que computa la estimación de la ecuación de render.
 RGB estimarEcuacionRender(const Escena& escena, const PhotonMap& mapaFotonesGlobales, const PhotonMap& mapaFotonesCausticos,
                             const size_t numFotonesGlobales, const size_t numFotonesCausticos,
                             const Punto& ptoIntersec, const Direccion& dirIncidente,
                             const Direccion& normal, const BSDFs& coefsPtoInterseccion, const Parametros& parametros);
 
-// Función que calcula el NEE.
+// Función que calcula el NEE. Si <numLucesNEE> es 0 o no es menor que el número de luces
+// puntuales, suma la contribución de todas ellas; si no, muestrea <numLucesNEE> luces con
+// Escena::tablaLuces y pondera cada una por la inversa de su probabilidad (sin sesgo).
+// Además, suma la contribución de cada luz de área estimada con <muestrasLuzArea> rayos de
+// sombra estratificados.
 RGB nextEventEstimation(const Punto& p0, const Direccion& normal, const Escena& escena,
-                        const Primitiva* objOrigen);
+                        const Primitiva* objOrigen, const unsigned numLucesNEE = 0,
+                        const unsigned muestrasLuzArea = MUESTRAS_LUZ_AREA);
 
 // Función que, dado un rayo (que proviene de la cámara y atraviesa un pixel), una escena y
 // un mapa de fotones (producido por las luces de la escena), devuelve la radiancia del punto
@@ -159,6 +191,66 @@ RGB obtenerRadianciaPixel(const Rayo& rayoIncidente, const Escena& escena,
                             const size_t numFotonesGlobales, const size_t numFotonesCausticos,
                             const Parametros& parametros);
 
+// Función que devuelve la radiancia media de <parametros.rpp> rayos que atraviesan puntos
+// del pixel (<ancho>, <alto>) de <camara>. Cada rayo es una muestra de un Muestreador del
+// tipo <parametros.muestreador> propio del pixel, de modo que las rpp muestras quedan
+// estratificadas tanto en el pixel como en las decisiones aleatorias posteriores.
+RGB obtenerRadianciaPixelAntialiasing(const Camara& camara, const Escena& escena, const unsigned ancho,
+                                      const float anchoPorPixel, const unsigned alto, const float altoPorPixel,
+                                      const PhotonMap& mapaFotonesGlobales, const PhotonMap& mapaFotonesCausticos,
+                                      const size_t numFotonesGlobales, const size_t numFotonesCausticos,
+                                      const Parametros& parametros);
+
+// Función que devuelve el color del pixel (<ancho>, <alto>) de <camara>: la radiancia de su rayo
+// central si <parametros.rpp> es 1 y la de obtenerRadianciaPixelAntialiasing si no
+RGB obtenerColorPixel(const Camara& camara, const Escena& escena, const unsigned ancho, const unsigned alto,
+                      const float tamanoPorPixel, const PhotonMap& mapaFotonesGlobales,
+                      const PhotonMap& mapaFotonesCausticos, const size_t numFotonesGlobales,
+                      const size_t numFotonesCausticos, const Parametros& parametros);
+
+// Registro del G-buffer del sombreado diferido: una muestra de cámara del pixel <pixel> (posición
+// en la lista de píxeles que se sombrean) que, tras los rebotes especulares y refractantes, llega
+// por <dirIncidente> al punto <punto> de la superficie difusa de <objeto> (del que se leen kd y
+// demás coeficientes), con normal <normal>. <probabilidad> es la de la ruleta rusa en ese choque.
+struct ImpactoDifuso {
+    Punto punto;
+    Direccion normal;
+    Direccion dirIncidente;
+    const Primitiva* objeto;
+    float probabilidad;
+    uint32_t pixel;
+};
+
+// Función que guarda en <impactos> los impactos difusos de las muestras de cámara de <pixeles>
+// (primera etapa del sombreado diferido), con las mismas muestras y rebotes que obtenerColorPixel.
+// Las muestras que salen de la escena no dejan impacto.
+void generarImpactos(const Camara& camara, const Escena& escena, const vector<array<unsigned, 2>>& pixeles,
+                     const float tamanoPorPixel, const Parametros& parametros, vector<ImpactoDifuso>& impactos);
+
+// Función que suma a <colores> (uno por pixel de la lista de la que salen los impactos) la
+// radiancia de cada impacto de <impactos> (segunda etapa del sombreado diferido). Ordena antes
+// los impactos por el código Morton de su posición, de modo que las búsquedas de vecinos, que
+// se hacen todas en lote (ver fotonesCercanosEnLote), recorren el KD-tree de forma coherente.
+// Con <parametros.rpp> > 1 los colores quedan sin dividir por el número de muestras.
+void sombrearImpactos(vector<ImpactoDifuso>& impactos, const Escena& escena, const PhotonMap& mapaFotonesGlobales,
+                      const PhotonMap& mapaFotonesCausticos, const size_t numFotonesGlobales,
+                      const size_t numFotonesCausticos, const Parametros& parametros, vector<RGB>& colores);
+
+// Función que guarda en <colores> el color de cada pixel de <pixeles> con sombreado diferido:
+// generarImpactos y sombrearImpactos, y la media de las muestras de cada pixel
+void sombrearPixelesDiferido(const Camara& camara, const Escena& escena, const vector<array<unsigned, 2>>& pixeles,
+                             const float tamanoPorPixel, const PhotonMap& mapaFotonesGlobales,
+                             const PhotonMap& mapaFotonesCausticos, const size_t numFotonesGlobales,
+                             const size_t numFotonesCausticos, const Parametros& parametros, vector<RGB>& colores);
+
+// Función que devuelve los píxeles (x, y) de una imagen de <ancho> x <alto> agrupados en teselas
+// de <lado> x <lado>, con las teselas y los píxeles de cada una en orden Morton, de modo que
+// píxeles consecutivos ven puntos cercanos de la escena y sus búsquedas de vecinos recorren las
+// mismas ramas del KD-tree. Guarda en <inicioTesela> la posición del primer píxel de cada tesela,
+// más el total al final.
+vector<array<unsigned, 2>> ordenPixelesMorton(const unsigned ancho, const unsigned alto, const unsigned lado,
+                                              vector<size_t>& inicioTesela);
+
 // Método que muestra por pantalla el número de píxeles procesados (cada 100 píxeles)
 void printPixelActual(unsigned totalPixeles, unsigned numPxlsAncho, unsigned ancho, unsigned alto);
 
@@ -197,5 +289,20 @@ void renderizarRangoFilasPhotonMapAntialiasing(const Camara& camara, unsigned in
                                        const size_t numFotonesGlobales, const size_t numFotonesCausticos, 
                                        const int totalPixeles, const Parametros& parametros);
 
+// Método que genera una imagen con <numThreads> threads, cada uno con un rango de filas o, con
+// <parametros.ordenMorton> o <parametros.sombreadoDiferido>, repartiéndose las teselas de
+// ordenPixelesMorton (con sombreado diferido, cada tesela con sombrearPixelesDiferido). Si se da
+// <rutaFotones>, el mapa de fotones se lee de ese fichero en lugar de trazarse
 void renderizarEscenaConThreads(const Camara& camara, const Escena& escena, const string& nombreEscena, 
-                                const Parametros& parametros, unsigned numThreads = thread::hardware_concurrency());
+                                const Parametros& parametros, unsigned numThreads = thread::hardware_concurrency(),
+                                const string& rutaFotones = "");
+
+// Función que calcula el color de los píxeles [x0, x1) x [y0, y1) de la imagen de
+// <parametros.numPxlsAncho> x <parametros.numPxlsAlto> vista desde <camara>, y los guarda
+// por filas en <colores> (ver distribuido.h). Con <parametros.ordenMorton> los píxeles se calculan
+// en el orden de ordenPixelesMorton, y con <parametros.sombreadoDiferido> todos a la vez con
+// sombrearPixelesDiferido.
+void renderizarTesela(const Camara& camara, const Escena& escena, const unsigned x0, const unsigned y0,
+                      const unsigned x1, const unsigned y1, const PhotonMap& mapaFotonesGlobales,
+                      const PhotonMap& mapaFotonesCausticos, const size_t numFotonesGlobales,
+                      const size_t numFotonesCausticos, const Parametros& parametros, vector<RGB>& colores);
@@ -7,7 +7,6 @@
 
 #include "plano.h"
 #include "base.h"
-#include <random>
 
 
 Plano::Plano(): Primitiva(), n(0.0f, 0.0f, 0.0f), u(0.0f, 0.0f, 0.0f), v(0.0f, 0.0f, 0.0f),
@@ -92,23 +91,19 @@ bool Plano::puntoEsFuenteDeLuz(const Punto& punto) const {
     return dentroLimites;
 }
 
-Punto Plano::generarPuntoAleatorio(float& prob) const {
+Punto Plano::muestrearPuntoArea(const float u1, const float u2, float& prob) const {
     float limite = abs(this->maxLimite - this->minLimite);
     float areaPlano = limite * limite;
     prob = 1.0f / areaPlano;
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dist(this->minLimite, this->maxLimite);
-
-    // Generamos coordenadas aleatorias en el plano usando u y v
-    float randomU = dist(gen);
-    float randomV = dist(gen);
+    // Coordenadas en el plano usando u y v
+    float coordU = this->minLimite + limite * u1;
+    float coordV = this->minLimite + limite * u2;
 
     // En UCS
-    Punto puntoAleatorio = this->centro + this->u * randomU + this->v * randomV;
+    Punto punto = this->centro + this->u * coordU + this->v * coordV;
     
-    return puntoAleatorio;
+    return punto;
 }
 
 
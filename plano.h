@@ -75,9 +75,9 @@ public:
     // y además, es un punto lumínico del plano.
     bool puntoEsFuenteDeLuz(const Punto& punto) const override;
     
-    // Método que devuelve un punto aleatorio de la superficie del plano en UCS.
-    // También devuelve en <prob> la probabilidad de muestrear dicho punto.
-    Punto generarPuntoAleatorio(float& prob) const override;
+    // Método que devuelve el punto de la zona lumínica del plano (entre los límites) que
+    // corresponde a la muestra (<u1>, <u2>), y en <prob> la densidad respecto del área.
+    Punto muestrearPuntoArea(const float u1, const float u2, float& prob) const override;
     
     // Método que obtiene la posición del punto <pto> del plano en el eje U de la
     // textura correspondiente. Tenemos garantizado que <pto> pertenece al objeto.
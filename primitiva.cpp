@@ -7,6 +7,7 @@
 
 #include "primitiva.h"
 #include "bsdfs.h"
+#include "muestreador.h"
 #include <stdexcept>
 #include <array>
 
@@ -24,6 +25,23 @@ bool Primitiva::soyFuenteDeLuz() const {
     return !valeCero(this->power);
 }
 
+Punto Primitiva::generarPuntoAleatorio(float& prob) const {
+    const float u1 = muestra();
+    const float u2 = muestra();
+    return muestrearPuntoArea(u1, u2, prob);
+}
+
+Punto Primitiva::muestrearLuz(const Punto& ref, const float u1, const float u2, float& prob) const {
+    float probArea;
+    Punto p = muestrearPuntoArea(u1, u2, probArea);
+    Direccion d = p - ref;
+    float dist2 = dot(d, d);
+    float cosLuz = (dist2 > 0.0f) ? -dot(normalizar(getNormal(p)), d) / sqrt(dist2) : 0.0f;
+    // p(w) = p(A) * d^2 / cos(theta_luz)
+    prob = (probArea > 0.0f && cosLuz > MARGEN_ERROR) ? probArea * dist2 / cosLuz : 0.0f;
+    return p;
+}
+
 bool Primitiva::tengoTextura() const {
     return !((this->textura.alto == 0) || (this->textura.ancho == 0));
 }
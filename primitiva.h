@@ -71,9 +71,21 @@ public:
     // y además, es un punto lumínico de la primitiva.
     virtual bool puntoEsFuenteDeLuz(const Punto& punto) const = 0;
     
-    // Método virtual que devuelve un punto aleatorio de la primitiva.
+    // Método que devuelve un punto aleatorio de la primitiva (uniforme por área).
     // También devuelve en <prob> la probabilidad de muestrear dicho punto.
-    virtual Punto generarPuntoAleatorio(float& prob) const = 0;
+    Punto generarPuntoAleatorio(float& prob) const;
+
+    // Método virtual que devuelve el punto de la superficie de la primitiva que corresponde a
+    // la muestra (<u1>, <u2>) de [0,1)^2, distribuido uniformemente por área, y en <prob> su
+    // densidad de probabilidad respecto del área (0 si la primitiva no se puede muestrear).
+    virtual Punto muestrearPuntoArea(const float u1, const float u2, float& prob) const = 0;
+
+    // Método virtual que muestrea, a partir de (<u1>, <u2>), un punto de la primitiva como luz
+    // de área vista desde <ref>. Devuelve en <prob> la densidad de probabilidad respecto del
+    // ángulo sólido en <ref> (0 si el punto no sirve: se ve de canto o por detrás, ya que
+    // la luz solo emite hacia donde apunta su normal). Por defecto muestrea por área y
+    // cambia de medida.
+    virtual Punto muestrearLuz(const Punto& ref, const float u1, const float u2, float& prob) const;
     
     // Método virtual que obtiene la posición del punto <pto> de la primitiva en el
     // eje U de la textura correspondiente. Tenemos garantizado que <pto> pertenece al objeto.
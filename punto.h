@@ -9,53 +9,83 @@
 #include <array>
 #include "puntoDireccion.h"
 #include "direccion.h"
-#include "matriz.h"
 #include "utilidades.h"
 
 // Clase que representa un punto en el espacio, respecto a un punto
 // de origen. Hereda de PuntoDireccion
 class Punto : public PuntoDireccion {
 public:
-    // Coordenadas del punto de origen
-    array<float, 3> o;
-
     // Constructor base
-    Punto();
-
-    // Constructor dado otro punto
-    Punto(const Punto& p);
+    constexpr Punto();
 
     // Constructor dadas 3 coordenadas del punto
-    Punto(float x, float y, float z);
+    constexpr Punto(float x, float y, float z);
 
     // Constructor dadas 3 coordenadas del punto en un array
-    Punto(array<float, 3> _coord);
-    
-    // Función que devuelve una Matriz 4x1 con las coordenadas
-    // homogeneas del punto
-    Matriz<4,1> getCoordHomo() const override;
+    constexpr Punto(array<float, 3> _coord);
+
+    // Constructor dado un Vec3
+    constexpr explicit Punto(const Vec3& v);
     
     // Operación de suma de un punto con una dirección
-    Punto operator+(const PuntoDireccion& pd) const;
+    constexpr Punto operator+(const PuntoDireccion& pd) const;
     
     // Operación de resta de un punto con una dirección
-    Punto operator-(const Direccion& d) const;
+    constexpr Punto operator-(const Direccion& d) const;
     
     // Operación de resta de un punto con otro punto
-    Direccion operator-(const Punto& p) const;
+    constexpr Direccion operator-(const Punto& p) const;
 
     // Operación de multiplicación entre un escalar y el punto
-    Punto operator*(const float escalar) const;
+    constexpr Punto operator*(const float escalar) const;
     
     // Operación de división entre un escalar y el punto
-    Punto operator/(const float escalar) const;
-
-    // Operador de asignación
-    Punto& operator=(const Punto& p);
+    constexpr Punto operator/(const float escalar) const;
 
     // Función que calcula el punto que hay a la misma distancia del
     // punto y el otro punto pasado por parametro, en la linea virtual
     // que los une (es decir, el punto que hay "a medio camino" entre ellos)
-    Punto puntoMedio(const Punto& p) const;
+    constexpr Punto puntoMedio(const Punto& p) const;
 };
 
+static_assert(std::is_trivially_copyable_v<Punto> && sizeof(Punto) == 12,
+              "Punto debe poder copiarse como 3 floats");
+
+
+// Definiciones en la cabecera para que el compilador pueda expandirlas en línea
+
+constexpr Punto::Punto() : PuntoDireccion() {}
+
+constexpr Punto::Punto(float x, float y, float z) : PuntoDireccion(x, y, z) {}
+
+constexpr Punto::Punto(array<float, 3> _coord) : PuntoDireccion(_coord) {}
+
+constexpr Punto::Punto(const Vec3& v) : PuntoDireccion(v.x, v.y, v.z) {}
+
+constexpr Punto Punto::operator+(const PuntoDireccion& pd) const {
+    return Punto(coord[0] + pd.coord[0], coord[1] + pd.coord[1], coord[2] + pd.coord[2]);
+}
+
+constexpr Punto Punto::operator-(const Direccion& d) const {
+    return Punto(coord[0] - d.coord[0], coord[1] - d.coord[1], coord[2] - d.coord[2]);
+}
+
+constexpr Direccion Punto::operator-(const Punto& p) const {
+    return Direccion(coord[0] - p.coord[0], coord[1] - p.coord[1], coord[2] - p.coord[2]);
+}
+
+constexpr Punto Punto::operator*(const float escalar) const {
+    return Punto(coord[0] * escalar, coord[1] * escalar, coord[2] * escalar);
+}
+
+constexpr Punto Punto::operator/(const float escalar) const {
+    if (escalar == 0) {
+        throw invalid_argument("Error: Division por cero no permitida.");
+    }
+    
+    return Punto(coord[0] / escalar, coord[1] / escalar, coord[2] / escalar);
+}
+
+constexpr Punto Punto::puntoMedio(const Punto& p) const {
+    return Punto((coord[0] + p.coord[0]) / 2, (coord[1] + p.coord[1]) / 2, (coord[2] + p.coord[2]) / 2);
+}
@@ -8,20 +8,6 @@
 #include "puntoDireccion.h"
 
 
-PuntoDireccion::PuntoDireccion(): coord({0.0f, 0.0f, 0.0f}) {}
-
-PuntoDireccion::PuntoDireccion(float x, float y, float z) : coord({x, y, z}) {}
-
-PuntoDireccion::PuntoDireccion(array<float,3> _coord) : coord(_coord) {}
-
-float PuntoDireccion::productoEscalar(const PuntoDireccion& d) const {
-    return coord[0] * d.coord[0] + coord[1] * d.coord[1] + coord[2] * d.coord[2];
-}
-
-float dot(const PuntoDireccion& d1, const PuntoDireccion& d2) {
-    return d1.productoEscalar(d2);
-}
-
 ostream& operator<<(ostream& os, const PuntoDireccion& r)
 {
     os << std::defaultfloat << std::setprecision(9) << "[" << r.coord[0] << ", " << r.coord[1]
@@ -8,40 +8,68 @@
 #pragma once
 #include <iostream>
 #include <array>
-#include "matriz.h"
 #include "utilidades.h"
+#include "vec3.h"
 
-// Clase abstracta padre a Punto y Direccion, contiene una tripleta de coordenadas x,y,z
+// Clase padre a Punto y Direccion, contiene una tripleta de coordenadas x,y,z.
+// No tiene métodos virtuales: Punto y Direccion ocupan 12 bytes y se copian con memcpy.
+// Las coordenadas homogéneas se obtienen con coordHomo (ver transformaciones.h).
 class PuntoDireccion {
 public:
     // Coordenadas x, y, z
     array<float, 3> coord;
     
     // Constructor base
-    PuntoDireccion();
+    constexpr PuntoDireccion();
 
     // Constructor dadas 3 coordenadas x, y, z
-    PuntoDireccion(float x, float y, float z);
+    constexpr PuntoDireccion(float x, float y, float z);
 
     // Constructor dadas 3 coordenadas x, y, z en un array de floats
-    PuntoDireccion(array<float, 3> _coord);
+    constexpr PuntoDireccion(array<float, 3> _coord);
     
-    // Método que devuelve las coordenadas homogéneas
-    virtual Matriz<4,1> getCoordHomo() const = 0;
+    // Método que devuelve las coordenadas como Vec3, para operar en los bucles críticos
+    constexpr Vec3 vec() const { return {coord[0], coord[1], coord[2]}; }
     
     // Función para calcular producto escalar entre d1 y d2
-    friend float dot(const PuntoDireccion& d1, const PuntoDireccion& d2);
+    friend constexpr float dot(const PuntoDireccion& d1, const PuntoDireccion& d2);
 
     // Función global para calcular el módulo
-    friend float modulo(const PuntoDireccion& d);
+    friend inline float modulo(const PuntoDireccion& d);
 
     // Función para mostrar por pantalla el contenido del punto o dirección
     friend ostream& operator<<(ostream& os, const PuntoDireccion& pd);
 
 private:
     // Método privado para calcular el módulo de la dirección
-    float modulo() const;
+    inline float modulo() const;
     
     // Método privado para calcular el producto escalar
-    float productoEscalar(const PuntoDireccion& d) const;
+    constexpr float productoEscalar(const PuntoDireccion& d) const;
 };
+
+
+// Definiciones en la cabecera para que el compilador pueda expandirlas en línea
+// en los bucles de intersección y de estimación de densidad
+
+constexpr PuntoDireccion::PuntoDireccion(): coord({0.0f, 0.0f, 0.0f}) {}
+
+constexpr PuntoDireccion::PuntoDireccion(float x, float y, float z) : coord({x, y, z}) {}
+
+constexpr PuntoDireccion::PuntoDireccion(array<float,3> _coord) : coord(_coord) {}
+
+constexpr float PuntoDireccion::productoEscalar(const PuntoDireccion& d) const {
+    return coord[0] * d.coord[0] + coord[1] * d.coord[1] + coord[2] * d.coord[2];
+}
+
+constexpr float dot(const PuntoDireccion& d1, const PuntoDireccion& d2) {
+    return d1.productoEscalar(d2);
+}
+
+inline float PuntoDireccion::modulo() const {
+    return std::sqrt(productoEscalar(*this));
+}
+
+inline float modulo(const PuntoDireccion& d) {
+    return d.modulo();
+}
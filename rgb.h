@@ -9,6 +9,7 @@
 #include <array>
 #include <initializer_list>
 #include <iostream>
+#include <algorithm>
 #include "utilidades.h"
 
 // Clase que representa una tripleta de 3 valores Rojo, Verde y Azul
@@ -18,67 +19,140 @@ public:
     array<float,3> rgb;
 
     // Constructor base
-    RGB();
+    constexpr RGB();
 
     // Constructor a partir de 3 floats
-    RGB(const float& r, const float& g, const float& b);
+    constexpr RGB(const float& r, const float& g, const float& b);
 
     // Constructor a partir de una lista de floats (coge los 3 primeros)
     RGB(init_list<float> _rgb);
 
     // Constructor a partir de un array de 3 floats
-    RGB(const array<float, 3>& _rgb);
+    constexpr RGB(const array<float, 3>& _rgb);
 
     // Constructor de copia
     RGB(const RGB& other) = default;
     
 
     // Operación de suma de dos RGB
-    RGB operator+(const RGB& d) const;
+    constexpr RGB operator+(const RGB& d) const;
     
     // Operación de resta de dos RGB
-    RGB operator-(const RGB& d) const;
+    constexpr RGB operator-(const RGB& d) const;
     
     // Operación de multiplicación entre un escalar y el RGB
-    RGB operator*(const float escalar) const;
+    constexpr RGB operator*(const float escalar) const;
 
     // Operación de multiplicación entre el RGB y otro RGB
-    RGB operator*(const RGB& d) const;
+    constexpr RGB operator*(const RGB& d) const;
     
     // Operación de división entre un escalar y el RGB
-    RGB operator/(const float escalar) const;
+    constexpr RGB operator/(const float escalar) const;
 
     // Operador de asignación
-    RGB& operator=(const RGB& d);
+    RGB& operator=(const RGB& d) = default;
     
     // Operación de asignación de array
     RGB& operator=(const init_list<float>& r);
     
     // Operación de +=
-    RGB& operator+=(const RGB& d);
+    constexpr RGB& operator+=(const RGB& d);
     
     // Función que devuelve la multiplicación entre escalar por cada componente rgb de <color>
-    friend RGB operator*(const float escalar, const RGB& color);
+    friend constexpr RGB operator*(const float escalar, const RGB& color);
     
     // Función para calcular el módulo del rgb
-    friend float modulo(const RGB& r);
+    friend inline float modulo(const RGB& r);
     
     // Función que devuelve el valor máximo del RGB
-    friend float max(const RGB& a);
+    friend constexpr float max(const RGB& a);
     
     // Función que devuelve "True" si y solo si el RGB <a> vale todo 0.
-    friend bool valeCero(const RGB& a);
+    friend constexpr bool valeCero(const RGB& a);
     
     // Función para mostrar por pantalla la información del RGB
     friend ostream& operator<<(ostream& os, const RGB& r);
 
 private:
     // Método privado para calcular el módulo del rgb
-    float modulo() const;
+    inline float modulo() const;
     
     // Método privado que devuelve el mayor valor de entre los 3 (R, G o B)
-    float max() const;
+    constexpr float max() const;
     
     // Método privado que devuelve "True" si y solo si todas las componentes de this->rgb son 0.
-    bool valeCero() const;
+    constexpr bool valeCero() const;
 };
+
+
+// Definiciones en la cabecera para que el compilador pueda expandirlas en línea
+
+constexpr RGB::RGB() : rgb({0.0f, 0.0f, 0.0f}) {}
+
+constexpr RGB::RGB(const float& r, const float& g, const float& b): rgb({r, g, b}) {}
+
+constexpr RGB::RGB(const array<float, 3>& _rgb): rgb(_rgb) {}
+
+constexpr RGB RGB::operator+(const RGB& d) const {
+    return RGB(rgb[0] + d.rgb[0], rgb[1] + d.rgb[1], rgb[2] + d.rgb[2]);
+}
+
+constexpr RGB RGB::operator-(const RGB& d) const {
+    return RGB(rgb[0] - d.rgb[0], rgb[1] - d.rgb[1], rgb[2] - d.rgb[2]);
+}
+
+constexpr RGB RGB::operator*(const float escalar) const {
+    return RGB(rgb[0] * escalar, rgb[1] * escalar, rgb[2] * escalar);
+}
+
+constexpr RGB RGB::operator*(const RGB& d) const {
+    return RGB(rgb[0] * d.rgb[0], rgb[1] * d.rgb[1], rgb[2] * d.rgb[2]);
+}
+
+constexpr RGB RGB::operator/(const float escalar) const {
+    if (escalar == 0) {
+        throw invalid_argument("Error: Division por cero no permitida.");
+    }
+    
+    return RGB(rgb[0] / escalar, rgb[1] / escalar, rgb[2] / escalar);
+}
+
+constexpr RGB& RGB::operator+=(const RGB& d) {
+    for (int i=0; i < 3; ++i) {
+        this->rgb[i] += d.rgb[i];
+    }
+    return *this;
+}
+
+constexpr RGB operator*(const float escalar, const RGB& color) {
+    return RGB(escalar * color.rgb[0], escalar * color.rgb[1], escalar * color.rgb[2]);
+}
+
+inline float RGB::modulo() const {
+    return std::sqrt(rgb[0] * rgb[0] + rgb[1] * rgb[1] + rgb[2] * rgb[2]);
+}
+
+inline float modulo(const RGB& r) {
+    return r.modulo();
+}
+
+constexpr float RGB::max() const {
+    return std::max({rgb[0], rgb[1], rgb[2]});
+}
+
+constexpr float max(const RGB& a) {
+    return a.max();
+}
+
+constexpr bool RGB::valeCero() const {
+    for (float componente : this->rgb) {
+        if (componente != 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool valeCero(const RGB& a) {
+    return a.valeCero();
+}
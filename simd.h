@@ -0,0 +1,54 @@
+//*****************************************************************
+// File:   simd.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "utilidades.h"
+
+// Número de elementos que se procesan a la vez con instrucciones SIMD
+constexpr unsigned ANCHO_PAQUETE = 8;
+
+// Vectores de ANCHO_PAQUETE floats o enteros. Las operaciones sobre ellos se traducen
+// directamente a instrucciones SIMD (extensiones vectoriales de GCC/Clang)
+typedef float flotante8 __attribute__((vector_size(ANCHO_PAQUETE * sizeof(float))));
+typedef int entero8 __attribute__((vector_size(ANCHO_PAQUETE * sizeof(int))));
+
+// Función que devuelve <n> redondeado al múltiplo de ANCHO_PAQUETE superior
+constexpr size_t conRelleno(const size_t n) {
+    return (n + ANCHO_PAQUETE - 1) / ANCHO_PAQUETE * ANCHO_PAQUETE;
+}
+
+// Función que carga ANCHO_PAQUETE floats de <v> a partir de la posición <i>
+inline flotante8 cargar(const vector<float>& v, const size_t i) {
+    flotante8 res;
+    std::memcpy(&res, &v[i], sizeof(res));
+    return res;
+}
+
+// Función que guarda <x> en <v> a partir de la posición <i>
+inline void guardar(vector<float>& v, const size_t i, const flotante8& x) {
+    std::memcpy(&v[i], &x, sizeof(x));
+}
+
+// Función que devuelve la suma de las componentes de <x>
+inline float sumaHorizontal(const flotante8& x) {
+    float suma = 0.0f;
+    for (unsigned k = 0; k < ANCHO_PAQUETE; ++k) {
+        suma += x[k];
+    }
+    return suma;
+}
+
+// Función que devuelve la mayor componente de <x>
+inline float maximoHorizontal(const flotante8& x) {
+    float maximo = x[0];
+    for (unsigned k = 1; k < ANCHO_PAQUETE; ++k) {
+        maximo = std::max(maximo, x[k]);
+    }
+    return maximo;
+}
@@ -0,0 +1,69 @@
+//*****************************************************************
+// File:   tablaAlias.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#include "tablaAlias.h"
+#include <algorithm>
+
+
+TablaAlias::TablaAlias() {}
+
+TablaAlias::TablaAlias(const vector<float>& pesos) {
+    const size_t n = pesos.size();
+    if (n == 0) {
+        return;
+    }
+
+    double total = 0.0;
+    for (float peso : pesos) {
+        total += std::max(peso, 0.0f);
+    }
+    probs.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        probs[i] = total > 0.0 ? static_cast<float>(std::max(pesos[i], 0.0f) / total) : 1.0f / n;
+    }
+
+    // Cada casilla tiene capacidad 1: las que se quedan cortas se completan con un índice
+    // de los que se pasan, que queda como su alias
+    umbral.resize(n);
+    alias.resize(n);
+    vector<double> escalado(n);
+    vector<unsigned> pequenos, grandes;
+    for (size_t i = 0; i < n; ++i) {
+        escalado[i] = probs[i] * n;
+        alias[i] = i;
+        (escalado[i] < 1.0 ? pequenos : grandes).push_back(i);
+    }
+    while (!pequenos.empty() && !grandes.empty()) {
+        unsigned p = pequenos.back(), g = grandes.back();
+        pequenos.pop_back();
+        umbral[p] = static_cast<float>(escalado[p]);
+        alias[p] = g;
+        escalado[g] -= 1.0 - escalado[p];
+        if (escalado[g] < 1.0) {
+            grandes.pop_back();
+            pequenos.push_back(g);
+        }
+    }
+    // Las casillas que quedan están llenas (salvo error de redondeo)
+    for (unsigned i : grandes) umbral[i] = 1.0f;
+    for (unsigned i : pequenos) umbral[i] = 1.0f;
+}
+
+size_t TablaAlias::size() const {
+    return probs.size();
+}
+
+unsigned TablaAlias::muestrear(const float u, float& prob) const {
+    const float x = u * umbral.size();
+    const unsigned casilla = std::min(static_cast<unsigned>(x), static_cast<unsigned>(umbral.size() - 1));
+    const unsigned i = (x - casilla < umbral[casilla]) ? casilla : alias[casilla];
+    prob = probs[i];
+    return i;
+}
+
+float TablaAlias::probabilidad(const unsigned i) const {
+    return probs[i];
+}
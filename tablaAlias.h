@@ -0,0 +1,39 @@
+//*****************************************************************
+// File:   tablaAlias.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+#include <vector>
+#include "utilidades.h"
+
+// Tabla de alias (método de Vose) para muestrear en O(1) un índice entre 0 y n-1 con
+// probabilidad proporcional a unos pesos dados, p.ej. la potencia de cada luz
+class TablaAlias {
+public:
+    // Constructor base (tabla vacía)
+    TablaAlias();
+
+    // Constructor a partir de los <pesos> (no negativos) de cada índice. Si todos son 0,
+    // la tabla muestrea los índices de manera uniforme.
+    TablaAlias(const vector<float>& pesos);
+
+    // Método que devuelve el número de índices de la tabla
+    size_t size() const;
+
+    // Método que devuelve un índice muestreado con el número aleatorio <u> en [0, 1),
+    // y en <prob> la probabilidad de haberlo elegido
+    unsigned muestrear(const float u, float& prob) const;
+
+    // Método que devuelve la probabilidad de elegir el índice <i>
+    float probabilidad(const unsigned i) const;
+
+private:
+    // Probabilidad de quedarse con el índice de cada casilla (si no, se elige su alias)
+    vector<float> umbral;
+    vector<unsigned> alias;
+
+    // Probabilidad normalizada de cada índice
+    vector<float> probs;
+};
@@ -16,6 +16,16 @@ Direccion dirFromCoordHomo(Matriz<4,1> m){
     return Direccion(m.matriz[0][0], m.matriz[1][0], m.matriz[2][0]);
 }
 
+Matriz<4,1> coordHomo(const Punto& p){
+    array<array<float, 1>, 4> res = {p.coord[0], p.coord[1], p.coord[2], 1.0f};
+    return res;
+}
+
+Matriz<4,1> coordHomo(const Direccion& d){
+    array<array<float, 1>, 4> res = {d.coord[0], d.coord[1], d.coord[2], 0.0f};
+    return res;
+}
+
 Punto translate(const Punto& pd, float x, float y, float z) {
     Matriz<4, 4> m = Matriz<4, 4>(
             init_list<init_list<float>>{
@@ -26,7 +36,7 @@ Punto translate(const Punto& pd, float x, float y, float z) {
             }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return puntoFromCoordHomo(res);
 }
@@ -42,7 +52,7 @@ Punto scale(const Punto& pd, float x, float y, float z) {
             }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return puntoFromCoordHomo(res);
 }
@@ -62,7 +72,7 @@ Punto rotateX(const Punto& pd, float d) {
         }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return puntoFromCoordHomo(res);
 }
@@ -82,7 +92,7 @@ Punto rotateY(const Punto& pd, float d) {
         }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return puntoFromCoordHomo(res);
 }
@@ -102,7 +112,7 @@ Punto rotateZ(const Punto& pd, float d) {
         }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return puntoFromCoordHomo(res);
 }
@@ -118,7 +128,7 @@ Direccion translate(const Direccion& pd, float x, float y, float z) {
             }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return dirFromCoordHomo(res);
 }
@@ -134,7 +144,7 @@ Direccion scale(const Direccion& pd, float x, float y, float z) {
             }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return dirFromCoordHomo(res);
 }
@@ -154,7 +164,7 @@ Direccion rotateX(const Direccion& pd, float d) {
         }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return dirFromCoordHomo(res);
 }
@@ -174,7 +184,7 @@ Direccion rotateY(const Direccion& pd, float d) {
         }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return dirFromCoordHomo(res);
 }
@@ -194,7 +204,7 @@ Direccion rotateZ(const Direccion& pd, float d) {
         }
     );
 
-    Matriz<4, 1> p = Matriz<4, 1>(pd.getCoordHomo());
+    Matriz<4, 1> p = Matriz<4, 1>(coordHomo(pd));
     Matriz<4, 1> res = m * p;
     return dirFromCoordHomo(res);
 }
@@ -214,9 +224,9 @@ Punto cambioBase(const Punto& p, const Base& b, const Punto& o, const bool& inve
     
     if (invertir) {
         Matriz<4, 4> ucsToLocal = m.inversa();
-        res = Matriz<4, 1>((ucsToLocal * p.getCoordHomo()).matriz);
+        res = Matriz<4, 1>((ucsToLocal * coordHomo(p)).matriz);
     } else {
-        res = Matriz<4, 1>((m * p.getCoordHomo()).matriz);
+        res = Matriz<4, 1>((m * coordHomo(p)).matriz);
     }
 
     return puntoFromCoordHomo(res);
@@ -235,9 +245,9 @@ Direccion cambioBase(const Direccion& d, const Base& b, const Punto& o, const bo
     
     if (invertir) {
         Matriz<4, 4> ucsToLocal = m.inversa();
-        res = Matriz<4, 1>((ucsToLocal * d.getCoordHomo()).matriz);
+        res = Matriz<4, 1>((ucsToLocal * coordHomo(d)).matriz);
     } else {
-        res = Matriz<4, 1>((m * d.getCoordHomo()).matriz);
+        res = Matriz<4, 1>((m * coordHomo(d)).matriz);
     }
 
     // cout << m << "\n" << ucsToLocal << endl;
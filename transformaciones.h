@@ -58,5 +58,11 @@ Direccion cambioBase(const Direccion& d, const Base& b, const Punto& o, const bo
 // Funcion que, dada una matriz de coordenada homogeneas, devuelve el punto correspondiente 
 Punto puntoFromCoordHomo(Matriz<4,1> m);
 
+// Funcion que devuelve una Matriz 4x1 con las coordenadas homogeneas del punto <p>
+Matriz<4,1> coordHomo(const Punto& p);
+
+// Funcion que devuelve una Matriz 4x1 con las coordenadas homogeneas de la direccion <d>
+Matriz<4,1> coordHomo(const Direccion& d);
+
 // Funcion que, dada una matriz de coordenada homogeneas, devuelve la direccion correspondiente 
 Direccion dirFromCoordHomo(Matriz<4,1> m);
@@ -5,7 +5,6 @@
 // Coms:   Práctica 1 de Informática Gráfica
 //*****************************************************************
 
-#include <random>
 #include "triangulo.h"
 #include "utilidades.h"
 
@@ -133,31 +132,19 @@ bool Triangulo::puntoEsFuenteDeLuz(const Punto& punto) const {
     return soyFuenteDeLuz() && pertenece(punto);
 }
 
-Punto Triangulo::generarPuntoAleatorio(float& prob) const {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
-    float r1 = dist(gen);
-    float r2 = dist(gen);
-
-    // r1 + r2 <= 1.0 (si no, reflejamos el punto en el triángulo)
-    if (r1 + r2 > 1.0f) {
-        r1 = 1.0f - r1;
-        r2 = 1.0f - r2;
-    }
-
-    // Coordenadas baricéntricas
-    float a = 1.0f - r1 - r2;
-    float b = r1;
-    float c = r2;
+Punto Triangulo::muestrearPuntoArea(const float u1, const float u2, float& prob) const {
+    // Coordenadas baricéntricas uniformes por área
+    float raiz = sqrt(u1);
+    float a = 1.0f - raiz;
+    float b = u2 * raiz;
+    float c = 1.0f - a - b;
 
     // Coordenadas baricéntricas --> coordenadas cartesianas
     Punto puntoAleatorio = p0 * a + p1 * b + p2 * c;
 
     Direccion crossProd = cross(p1 - p0, p2 - p0);
     float areaTriangulo = modulo(crossProd) * 0.5f;
-    prob = 1.0f / areaTriangulo;
+    prob = (areaTriangulo > 0.0f) ? 1.0f / areaTriangulo : 0.0f;
 
     return puntoAleatorio;
 }
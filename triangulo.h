@@ -70,9 +70,9 @@ public:
     // y además, es un punto lumínico del triángulo.
     bool puntoEsFuenteDeLuz(const Punto& punto) const override;
     
-    // Funcion que devuelve un punto aleatorio del triángulo en UCS.
-    // También devuelve en <prob> la probabilidad de muestrear dicho punto.
-    Punto generarPuntoAleatorio(float& prob) const override;
+    // Funcion que devuelve el punto del triángulo que corresponde a la muestra (<u1>, <u2>),
+    // y en <prob> la densidad respecto del área.
+    Punto muestrearPuntoArea(const float u1, const float u2, float& prob) const override;
     
     // Funcion que obtiene la posición del punto <pto> del triángulo en el eje U de la
     // textura correspondiente. Tenemos garantizado que <pto> pertenece al objeto.
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <string>
 #include <array>
+#include <cstdint>
 #include <list>
 #include <vector>
 #include <stack>
@@ -31,7 +32,29 @@ constexpr float MARGEN_ERROR_INTERSEC_ESFERA = 8e-5f;          // Para calcular
 constexpr float MARGEN_ERROR_FOTON = 1e-7f;
 constexpr float GRAD_A_RAD = 3.1415926535898f / 180;
 //const double M_PI = 3.14159265358979323846;
-constexpr int NUM_MUESTRAS_LUZ_AREA = 50;
+constexpr unsigned MUESTRAS_LUZ_AREA = 1;              // Rayos de sombra por luz de área en NEE por defecto
+constexpr float MARGEN_ERROR_VISIBILIDAD = 1e-3f;      // Tolerancia relativa al comprobar si un punto de luz es visible
+constexpr unsigned MAX_DIMENSIONES_SOBOL = 16;          // Dimensiones con números de dirección de Sobol
+constexpr unsigned MAX_DIMENSIONES_HALTON = 32;         // Dimensiones de Halton (una base prima por dimensión)
+constexpr unsigned PROFUNDIDAD_MAXIMA_CAMINO = 32;     // Rebotes máximos por defecto de un fotón
+constexpr unsigned PROFUNDIDAD_MINIMA_RULETA = 3;      // Rebotes antes de aplicar ruleta rusa por flujo
+constexpr unsigned TAM_LOTE_WAVEFRONT = 4096;          // Rayos por lote en el trazado wavefront de fotones
+constexpr float FOTONES_POR_CELDA_DENSIDAD = 8.0f;     // Media de fotones por celda (contando vacías) de RejillaDensidad
+constexpr unsigned MAX_CELDAS_EJE_DENSIDAD = 256;      // Resolución máxima por eje de RejillaDensidad
+constexpr float MARGEN_RADIO_ADAPTATIVO = 1.25f;       // Factor sobre el radio estimado en la búsqueda ADAPTATIVO
+constexpr unsigned TAM_TESELA = 32;                    // Lado en píxeles de las teselas del render distribuido
+constexpr int TIEMPO_ESPERA_TRABAJADORES = 60;         // Segundos sin trabajadores antes de abandonar el render distribuido
+constexpr unsigned MAX_TRABAJADORES_LOCALES = 256;     // Procesos trabajadores que puede lanzar el coordinador en su máquina
+constexpr int TIEMPO_MAX_TESELA = 600;                 // Segundos de un trabajador con una tesela antes de reasignarla
+constexpr unsigned MAX_BYTES_MENSAJE_TEXTO = 65536;    // Longitud máxima de los mensajes TRABAJO y ERROR del render distribuido
+constexpr int TIEMPO_MAX_MENSAJE = 30;                 // Segundos para completar un mensaje ya empezado antes de dar la conexión por perdida
+constexpr unsigned MAX_TROZOS_FRAGMENTO = 65536;       // Threads máximos de un fragmento de fotones (separa sus semillas)
+constexpr unsigned MAX_FRAGMENTOS = 65536;             // Fragmentos máximos, para que fragmento * MAX_TROZOS_FRAGMENTO quepa en 32 bits
+constexpr uint32_t SEMILLA_FRAGMENTOS = 839304;        // Semilla de los fragmentos de fotones si los parámetros no fijan una
+constexpr unsigned FOTONES_POR_PAGINA = 4096;          // Fotones por página del mapa de fotones paginado
+constexpr unsigned PAGINAS_RECIENTES_THREAD = 16;      // Páginas del mapa paginado que cada thread usa sin tocar la caché compartida
+constexpr unsigned TAM_TESELA_MORTON = 16;             // Lado en píxeles de las teselas del recorrido en orden Morton
+constexpr unsigned MIN_FOTONES_AGREGADO = 32;          // Fotones mínimos de un subárbol del PhotonMap para guardar su agregado
 
 // Tipos o abreviaturas
 template<typename T>
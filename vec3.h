@@ -0,0 +1,64 @@
+//*****************************************************************
+// File:   vec3.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+#include <array>
+#include <cmath>
+#include <type_traits>
+
+// Tripleta x, y, z de floats sin constructores, herencia ni vtable (POD), para los
+// cálculos de los bucles críticos. Ocupa exactamente 12 bytes, de modo que un array
+// de Vec3 queda empaquetado; quien necesite cargas SIMD alineadas debe usar una
+// estructura de arrays (ver wavefront.h y bloqueTriangulos.h).
+struct Vec3 {
+    float x, y, z;
+};
+
+static_assert(std::is_trivial_v<Vec3> && std::is_standard_layout_v<Vec3> && sizeof(Vec3) == 12,
+              "Vec3 debe ser POD y ocupar 12 bytes");
+
+// Función que construye un Vec3 a partir de un array de 3 floats
+constexpr Vec3 vec3(const std::array<float, 3>& c) { return {c[0], c[1], c[2]}; }
+
+constexpr Vec3 operator+(const Vec3& a, const Vec3& b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+constexpr Vec3 operator-(const Vec3& a, const Vec3& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+constexpr Vec3 operator-(const Vec3& a) { return {-a.x, -a.y, -a.z}; }
+constexpr Vec3 operator*(const Vec3& a, const float s) { return {a.x * s, a.y * s, a.z * s}; }
+constexpr Vec3 operator*(const float s, const Vec3& a) { return {a.x * s, a.y * s, a.z * s}; }
+constexpr Vec3 operator/(const Vec3& a, const float s) { return {a.x / s, a.y / s, a.z / s}; }
+
+// Función para calcular el producto escalar entre <a> y <b>
+constexpr float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+// Función para calcular el producto vectorial entre <a> y <b>
+constexpr Vec3 cross(const Vec3& a, const Vec3& b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+// Función que devuelve el módulo al cuadrado de <a> (sin raíz cuadrada)
+constexpr float modulo2(const Vec3& a) { return dot(a, a); }
+
+// Función que devuelve el módulo de <a>
+inline float modulo(const Vec3& a) { return std::sqrt(dot(a, a)); }
+
+// Función que devuelve <a> normalizado. No comprueba que el módulo sea distinto de 0.
+inline Vec3 normalizar(const Vec3& a) { return a / modulo(a); }
+
+// Función que intercala con dos ceros los 10 bits menos significativos de <x>
+constexpr unsigned expandirBits(unsigned x) {
+    x &= 0x3FF;
+    x = (x | (x << 16)) & 0x030000FF;
+    x = (x | (x << 8)) & 0x0300F00F;
+    x = (x | (x << 4)) & 0x030C30C3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+// Función que devuelve el código Morton de 30 bits de la celda (<x>, <y>, <z>) de una rejilla
+// de 1024^3 celdas
+constexpr unsigned codigoMorton(const unsigned x, const unsigned y, const unsigned z) {
+    return expandirBits(x) | (expandirBits(y) << 1) | (expandirBits(z) << 2);
+}
@@ -0,0 +1,385 @@
+//*****************************************************************
+// File:   wavefront.cpp
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+
+#include "wavefront.h"
+#include "plano.h"
+#include "esfera.h"
+#include "mesh.h"
+#include "aleatorio.h"
+#include "instrumentacion.h"
+#include "vec3.h"
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstring>
+
+EscenaSoA::EscenaSoA(): numTriangulosSueltos(0) {}
+
+EscenaSoA::EscenaSoA(const Escena& escena): numTriangulosSueltos(0) {
+    vector<const Plano*> planos;
+    vector<const Esfera*> esferas;
+    vector<const Triangulo*> sueltos;
+    vector<const Mesh*> mallasEscena;
+
+    for (const Primitiva* prim : escena.primitivas) {
+        if (auto plano = dynamic_cast<const Plano*>(prim)) {
+            planos.push_back(plano);
+        } else if (auto esfera = dynamic_cast<const Esfera*>(prim)) {
+            esferas.push_back(esfera);
+        } else if (auto triangulo = dynamic_cast<const Triangulo*>(prim)) {
+            sueltos.push_back(triangulo);
+        } else if (auto malla = dynamic_cast<const Mesh*>(prim)) {
+            mallasEscena.push_back(malla);
+        } else {
+            resto.push_back(prim);
+        }
+    }
+
+    for (const Plano* plano : planos) {
+        planoNx.push_back(plano->n.coord[0]);
+        planoNy.push_back(plano->n.coord[1]);
+        planoNz.push_back(plano->n.coord[2]);
+        planoD.push_back(plano->d);
+        objetos.push_back(plano);
+    }
+
+    for (const Esfera* esfera : esferas) {
+        esferaCx.push_back(esfera->centro.coord[0]);
+        esferaCy.push_back(esfera->centro.coord[1]);
+        esferaCz.push_back(esfera->centro.coord[2]);
+        esferaR2.push_back(esfera->radio * esfera->radio);
+        objetos.push_back(esfera);
+    }
+
+    auto anyadirTriangulo = [&](const Triangulo& tri, const Primitiva* propietario) {
+        Direccion e1 = tri.p1 - tri.p0;
+        Direccion e2 = tri.p2 - tri.p0;
+        triP0x.push_back(tri.p0.coord[0]);
+        triP0y.push_back(tri.p0.coord[1]);
+        triP0z.push_back(tri.p0.coord[2]);
+        triE1x.push_back(e1.coord[0]);
+        triE1y.push_back(e1.coord[1]);
+        triE1z.push_back(e1.coord[2]);
+        triE2x.push_back(e2.coord[0]);
+        triE2y.push_back(e2.coord[1]);
+        triE2z.push_back(e2.coord[2]);
+        triangulos.push_back(&tri);
+        objetos.push_back(propietario);
+    };
+
+    for (const Triangulo* tri : sueltos) {
+        anyadirTriangulo(*tri, tri);
+    }
+    numTriangulosSueltos = sueltos.size();
+
+    for (const Mesh* malla : mallasEscena) {
+        RangoMalla rango;
+        rango.inicio = triangulos.size();
+        for (const Triangulo& tri : malla->triangulos) {
+            anyadirTriangulo(tri, malla);   // Los BSDFs son los de la malla, como en Escena::interseccion
+        }
+        rango.fin = triangulos.size();
+        rango.cx = malla->esferaLimite.centro.coord[0];
+        rango.cy = malla->esferaLimite.centro.coord[1];
+        rango.cz = malla->esferaLimite.centro.coord[2];
+        rango.radio2 = malla->esferaLimite.radio * malla->esferaLimite.radio;
+        mallas.push_back(rango);
+    }
+
+    for (const Primitiva* prim : resto) {
+        objetos.push_back(prim);
+    }
+}
+
+Direccion EscenaSoA::getNormal(const int impacto, const Punto& p) const {
+    const size_t inicioTriangulos = planoD.size() + esferaR2.size();
+    const size_t i = static_cast<size_t>(impacto);
+    if (i >= inicioTriangulos && i < inicioTriangulos + triangulos.size()) {
+        // Normal del triángulo impactado, sin buscar el más cercano dentro de la malla
+        return triangulos[i - inicioTriangulos]->getNormal(p);
+    }
+    return objetos[i]->getNormal(p);
+}
+
+
+size_t LoteRayos::size() const {
+    return numRayos;
+}
+
+void LoteRayos::redimensionar(const size_t n) {
+    const size_t tam = conRelleno(n);
+    numRayos = n;
+    ox.resize(tam, 0.0f);
+    oy.resize(tam, 0.0f);
+    oz.resize(tam, 0.0f);
+    dx.resize(tam, 0.0f);
+    dy.resize(tam, 0.0f);
+    dz.resize(tam, 1.0f);
+    t.resize(tam);
+    impacto.resize(tam);
+    estados.resize(n);
+}
+
+void LoteRayos::asignarRayo(const size_t i, const Rayo& rayo) {
+    ox[i] = rayo.o.coord[0];
+    oy[i] = rayo.o.coord[1];
+    oz[i] = rayo.o.coord[2];
+    dx[i] = rayo.d.coord[0];
+    dy[i] = rayo.d.coord[1];
+    dz[i] = rayo.d.coord[2];
+}
+
+
+// Función que aplica la permutación <orden> al array <v>, usando <aux> como almacenamiento temporal
+template <typename T>
+static void permutar(vector<T>& v, const vector<unsigned>& orden, vector<T>& aux) {
+    aux.resize(v.size());
+    for (size_t i = 0; i < orden.size(); ++i) {
+        aux[i] = v[orden[i]];
+    }
+    std::copy(aux.begin(), aux.begin() + orden.size(), v.begin());
+}
+
+void ordenarLote(LoteRayos& lote) {
+    const size_t n = lote.size();
+    if (n < 2) return;
+
+    float minimo[3] = {lote.ox[0], lote.oy[0], lote.oz[0]};
+    float maximo[3] = {lote.ox[0], lote.oy[0], lote.oz[0]};
+    for (size_t i = 1; i < n; ++i) {
+        minimo[0] = std::min(minimo[0], lote.ox[i]); maximo[0] = std::max(maximo[0], lote.ox[i]);
+        minimo[1] = std::min(minimo[1], lote.oy[i]); maximo[1] = std::max(maximo[1], lote.oy[i]);
+        minimo[2] = std::min(minimo[2], lote.oz[i]); maximo[2] = std::max(maximo[2], lote.oz[i]);
+    }
+    float escala[3];
+    for (int k = 0; k < 3; ++k) {
+        float ancho = maximo[k] - minimo[k];
+        escala[k] = (ancho > 0.0f) ? 1023.0f / ancho : 0.0f;
+    }
+
+    // Clave: 3 bits de octante de la dirección seguidos de 30 bits de código Morton del origen
+    vector<unsigned long> claves(n);
+    for (size_t i = 0; i < n; ++i) {
+        unsigned long octante = (lote.dx[i] < 0.0f) | ((lote.dy[i] < 0.0f) << 1) | ((lote.dz[i] < 0.0f) << 2);
+        unsigned qx = static_cast<unsigned>((lote.ox[i] - minimo[0]) * escala[0]);
+        unsigned qy = static_cast<unsigned>((lote.oy[i] - minimo[1]) * escala[1]);
+        unsigned qz = static_cast<unsigned>((lote.oz[i] - minimo[2]) * escala[2]);
+        unsigned long morton = codigoMorton(qx, qy, qz);
+        claves[i] = (octante << 30) | morton;
+    }
+
+    vector<unsigned> orden(n);
+    std::iota(orden.begin(), orden.end(), 0);
+    std::sort(orden.begin(), orden.end(), [&](unsigned a, unsigned b) { return claves[a] < claves[b]; });
+
+    vector<float> auxF;
+    permutar(lote.ox, orden, auxF);
+    permutar(lote.oy, orden, auxF);
+    permutar(lote.oz, orden, auxF);
+    permutar(lote.dx, orden, auxF);
+    permutar(lote.dy, orden, auxF);
+    permutar(lote.dz, orden, auxF);
+    vector<EstadoCamino> auxE;
+    permutar(lote.estados, orden, auxE);
+}
+
+
+// Paquete de ANCHO_PAQUETE rayos cargado en registros SIMD
+struct PaqueteRayos {
+    flotante8 ox, oy, oz, dx, dy, dz;
+};
+
+static flotante8 raiz(flotante8 x) {
+    for (unsigned k = 0; k < ANCHO_PAQUETE; ++k) {
+        x[k] = std::sqrt(std::max(x[k], 0.0f));
+    }
+    return x;
+}
+
+static bool algunoActivo(const entero8& mascara) {
+    for (unsigned k = 0; k < ANCHO_PAQUETE; ++k) {
+        if (mascara[k]) return true;
+    }
+    return false;
+}
+
+// Función que devuelve, para cada rayo del paquete, la distancia a la que interseca
+// con la esfera de centro <c> y radio^2 <r2>. En <entrada> devuelve la raíz menor y
+// en <salida> la mayor; la máscara devuelta indica los rayos con soluciones reales.
+static entero8 resolverEsfera(const PaqueteRayos& r, const float cx, const float cy, const float cz,
+                              const float r2, flotante8& entrada, flotante8& salida) {
+    flotante8 ocx = r.ox - cx, ocy = r.oy - cy, ocz = r.oz - cz;
+    flotante8 a = r.dx * r.dx + r.dy * r.dy + r.dz * r.dz;
+    flotante8 b = 2.0f * (r.dx * ocx + r.dy * ocy + r.dz * ocz);
+    flotante8 c = ocx * ocx + ocy * ocy + ocz * ocz - r2;
+    flotante8 discriminante = b * b - 4.0f * a * c;
+    flotante8 s = raiz(discriminante);
+    entrada = (-b - s) / (2.0f * a);
+    salida = (-b + s) / (2.0f * a);
+    return discriminante >= 0.0f;
+}
+
+// Función que interseca el paquete <r> con los triángulos [inicio, fin) de <escena>
+// para los rayos activos en <mascara>, actualizando el impacto más cercano
+static void intersecarTriangulos(const EscenaSoA& escena, const PaqueteRayos& r, const size_t inicio,
+                                 const size_t fin, const int base, const entero8& mascara,
+                                 flotante8& tMin, entero8& impacto) {
+    for (size_t i = inicio; i < fin; ++i) {
+        const float e1x = escena.triE1x[i], e1y = escena.triE1y[i], e1z = escena.triE1z[i];
+        const float e2x = escena.triE2x[i], e2y = escena.triE2y[i], e2z = escena.triE2z[i];
+        // Möller–Trumbore, igual que Triangulo::interseccion
+        flotante8 hx = r.dy * e2z - r.dz * e2y;
+        flotante8 hy = r.dz * e2x - r.dx * e2z;
+        flotante8 hz = r.dx * e2y - r.dy * e2x;
+        flotante8 a = e1x * hx + e1y * hy + e1z * hz;
+        flotante8 f = 1.0f / a;
+        flotante8 sx = r.ox - escena.triP0x[i], sy = r.oy - escena.triP0y[i], sz = r.oz - escena.triP0z[i];
+        flotante8 u = f * (sx * hx + sy * hy + sz * hz);
+        flotante8 qx = sy * e1z - sz * e1y;
+        flotante8 qy = sz * e1x - sx * e1z;
+        flotante8 qz = sx * e1y - sy * e1x;
+        flotante8 v = f * (r.dx * qx + r.dy * qy + r.dz * qz);
+        flotante8 t = f * (e2x * qx + e2y * qy + e2z * qz);
+        entero8 valido = mascara & ((a >= MARGEN_ERROR) | (a <= -MARGEN_ERROR))
+                         & (u >= 0.0f) & (u <= 1.0f) & (v >= 0.0f) & (u + v <= 1.0f)
+                         & (t > MARGEN_ERROR) & (t < tMin);
+        tMin = valido ? t : tMin;
+        impacto = valido ? base + static_cast<int>(i) : impacto;
+    }
+}
+
+void intersecarLote(const EscenaSoA& escena, LoteRayos& lote) {
+    const size_t n = lote.size();
+    CONTAR(RAYOS_TRAZADOS, n);
+    const int basePlanos = 0;
+    const int baseEsferas = basePlanos + escena.planoD.size();
+    const int baseTriangulos = baseEsferas + escena.esferaR2.size();
+    const int baseResto = baseTriangulos + escena.triangulos.size();
+    const entero8 todos = entero8{} - 1;
+
+    for (size_t p = 0; p < n; p += ANCHO_PAQUETE) {
+        PaqueteRayos r = {cargar(lote.ox, p), cargar(lote.oy, p), cargar(lote.oz, p),
+                          cargar(lote.dx, p), cargar(lote.dy, p), cargar(lote.dz, p)};
+        flotante8 tMin = flotante8{} + std::numeric_limits<float>::infinity();
+        entero8 impacto = entero8{} - 1;
+
+        for (size_t i = 0; i < escena.planoD.size(); ++i) {
+            const float nx = escena.planoNx[i], ny = escena.planoNy[i], nz = escena.planoNz[i];
+            flotante8 denominador = r.dx * nx + r.dy * ny + r.dz * nz;
+            flotante8 t = -(escena.planoD[i] + r.ox * nx + r.oy * ny + r.oz * nz) / denominador;
+            entero8 valido = ((denominador >= MARGEN_ERROR_INTERSEC_PLANO) | (denominador <= -MARGEN_ERROR_INTERSEC_PLANO))
+                             & (t > MARGEN_ERROR_INTERSEC_PLANO) & (t < tMin);
+            tMin = valido ? t : tMin;
+            impacto = valido ? basePlanos + static_cast<int>(i) : impacto;
+        }
+
+        for (size_t i = 0; i < escena.esferaR2.size(); ++i) {
+            flotante8 entrada, salida;
+            entero8 real = resolverEsfera(r, escena.esferaCx[i], escena.esferaCy[i], escena.esferaCz[i],
+                                          escena.esferaR2[i], entrada, salida);
+            flotante8 t = (entrada > MARGEN_ERROR_INTERSEC_ESFERA) ? entrada : salida;
+            entero8 valido = real & (t > MARGEN_ERROR_INTERSEC_ESFERA) & (t < tMin);
+            tMin = valido ? t : tMin;
+            impacto = valido ? baseEsferas + static_cast<int>(i) : impacto;
+        }
+
+        intersecarTriangulos(escena, r, 0, escena.numTriangulosSueltos, baseTriangulos, todos, tMin, impacto);
+
+        for (const RangoMalla& malla : escena.mallas) {
+            flotante8 entrada, salida;
+            entero8 real = resolverEsfera(r, malla.cx, malla.cy, malla.cz, malla.radio2, entrada, salida);
+            entero8 mascara = real & (salida > MARGEN_ERROR_INTERSEC_ESFERA);
+            if (algunoActivo(mascara)) {
+                intersecarTriangulos(escena, r, malla.inicio, malla.fin, baseTriangulos, mascara, tMin, impacto);
+            }
+        }
+
+        guardar(lote.t, p, tMin);
+        std::memcpy(&lote.impacto[p], &impacto, sizeof(impacto));
+    }
+
+    // Primitivas sin versión vectorizada: rayo a rayo con su método virtual
+    for (size_t j = 0; j < escena.resto.size(); ++j) {
+        for (size_t i = 0; i < n; ++i) {
+            Rayo rayo(Direccion(lote.dx[i], lote.dy[i], lote.dz[i]), Punto(lote.ox[i], lote.oy[i], lote.oz[i]));
+            vector<Punto> intersecciones;
+            BSDFs coefsAux;
+            escena.resto[j]->interseccion(rayo, intersecciones, coefsAux);
+            if (!intersecciones.empty()) {
+                float t = modulo(intersecciones[0] - rayo.o) / modulo(rayo.d);
+                if (t < lote.t[i]) {
+                    lote.t[i] = t;
+                    lote.impacto[i] = baseResto + static_cast<int>(j);
+                }
+            }
+        }
+    }
+}
+
+
+int lanzarFotonesWavefront(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                           const int numFotonesALanzar, const int numFotonesTotales, const Escena& escena,
+                           const EscenaSoA& escenaSoA, const Parametros& parametros,
+                           unsigned long& rayosTrazados) {
+    const int tamLote = std::max(1u, parametros.tamLoteWavefront);
+    int numFotonesLanzados = 0;
+    LoteRayos lote;
+    const uint32_t semilla = generadorThread()();
+
+    for (int restantes = numFotonesALanzar; restantes > 0; restantes -= tamLote) {
+        const int numRayos = std::min(tamLote, restantes);
+
+        lote.redimensionar(numRayos);
+        for (int i = 0; i < numRayos; ++i) {
+            EstadoCamino& estado = lote.estados[i];
+            estado.muestreador = Muestreador(parametros.muestreador, semilla);
+            estado.muestreador.comenzarMuestra(numFotonesLanzados + i);
+            activarMuestreador(&estado.muestreador);
+            lote.asignarRayo(i, emitirFoton(escena, numFotonesTotales, estado.flujoInicial));
+            estado.flujo = estado.flujoInicial;
+            estado.profundidad = 0;
+            estado.caustico = false;
+            estado.primerFoton = parametros.nee;
+        }
+        numFotonesLanzados += numRayos;
+
+        while (lote.size() > 0) {
+            ordenarLote(lote);
+            intersecarLote(escenaSoA, lote);
+            rayosTrazados += lote.size();
+
+            // Sombreado y compactación: los caminos vivos se mueven al principio del lote
+            size_t vivos = 0;
+            for (size_t i = 0; i < lote.size(); ++i) {
+                const int impacto = lote.impacto[i];
+                if (impacto < 0) continue;
+
+                EstadoCamino& estado = lote.estados[i];
+                const float t = lote.t[i];
+                estado.wo = Direccion(lote.dx[i], lote.dy[i], lote.dz[i]);
+                estado.origen = Punto(lote.ox[i] + lote.dx[i] * t, lote.oy[i] + lote.dy[i] * t,
+                                      lote.oz[i] + lote.dz[i] * t);
+                estado.normal = escenaSoA.getNormal(impacto, estado.origen);
+                estado.coefs = &escenaSoA.objetos[impacto]->coeficientes;
+
+                // Los caminos se intercalan, así que cada uno reactiva su propio muestreador
+                activarMuestreador(&estado.muestreador);
+                Rayo siguiente;
+                if (interaccionCaminoFoton(estado, vecFotonesGlobales, vecFotonesCausticos,
+                                           parametros, siguiente)) {
+                    if (vivos != i) lote.estados[vivos] = estado;
+                    lote.asignarRayo(vivos, siguiente);
+                    vivos++;
+                }
+            }
+            lote.redimensionar(vivos);
+        }
+    }
+    activarMuestreador(nullptr);
+
+    return numFotonesLanzados;
+}
@@ -0,0 +1,101 @@
+//*****************************************************************
+// File:   wavefront.h
+// Author: Ming Tao, Ye   NIP: 839757, Puig Rubio, Manel Jorda  NIP: 839304
+// Date:   diciembre 2024
+// Coms:   Práctica 5 de Informática Gráfica
+//*****************************************************************
+#pragma once
+#include "photonMapping.h"
+#include "escena.h"
+#include "triangulo.h"
+#include "parametros.h"
+#include "simd.h"
+#include "utilidades.h"
+
+// Rango de triángulos de una malla dentro de EscenaSoA, junto con su esfera límite
+struct RangoMalla {
+    size_t inicio, fin;
+    float cx, cy, cz, radio2;
+};
+
+// Escena "aplanada" por tipo de primitiva en estructura de arrays (SoA), para poder
+// intersecar paquetes de rayos contra cada primitiva sin llamadas virtuales
+class EscenaSoA {
+public:
+    // Planos: normal y distancia
+    vector<float> planoNx, planoNy, planoNz, planoD;
+
+    // Esferas: centro y radio al cuadrado
+    vector<float> esferaCx, esferaCy, esferaCz, esferaR2;
+
+    // Triángulos sueltos y de mallas (primero los sueltos): vértice p0 y aristas p1-p0, p2-p0
+    vector<float> triP0x, triP0y, triP0z, triE1x, triE1y, triE1z, triE2x, triE2y, triE2z;
+    size_t numTriangulosSueltos;
+
+    // Triángulo original de cada entrada, para obtener la normal en el punto de impacto
+    vector<const Triangulo*> triangulos;
+
+    // Mallas de la escena, cada una con su rango de triángulos
+    vector<RangoMalla> mallas;
+
+    // Primitivas sin versión vectorizada (p.ej. cuboides), se intersecan con su método virtual
+    vector<const Primitiva*> resto;
+
+    // Primitiva a la que pertenece cada índice de impacto, en el orden
+    // [planos | esferas | triángulos | resto]
+    vector<const Primitiva*> objetos;
+
+    // Constructor base (escena vacía)
+    EscenaSoA();
+
+    // Constructor a partir de las primitivas de <escena>
+    EscenaSoA(const Escena& escena);
+
+    // Método que devuelve la normal en <p> del objeto con índice de impacto <impacto>
+    Direccion getNormal(const int impacto, const Punto& p) const;
+};
+
+// Lote de rayos de fotones en estructura de arrays, junto con el estado de su camino.
+// Los arrays tienen relleno hasta múltiplo de ANCHO_PAQUETE.
+class LoteRayos {
+public:
+    vector<float> ox, oy, oz, dx, dy, dz;
+
+    // Distancia al impacto más cercano
+    vector<float> t;
+
+    // Índice en EscenaSoA::objetos del objeto impactado (-1 si no impacta con nada)
+    vector<int> impacto;
+
+    vector<EstadoCamino> estados;
+
+    // Método que devuelve el número de rayos activos del lote
+    size_t size() const;
+
+    // Método que redimensiona el lote a <n> rayos activos
+    void redimensionar(const size_t n);
+
+    // Método que guarda <rayo> en la posición <i> del lote
+    void asignarRayo(const size_t i, const Rayo& rayo);
+
+private:
+    size_t numRayos = 0;
+};
+
+// Función que reordena los rayos de <lote> por octante de su dirección y, dentro de
+// cada octante, por código Morton de su origen, para que rayos consecutivos sean coherentes
+void ordenarLote(LoteRayos& lote);
+
+// Función que interseca todos los rayos de <lote> con <escena>, de ANCHO_PAQUETE en
+// ANCHO_PAQUETE, guardando para cada uno la distancia y el objeto más cercanos
+void intersecarLote(const EscenaSoA& escena, LoteRayos& lote);
+
+// Versión wavefront de lanzarFotones: los caminos avanzan por lotes de
+// <parametros.tamLoteWavefront> rayos, que en cada rebote se ordenan, se intersecan
+// en bloque (con <escenaSoA>), se sombrean y se compactan eliminando los caminos terminados.
+// Los fotones se emiten desde las luces de <escena>.
+// Devuelve el número de caminos lanzados y acumula en <rayosTrazados> los rayos intersecados.
+int lanzarFotonesWavefront(vector<Photon>& vecFotonesGlobales, vector<Photon>& vecFotonesCausticos,
+                           const int numFotonesALanzar, const int numFotonesTotales, const Escena& escena,
+                           const EscenaSoA& escenaSoA, const Parametros& parametros,
+                           unsigned long& rayosTrazados);